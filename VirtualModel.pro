@@ -1,6 +1,6 @@
 QT     += core widgets opengl xml xmlpatterns
 
-CONFIG += c++14
+CONFIG += c++14 thread
 CONFIG -= app_bundle
 
 # The following define makes your compiler emit warnings if you use
@@ -29,11 +29,21 @@ SOURCES += \
     src/light.cpp \
     src/shaderprogram.cpp \ 
     src/abstractobject.cpp \
+    src/culling.cpp \
+    src/renderqueue.cpp \
     src/skybox.cpp \
     src/object.cpp \
+    src/meshcache.cpp \
+    src/meshoptimizer.cpp \
+    src/meshbuilder.cpp \
+    src/tangentspace.cpp \
     src/material.cpp \
     src/texture.cpp \
     src/vehicle.cpp \
+    src/trajectory.cpp \
+    src/pagedtrajectory.cpp \
+    src/livetrajectory.cpp \
+    src/threadpool.cpp \
     src/line.cpp \
     src/frame.cpp \ 
     src/videorecorder.cpp
@@ -59,11 +69,23 @@ HEADERS += \
     include/position.h \
     include/shaderprogram.h \
     include/abstractobject.h \
+    include/culling.h \
+    include/renderqueue.h \
     include/skybox.h \
     include/object.h \
+    include/meshcache.h \
+    include/meshoptimizer.h \
+    include/meshbuilder.h \
+    include/tangentspace.h \
     include/material.h \
     include/texture.h \
     include/vehicle.h \
+    include/trajectory.h \
+    include/pagedtrajectory.h \
+    include/livetrajectory.h \
+    include/livering.h \
+    include/threadpool.h \
+    include/numberparser.h \
     include/line.h \
     include/frame.h \
     include/constants.h \
@@ -77,7 +99,8 @@ unix: !macx {
       
     LIBS += $$PWD/lib/assimp/build/lib/libassimp.a \
       $$PWD/lib/assimp/build/contrib/zlib/libzlibstatic.a \
-      $$PWD/lib/assimp/build/contrib/irrXML/libIrrXML.a
+      $$PWD/lib/assimp/build/contrib/irrXML/libIrrXML.a \
+      -lrt
 }
 
 win32 {
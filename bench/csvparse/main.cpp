@@ -0,0 +1,174 @@
+#include "../../include/trajectory.h"
+#include "../../include/threadpool.h"
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+/*
+ * Benchmark of the parsing of the CSV text of a trajectory: the line by line
+ * QString::split and QString::toFloat loop filling a std::map, which loaded
+ * the trajectories before the columnar Trajectory, against
+ * Trajectory::fromCsv().
+ */
+
+typedef std::array<float, TrajectorySource::NumChannels> Row;
+
+
+void helpPrinter() {
+    std::cout << "Usage: csvparse [options]\n"
+    << " Compare the parsing of the CSV text of a trajectory with QString and\n"
+    << " with Trajectory::fromCsv.\n\n"
+    << "Options:\n"
+    << "  -h, --help            Displays help on command line options.\n"
+    << "  -f, --file <csv>      Parse the CSV file (same columns as the\n"
+    << "                        trajectory element). Otherwise, random\n"
+    << "                        samples are generated.\n"
+    << "  -s, --samples <n>     Number of samples generated (default 200000).\n"
+    << "  -r, --runs <n>        Number of runs, the best is kept (default 5)."
+    << std::endl;
+}
+
+
+/**
+ * @brief Return the CSV text of a trajectory with random channels.
+ */
+QString makeCsv(std::size_t numSamples) {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+    std::string csv = "time";
+    for (unsigned int c = 1; c < TrajectorySource::NumChannels; c++)
+        csv += ",channel" + std::to_string(c);
+    csv += '\n';
+    for (std::size_t i = 0; i < numSamples; i++) {
+        csv += std::to_string(static_cast<float>(i) * 0.01f);
+        for (unsigned int c = 1; c < TrajectorySource::NumChannels; c++)
+            csv += ',' + std::to_string(distribution(random));
+        csv += '\n';
+    }
+    return QString::fromStdString(csv);
+}
+
+
+/**
+ * @brief Parse the trajectory as it was before Trajectory::fromCsv: split
+ * each line and insert the samples in a map.
+ */
+std::size_t parseWithQString(const QString & csv) {
+    std::map<float, Row> trajectory;
+    QString text = csv;
+    QTextStream stream(&text);
+    stream.readLine();
+    while (!stream.atEnd()) {
+        const QStringList fields = stream.readLine().split(",");
+        if (fields.size() != static_cast<int>(TrajectorySource::NumChannels))
+            break;
+        Row row;
+        for (unsigned int c = 0; c < TrajectorySource::NumChannels; c++)
+            row[c] = fields.at(static_cast<int>(c)).toFloat();
+        trajectory[row[TrajectorySource::Time]] = row;
+    }
+    return trajectory.size();
+}
+
+
+std::size_t parseWithTrajectory(const QString & csv) {
+    return Trajectory::fromCsv(csv)->size();
+}
+
+
+/**
+ * @brief Return the best duration of the runs in milliseconds.
+ */
+template <typename Parse>
+double measure(unsigned int runs, std::size_t & numSamples, Parse parse) {
+    double best = 0.0;
+    for (unsigned int run = 0; run < runs; run++) {
+        const auto start = std::chrono::steady_clock::now();
+        numSamples = parse();
+        const auto end = std::chrono::steady_clock::now();
+        const double time =
+            std::chrono::duration<double, std::milli>(end - start).count();
+        if (run == 0 || time < best)
+            best = time;
+    }
+    return best;
+}
+
+
+int main(int argc, char *argv[]) {
+    QString file;
+    std::size_t numSamples = 200000;
+    unsigned int runs = 5;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            helpPrinter();
+            return EXIT_SUCCESS;
+        }
+        else if ((arg == "-f" || arg == "--file") && i + 1 < argc) {
+            file = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if ((arg == "-s" || arg == "--samples") && i + 1 < argc) {
+            numSamples = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if ((arg == "-r" || arg == "--runs") && i + 1 < argc) {
+            runs = static_cast<unsigned int>(
+                std::strtoul(argv[++i], nullptr, 10)
+            );
+        }
+        else {
+            helpPrinter();
+            return EXIT_FAILURE;
+        }
+    }
+    if (runs == 0) {
+        std::cerr << "At least one run is required." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    QString csv;
+    if (file.isEmpty()) {
+        csv = makeCsv(numSamples);
+    }
+    else {
+        QFile csvFile(file);
+        if (!csvFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::cerr << "Unable to open " << file.toStdString() << "."
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+        csv = QString::fromLatin1(csvFile.readAll());
+    }
+
+    std::size_t qstringSamples = 0;
+    std::size_t trajectorySamples = 0;
+    const double qstringTime = measure(runs, qstringSamples, [&csv]() {
+        return parseWithQString(csv);
+    });
+    const double trajectoryTime = measure(runs, trajectorySamples, [&csv]() {
+        return parseWithTrajectory(csv);
+    });
+    if (qstringSamples != trajectorySamples) {
+        std::cerr << "The parsers disagree: " << qstringSamples << " and "
+                  << trajectorySamples << " samples." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << trajectorySamples << " samples, "
+              << ThreadPool::global().size() << " threads\n"
+              << "  QString::split       " << std::setw(8) << qstringTime
+              << " ms\n"
+              << "  Trajectory::fromCsv  " << std::setw(8) << trajectoryTime
+              << " ms" << std::endl;
+    return EXIT_SUCCESS;
+}
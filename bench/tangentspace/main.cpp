@@ -0,0 +1,249 @@
+#include "../../include/meshbuilder.h"
+#include "../../include/tangentspace.h"
+#include "../../include/threadpool.h"
+#include <QVector2D>
+#include <QVector3D>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmark of the generation of the tangent space of a tessellated plane:
+ * the loop which wrote the tangent and bitangent of each triangle over its
+ * vertices, before TangentSpace::generate, against TangentSpace::generate,
+ * which accumulates them and orthonormalizes the frame of each vertex.
+ */
+
+
+void helpPrinter() {
+    std::cout << "Usage: tangentspace [options]\n"
+    << " Compare the tangent space of a tessellated plane written over the\n"
+    << " vertices triangle by triangle and with TangentSpace::generate.\n\n"
+    << "Options:\n"
+    << "  -h, --help            Displays help on command line options.\n"
+    << "  -v, --vertices <n>    Number of vertices per side of the plane\n"
+    << "                        (default 708, about 1M triangles).\n"
+    << "  -r, --runs <n>        Number of runs, the best is kept (default 20)."
+    << std::endl;
+}
+
+
+/**
+ * @brief Streams of a mesh and their storage.
+ */
+struct Plane {
+    std::vector<float> vertices;
+    std::vector<float> normals;
+    std::vector<float> textureUV;
+    std::vector<float> tangents;
+    std::vector<float> bitangents;
+    std::vector<unsigned int> indices;
+
+    MeshStreams streams() {
+        MeshStreams streams;
+        streams.vertices = Span<float>(vertices.data(), vertices.size());
+        streams.normals = Span<float>(normals.data(), normals.size());
+        streams.textureUV = Span<float>(textureUV.data(), textureUV.size());
+        streams.tangents = Span<float>(tangents.data(), tangents.size());
+        streams.bitangents = Span<float>(
+            bitangents.data(), bitangents.size()
+        );
+        streams.indices = Span<unsigned int>(indices.data(), indices.size());
+        return streams;
+    }
+};
+
+
+/**
+ * @brief Return a wavy plane of side x side vertices, two triangles per quad.
+ */
+Plane makePlane(unsigned int side) {
+    Plane plane;
+    const std::size_t numVertices = static_cast<std::size_t>(side) * side;
+    plane.vertices.resize(3 * numVertices);
+    plane.normals.resize(3 * numVertices);
+    plane.textureUV.resize(2 * numVertices);
+    plane.tangents.resize(3 * numVertices);
+    plane.bitangents.resize(3 * numVertices);
+    for (unsigned int y = 0; y < side; y++) {
+        for (unsigned int x = 0; x < side; x++) {
+            const std::size_t v = static_cast<std::size_t>(y) * side + x;
+            const float height =
+                0.3f * std::sin(0.05f * x) * std::cos(0.07f * y);
+            plane.vertices[3 * v] = static_cast<float>(x);
+            plane.vertices[3 * v + 1] = static_cast<float>(y);
+            plane.vertices[3 * v + 2] = height;
+            plane.normals[3 * v] = 0.0f;
+            plane.normals[3 * v + 1] = 0.0f;
+            plane.normals[3 * v + 2] = 1.0f;
+            plane.textureUV[2 * v] = 0.1f * x;
+            plane.textureUV[2 * v + 1] = 0.1f * y;
+        }
+    }
+    for (unsigned int y = 0; y + 1 < side; y++) {
+        for (unsigned int x = 0; x + 1 < side; x++) {
+            const unsigned int a = y * side + x;
+            const unsigned int c = a + side;
+            for (unsigned int i : {a, a + 1, c + 1, a, c + 1, c})
+                plane.indices.push_back(i);
+        }
+    }
+    return plane;
+}
+
+
+/**
+ * @brief Tangent space as it was computed before TangentSpace::generate: the
+ * normalized tangent and bitangent of each triangle are written over its
+ * vertices.
+ */
+void overwriteTangents(const MeshStreams & streams) {
+    const Span<float> & vertices = streams.vertices;
+    const Span<float> & textureUV = streams.textureUV;
+    const Span<unsigned int> & indices = streams.indices;
+    const Span<float> & tangents = streams.tangents;
+    const Span<float> & bitangents = streams.bitangents;
+    std::fill(tangents.begin(), tangents.end(), 0.0f);
+    std::fill(bitangents.begin(), bitangents.end(), 0.0f);
+    const std::size_t numTriangles = indices.size() / 3;
+    for (std::size_t i = 0; i < numTriangles; i++) {
+        unsigned int i0 = indices[3*i];
+        unsigned int i1 = indices[3*i+1];
+        unsigned int i2 = indices[3*i+2];
+        const float * pos0 = &vertices[3*i0];
+        const float * pos1 = &vertices[3*i1];
+        const float * pos2 = &vertices[3*i2];
+        const float * tex0 = &textureUV[2*i0];
+        const float * tex1 = &textureUV[2*i1];
+        const float * tex2 = &textureUV[2*i2];
+        QVector3D edge1 = QVector3D(
+            pos1[0] - pos0[0], pos1[1] - pos0[1], pos1[2] - pos0[2]
+        );
+        QVector3D edge2 = QVector3D(
+            pos2[0] - pos0[0], pos2[1] - pos0[1], pos2[2] - pos0[2]
+        );
+        QVector2D uv1 = QVector2D(tex1[0] - tex0[0], tex1[1] - tex0[1]);
+        QVector2D uv2 = QVector2D(tex2[0] - tex0[0], tex2[1] - tex0[1]);
+        float r = 1.0f / (uv1.x() * uv2.y() - uv2.x() * uv1.y());
+        QVector3D tangent = r * QVector3D(
+            edge1.x() * uv2.y() - edge2.x() * uv1.y(),
+            edge1.y() * uv2.y() - edge2.y() * uv1.y(),
+            edge1.z() * uv2.y() - edge2.z() * uv1.y()
+        );
+        tangent.normalize();
+        QVector3D bitangent = r * QVector3D(
+            -edge1.x() * uv2.x() + edge2.x() * uv1.x(),
+            -edge1.y() * uv2.x() + edge2.y() * uv1.x(),
+            -edge1.z() * uv2.x() + edge2.z() * uv1.x()
+        );
+        bitangent.normalize();
+        for (unsigned int v : {i0, i1, i2}) {
+            for (unsigned int c = 0; c < 3; c++) {
+                tangents[3*v+c] = tangent[static_cast<int>(c)];
+                bitangents[3*v+c] = bitangent[static_cast<int>(c)];
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Return the largest deviation of the tangent frames from unit,
+ * orthogonal vectors.
+ */
+float frameError(const Plane & plane) {
+    float error = 0.0f;
+    for (std::size_t v = 0; v < plane.tangents.size(); v += 3) {
+        const QVector3D n(
+            plane.normals[v], plane.normals[v + 1], plane.normals[v + 2]
+        );
+        const QVector3D t(
+            plane.tangents[v], plane.tangents[v + 1], plane.tangents[v + 2]
+        );
+        const QVector3D b(
+            plane.bitangents[v], plane.bitangents[v + 1],
+            plane.bitangents[v + 2]
+        );
+        error = std::max({
+            error, std::abs(t.length() - 1.0f), std::abs(b.length() - 1.0f),
+            std::abs(QVector3D::dotProduct(n, t)),
+            std::abs(QVector3D::dotProduct(t, b))
+        });
+    }
+    return error;
+}
+
+
+int main(int argc, char *argv[]) {
+    unsigned int side = 708;
+    unsigned int runs = 20;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            helpPrinter();
+            return EXIT_SUCCESS;
+        }
+        else if ((arg == "-v" || arg == "--vertices") && i + 1 < argc) {
+            side = static_cast<unsigned int>(
+                std::strtoul(argv[++i], nullptr, 10)
+            );
+        }
+        else if ((arg == "-r" || arg == "--runs") && i + 1 < argc) {
+            runs = static_cast<unsigned int>(
+                std::strtoul(argv[++i], nullptr, 10)
+            );
+        }
+        else {
+            helpPrinter();
+            return EXIT_FAILURE;
+        }
+    }
+    if (side < 2 || runs == 0) {
+        std::cerr << "At least two vertices per side and one run are "
+                  << "required." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Plane plane = makePlane(side);
+    const MeshStreams streams = plane.streams();
+    const std::size_t numVertices = plane.vertices.size() / 3;
+
+    // The two versions are run alternately so that both see the same state
+    // of the machine
+    double best[2] = {0.0, 0.0};
+    float error[2] = {0.0f, 0.0f};
+    for (unsigned int run = 0; run < runs; run++) {
+        for (unsigned int mode = 0; mode < 2; mode++) {
+            const auto start = std::chrono::steady_clock::now();
+            if (mode == 0)
+                overwriteTangents(streams);
+            else
+                TangentSpace::generate(streams, 0, numVertices);
+            const double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start
+            ).count();
+            if (run == 0 || ms < best[mode])
+                best[mode] = ms;
+            if (run == 0)
+                error[mode] = frameError(plane);
+        }
+    }
+
+    std::cout << plane.indices.size() / 3 << " triangles, "
+              << numVertices << " vertices, "
+              << ThreadPool::global().size() + 1 << " threads\n"
+              << "                          time    frame error\n"
+              << std::fixed << std::setprecision(1)
+              << "  overwrite           " << std::setw(8) << best[0]
+              << " ms    " << std::scientific << std::setprecision(1)
+              << error[0] << "\n" << std::fixed
+              << "  TangentSpace        " << std::setw(8) << best[1]
+              << " ms    " << std::scientific << std::setprecision(1)
+              << error[1] << std::endl;
+    return EXIT_SUCCESS;
+}
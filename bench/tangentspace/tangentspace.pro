@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = tangentspace
+
+QT = core gui
+CONFIG += console c++14 thread release
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    ../../src/tangentspace.cpp \
+    ../../src/threadpool.cpp
+
+HEADERS += \
+    ../../include/meshbuilder.h \
+    ../../include/tangentspace.h \
+    ../../include/threadpool.h
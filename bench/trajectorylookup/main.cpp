@@ -0,0 +1,152 @@
+#include "../../include/trajectory.h"
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmark of the trajectory lookup: the std::map keyed by time, which
+ * stored the trajectory before the columnar Trajectory, against
+ * Trajectory::findSample(), for uniform and variable-step trajectories and
+ * for playback (increasing times) and random seeks.
+ */
+
+typedef std::array<float, TrajectorySource::NumChannels> Row;
+
+// Sink of the results, so that the lookups are not optimized away
+volatile std::size_t g_sink = 0;
+
+
+void helpPrinter() {
+    std::cout << "Usage: trajectorylookup [options]\n"
+    << " Compare the lookup of the samples of a trajectory in a std::map and\n"
+    << " in a Trajectory.\n\n"
+    << "Options:\n"
+    << "  -h, --help            Displays help on command line options.\n"
+    << "  -s, --samples <n>     Number of samples of the trajectories\n"
+    << "                        (default 1000000).\n"
+    << "  -q, --queries <n>     Number of lookups per case (default 2000000)."
+    << std::endl;
+}
+
+
+/**
+ * @brief Return the CSV text of a trajectory with the given times. Only the
+ * time channel is set, the other channels are 0.
+ */
+std::string makeCsv(const std::vector<float> & times) {
+    std::string csv = "time\n";
+    std::string zeros;
+    for (unsigned int c = 1; c < TrajectorySource::NumChannels; c++)
+        zeros += ",0";
+    zeros += '\n';
+    for (float time : times) {
+        csv += std::to_string(time);
+        csv += zeros;
+    }
+    return csv;
+}
+
+
+/**
+ * @brief Return the average duration of a lookup in nanoseconds.
+ */
+template <typename Lookup>
+double measure(const std::vector<float> & queries, Lookup lookup) {
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t sum = 0;
+    for (float query : queries)
+        sum += lookup(query);
+    const auto end = std::chrono::steady_clock::now();
+    g_sink = g_sink + sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+        static_cast<double>(queries.size());
+}
+
+
+int main(int argc, char *argv[]) {
+    std::size_t numSamples = 1000000;
+    std::size_t numQueries = 2000000;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            helpPrinter();
+            return EXIT_SUCCESS;
+        }
+        else if ((arg == "-s" || arg == "--samples") && i + 1 < argc) {
+            numSamples = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if ((arg == "-q" || arg == "--queries") && i + 1 < argc) {
+            numQueries = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else {
+            helpPrinter();
+            return EXIT_FAILURE;
+        }
+    }
+    if (numSamples < 2 || numQueries == 0) {
+        std::cerr << "At least two samples and one query are required."
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 random(1);
+    std::cout << std::fixed << std::setprecision(1);
+    for (bool uniform : {true, false}) {
+        // 100 Hz trajectory, or steps between 5 and 14 ms
+        std::vector<float> times(numSamples);
+        double time = 0.0;
+        for (std::size_t i = 0; i < numSamples; i++) {
+            times[i] = uniform ? static_cast<float>(i) * 0.01f :
+                                 static_cast<float>(time);
+            time += 0.005 + (random() % 10) * 0.001;
+        }
+
+        const std::string csv = makeCsv(times);
+        std::unique_ptr<Trajectory> trajectory =
+            Trajectory::fromCsv(csv.data(), csv.size());
+        if (!trajectory || trajectory->size() != numSamples) {
+            std::cerr << "Unable to build the trajectory." << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::map<float, Row> map;
+        for (std::size_t i = 0; i < numSamples; i++) {
+            Row row;
+            trajectory->sample(i, row.data());
+            map[trajectory->time(i)] = row;
+        }
+
+        const float finalTime = trajectory->finalTime();
+        std::vector<float> playback(numQueries);
+        std::vector<float> seeks(numQueries);
+        for (std::size_t i = 0; i < numQueries; i++) {
+            playback[i] = finalTime * static_cast<float>(i) /
+                static_cast<float>(numQueries);
+            seeks[i] = finalTime * static_cast<float>(random() % 1000000) /
+                1000000.0f;
+        }
+
+        for (const std::vector<float> * queries : {&playback, &seeks}) {
+            const double mapTime = measure(*queries, [&](float t) {
+                return static_cast<std::size_t>(map.lower_bound(t)->second[0]);
+            });
+            std::size_t hint = 0;
+            const double flatTime = measure(*queries, [&](float t) {
+                hint = trajectory->findSample(t, hint);
+                return hint;
+            });
+            std::cout << (uniform ? "uniform " : "variable") << " "
+                      << (queries == &playback ? "playback" : "random  ")
+                      << "  std::map " << std::setw(8) << mapTime << " ns"
+                      << "  Trajectory " << std::setw(8) << flatTime << " ns"
+                      << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
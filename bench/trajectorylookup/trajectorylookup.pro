@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = trajectorylookup
+
+QT = core
+CONFIG += console c++14 thread release
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    ../../src/trajectory.cpp \
+    ../../src/threadpool.cpp
+
+HEADERS += \
+    ../../include/trajectory.h \
+    ../../include/threadpool.h \
+    ../../include/numberparser.h
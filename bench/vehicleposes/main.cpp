@@ -0,0 +1,261 @@
+#include "../../include/position.h"
+#include "../../include/threadpool.h"
+#include "../../include/trajectory.h"
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmark of the evaluation of the poses of the vehicles of a frame: the
+ * interpolation of the trajectory and the nine model matrices of each vehicle
+ * (chassis, wheels and tire forces), built with QMatrix4x4::rotate() as before
+ * Position::toMatrix was written in closed form, in closed form, and in
+ * closed form on the thread pool by batches of vehicles as Scene::update does.
+ */
+
+typedef std::array<QMatrix4x4, 9> Matrices;
+
+// Number of vehicles per batch of the thread pool, see Scene::update
+const std::size_t c_batchSize = 16;
+
+// Scale of the force arrows, see VehicleGraphics
+const float c_forceScale = 3000.0f;
+
+
+void helpPrinter() {
+    std::cout << "Usage: vehicleposes [options]\n"
+    << " Compare the evaluation of the model matrices of the vehicles with\n"
+    << " QMatrix4x4::rotate, in closed form, and on the thread pool.\n\n"
+    << "Options:\n"
+    << "  -h, --help            Displays help on command line options.\n"
+    << "  -v, --vehicles <n>    Maximum number of vehicles (default 2000).\n"
+    << "  -r, --runs <n>        Number of runs, the best is kept (default 20)."
+    << std::endl;
+}
+
+
+/**
+ * @brief Return a uniform trajectory of 256 samples with random channels.
+ */
+std::unique_ptr<Trajectory> makeTrajectory(std::mt19937 & random) {
+    std::uniform_real_distribution<float> distribution(-3.0f, 3.0f);
+    std::string csv = "time\n";
+    for (unsigned int i = 0; i < 256; i++) {
+        csv += std::to_string(static_cast<float>(i) * 0.01f);
+        for (unsigned int c = 1; c < TrajectorySource::NumChannels; c++)
+            csv += ',' + std::to_string(distribution(random));
+        csv += '\n';
+    }
+    return Trajectory::fromCsv(csv.data(), csv.size());
+}
+
+
+/**
+ * @brief Model matrix of a position built with QMatrix4x4::rotate().
+ */
+QMatrix4x4 rotateMatrix(const Position & pos, float spin) {
+    QMatrix4x4 modelMatrix;
+    modelMatrix.setToIdentity();
+    modelMatrix.translate(pos.x, pos.y, pos.z);
+    modelMatrix.rotate(pos.yaw  *180/PI, 0, 0, 1);
+    modelMatrix.rotate(pos.pitch*180/PI, 0, 1, 0);
+    modelMatrix.rotate(pos.roll *180/PI, 1, 0, 0);
+    if (spin != 0.0f)
+        modelMatrix.rotate(spin*180/PI, 0, 1, 0);
+    return modelMatrix;
+}
+
+
+/**
+ * @brief Model matrix of a force arrow built with QMatrix4x4::rotate().
+ */
+QMatrix4x4 rotateForceMatrix(const QVector3D & force, const Position & wheel,
+                             const Position & chassis,
+                             const QVector3D & offset) {
+    QMatrix4x4 modelMatrix;
+    modelMatrix.setToIdentity();
+    modelMatrix.translate(wheel.x, wheel.y, wheel.z);
+    modelMatrix.rotate(chassis.yaw *180/PI,0,0,1);
+    modelMatrix.translate(offset);
+    modelMatrix.scale(force / c_forceScale);
+    return modelMatrix;
+}
+
+
+/**
+ * @brief Model matrix of a force arrow in closed form, as
+ * VehicleGraphics::getForceModelMatrix.
+ */
+QMatrix4x4 closedForceMatrix(const QVector3D & force, const Position & wheel,
+                             const Position & chassis,
+                             const QVector3D & offset) {
+    const float cy = std::cos(chassis.yaw), sy = std::sin(chassis.yaw);
+    const QVector3D scale = force / c_forceScale;
+    return QMatrix4x4(
+        cy*scale.x(), -sy*scale.y(), 0.0f,
+        wheel.x + cy*offset.x() - sy*offset.y(),
+        sy*scale.x(),  cy*scale.y(), 0.0f,
+        wheel.y + sy*offset.x() + cy*offset.y(),
+        0.0f, 0.0f, scale.z(), wheel.z + offset.z(),
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
+}
+
+
+/**
+ * @brief Interpolate the trajectory and compute the nine model matrices of a
+ * vehicle, as VehicleController and VehicleGraphics do.
+ */
+template <bool ClosedForm>
+void computeMatrices(Trajectory & trajectory, float time, Matrices & matrices) {
+    float row[TrajectorySource::NumChannels];
+    trajectory.getSample(time, row);
+
+    const Position chassis(
+        row[Trajectory::ChassisX], row[Trajectory::ChassisY],
+        row[Trajectory::ChassisZ], row[Trajectory::ChassisYaw],
+        row[Trajectory::ChassisPitch], row[Trajectory::ChassisRoll]
+    );
+    matrices[0] = ClosedForm ? Position::toMatrix(chassis) :
+                               rotateMatrix(chassis, 0.0f);
+
+    // Wheels FL, FR, RL, RR: the channels of a wheel are x, y, z, rotation,
+    // steer and force x, y, z. The left wheels are turned around.
+    static const QVector3D c_offsets[4] = {
+        QVector3D(1, 0.5, 0), QVector3D(1, -0.5, 0),
+        QVector3D(-1.2, 0.5, 0), QVector3D(-1.2, -0.5, 0)
+    };
+    for (unsigned int w = 0; w < 4; w++) {
+        const float * channels = row + Trajectory::WheelFLX + 8 * w;
+        const bool left = w % 2 == 0;
+        const float spin = left ? -channels[3] : channels[3];
+        const Position wheel(
+            channels[0], channels[1], channels[2], channels[4] + chassis.yaw,
+            chassis.pitch, left ? chassis.roll - PI : chassis.roll
+        );
+        const QVector3D force(channels[5], channels[6], channels[7]);
+        matrices[1 + w] = ClosedForm ? Position::toMatrix(wheel, spin) :
+                                       rotateMatrix(wheel, spin);
+        matrices[5 + w] = ClosedForm ?
+            closedForceMatrix(force, wheel, chassis, c_offsets[w]) :
+            rotateForceMatrix(force, wheel, chassis, c_offsets[w]);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    std::size_t maxVehicles = 2000;
+    unsigned int runs = 20;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            helpPrinter();
+            return EXIT_SUCCESS;
+        }
+        else if ((arg == "-v" || arg == "--vehicles") && i + 1 < argc) {
+            maxVehicles = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if ((arg == "-r" || arg == "--runs") && i + 1 < argc) {
+            runs = static_cast<unsigned int>(
+                std::strtoul(argv[++i], nullptr, 10)
+            );
+        }
+        else {
+            helpPrinter();
+            return EXIT_FAILURE;
+        }
+    }
+    if (maxVehicles == 0 || runs == 0) {
+        std::cerr << "At least one vehicle and one run are required."
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 random(1);
+    std::vector<std::unique_ptr<Trajectory>> trajectories;
+    for (std::size_t i = 0; i < maxVehicles; i++)
+        trajectories.push_back(makeTrajectory(random));
+    std::vector<Matrices> matrices(maxVehicles);
+
+    // Difference between the two forms, relative to the magnitude of the
+    // coefficients
+    float maxError = 0.0f;
+    for (std::size_t i = 0; i < maxVehicles; i++) {
+        const float time = static_cast<float>(i % 200) * 0.0123f;
+        Matrices rotate, closed;
+        computeMatrices<false>(*trajectories[i], time, rotate);
+        computeMatrices<true>(*trajectories[i], time, closed);
+        for (unsigned int m = 0; m < rotate.size(); m++) {
+            for (int k = 0; k < 16; k++) {
+                const float a = rotate[m].constData()[k];
+                const float b = closed[m].constData()[k];
+                maxError = std::max(
+                    maxError, std::abs(a - b) / std::max(1.0f, std::abs(a))
+                );
+            }
+        }
+    }
+
+    ThreadPool & pool = ThreadPool::global();
+    std::cout << "Maximum difference between the forms: " << maxError << "\n"
+              << pool.size() + 1 << " threads\n"
+              << "vehicles      rotate()   closed form   thread pool\n"
+              << std::fixed << std::setprecision(1);
+    for (std::size_t numVehicles : {1, 10, 100, 500, 1000, 2000}) {
+        if (numVehicles > maxVehicles)
+            break;
+        double best[3] = {0.0, 0.0, 0.0};
+        for (unsigned int run = 0; run < runs; run++) {
+            const float time = 0.5f + static_cast<float>(run) * 0.1f;
+            for (unsigned int mode = 0; mode < 3; mode++) {
+                const auto start = std::chrono::steady_clock::now();
+                if (mode == 0) {
+                    for (std::size_t i = 0; i < numVehicles; i++)
+                        computeMatrices<false>(
+                            *trajectories[i], time, matrices[i]
+                        );
+                }
+                else if (mode == 1) {
+                    for (std::size_t i = 0; i < numVehicles; i++)
+                        computeMatrices<true>(
+                            *trajectories[i], time, matrices[i]
+                        );
+                }
+                else {
+                    const std::size_t numBatches =
+                        (numVehicles + c_batchSize - 1) / c_batchSize;
+                    pool.parallelFor(numBatches, [&](std::size_t batch) {
+                        const std::size_t last = std::min(
+                            numVehicles, (batch + 1) * c_batchSize
+                        );
+                        for (std::size_t i = batch * c_batchSize; i < last;
+                             i++)
+                            computeMatrices<true>(
+                                *trajectories[i], time, matrices[i]
+                            );
+                    });
+                }
+                const double us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start
+                ).count();
+                if (run == 0 || us < best[mode])
+                    best[mode] = us;
+            }
+        }
+        std::cout << std::setw(8) << numVehicles
+                  << std::setw(11) << best[0] << " us"
+                  << std::setw(11) << best[1] << " us"
+                  << std::setw(11) << best[2] << " us" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
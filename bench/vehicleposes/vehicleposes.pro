@@ -0,0 +1,17 @@
+TEMPLATE = app
+TARGET = vehicleposes
+
+QT = core gui
+CONFIG += console c++14 thread release
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    ../../src/trajectory.cpp \
+    ../../src/threadpool.cpp
+
+HEADERS += \
+    ../../include/position.h \
+    ../../include/trajectory.h \
+    ../../include/threadpool.h \
+    ../../include/numberparser.h
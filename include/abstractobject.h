@@ -2,8 +2,16 @@
 #define ABSTRACTOBJECT_H
 
 #include "light.h"
+#include "culling.h"
 #include <QMatrix4x4>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
 #include "constants.h"
 
@@ -48,18 +56,37 @@ public:
      */
     virtual void cleanUp() = 0;
     
+    /**
+     * @brief Return the bounding box of the object in model coordinates, used
+     * to skip the object when it is outside the view frustum.
+     * @return The bounding box, or nullptr if the bounds of the object are not
+     * known: the object is then never skipped.
+     */
+    virtual const BoundingBox * getBoundingBox() const {return nullptr;};
+    
     /**
      * @brief Set the model matrix of the object to position the object as 
      * desired.
      * @param model The model matrix.
      */
-    void setModelMatrix(const QMatrix4x4 & model) {m_model = model;};
+    void setModelMatrix(const QMatrix4x4 & model) {
+        if (model != m_model) {
+            m_model = model;
+            m_isModelDirty = true;
+        }
+    };
     
 protected:
     /**
      * Model matrix of the object.
      */
     QMatrix4x4 m_model;
+    
+    /**
+     * Set to true when the model matrix changes, so that the matrices derived
+     * from it are computed again.
+     */
+    bool m_isModelDirty = true;
 };
 
 
@@ -67,6 +94,10 @@ protected:
 /// Object manager
 /**
  * @brief Manager of all ABCObject.
+ * @details The objects can be loaded on the thread pool with loadObjectAsync().
+ * They are received and initialized in the order the loads finish by the 
+ * thread calling getObject() or initialize(), which must be the thread of the 
+ * OpenGL context: only the uploads to the GPU are serialized.
  * @author Louis Filipozzi
  */
 class ObjectManager {
@@ -82,15 +113,29 @@ public:
     );
     
     /**
-     * @brief Get the object.
-     * @remark Return a null pointer if the model has not been loaded yet.
+     * @brief Load an object on the thread pool. Nothing is done if an object 
+     * with the same name is loaded or being loaded.
+     * @remark This function can be called from any thread.
+     * @param name The name of the object.
+     * @param load The function loading the object, called by a worker thread.
+     * It returns nullptr if the object cannot be loaded.
+     */
+    static void loadObjectAsync(
+        QString name, std::function<std::unique_ptr<ABCObject>()> load
+    );
+    
+    /**
+     * @brief Get the object. If the object is being loaded on the thread pool,
+     * wait for it while initializing the objects received in the meantime.
+     * @remark Return a null pointer if the model has not been loaded.
      * @param name The name of the model to load.
      * @return A pointer to the object.
      */
     static ABCObject * getObject(QString name);
     
     /**
-     * @brief Initialize all the objects.
+     * @brief Initialize all the objects. Wait for the objects being loaded on
+     * the thread pool and initialize them as they are received.
      */
     static void initialize();
     
@@ -102,11 +147,46 @@ public:
 private:
     ObjectManager() {};
     
+    /**
+     * @brief Wait for the next object loaded on the thread pool, add it to 
+     * the loaded objects, and initialize it.
+     * @param lock The lock of m_mutex, owned by the caller. It is released 
+     * while the object is initialized.
+     */
+    static void receiveObject(std::unique_lock<std::mutex> & lock);
+    
     typedef std::map<QString, std::unique_ptr<ABCObject>> ObjectsMap;
     /**
      * List of loaded model.
      */
     static ObjectsMap m_objects;
+    
+    /**
+     * Objects loaded by loadObject() which have not been initialized yet.
+     */
+    static std::vector<ABCObject *> m_uninitializedObjects;
+    
+    /**
+     * Names of the objects being loaded on the thread pool.
+     */
+    static std::set<QString> m_loadingObjects;
+    
+    /**
+     * Objects loaded on the thread pool, in the order the loads finished, 
+     * which have not been received yet.
+     */
+    static std::deque<std::pair<QString, std::unique_ptr<ABCObject>>> 
+        m_loadedObjects;
+    
+    /**
+     * Mutex protecting the objects and the objects being loaded.
+     */
+    static std::mutex m_mutex;
+    
+    /**
+     * Condition notified when an object has been loaded on the thread pool.
+     */
+    static std::condition_variable m_loaded;
 };
 
 #endif // ABSTRACTOBJECT_H
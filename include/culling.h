@@ -0,0 +1,155 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+#include <array>
+#include <cstddef>
+
+/// Bounding box
+/**
+ * @brief Axis-aligned bounding box.
+ * @details A default-constructed box is empty: it contains no point and
+ * expanding it by a point or a box returns the point or the box.
+ */
+class BoundingBox {
+public:
+    /**
+     * @brief Create an empty box.
+     */
+    BoundingBox();
+
+    /**
+     * @brief Create the box with the given corners.
+     */
+    BoundingBox(const QVector3D & min, const QVector3D & max) :
+        m_min(min), m_max(max) {};
+
+    /**
+     * @brief Compute the bounding box of a range of vertices.
+     * @param positions The positions of the vertices, three floats per vertex.
+     * @param numVertices The number of vertices.
+     */
+    static BoundingBox fromPositions(const float * positions,
+                                     std::size_t numVertices);
+
+    /**
+     * @brief Return true if the box contains no point.
+     */
+    bool isEmpty() const {
+        return m_min.x() > m_max.x() || m_min.y() > m_max.y() ||
+            m_min.z() > m_max.z();
+    }
+
+    /**
+     * @brief Expand the box to contain a point.
+     */
+    void expand(const QVector3D & point);
+
+    /**
+     * @brief Expand the box to contain another box.
+     */
+    void expand(const BoundingBox & box);
+
+    /**
+     * @brief Return the bounding box of the box transformed by an affine
+     * matrix.
+     */
+    BoundingBox transformed(const QMatrix4x4 & matrix) const;
+
+    const QVector3D & getMin() const {return m_min;};
+
+    const QVector3D & getMax() const {return m_max;};
+
+    QVector3D getCenter() const {return (m_min + m_max) / 2.0f;};
+
+    /**
+     * @brief Return the radius of the sphere centered on the box containing
+     * the box, i.e. half its diagonal.
+     */
+    float getRadius() const {
+        return isEmpty() ? 0.0f : (m_max - m_min).length() / 2.0f;
+    };
+
+private:
+    QVector3D m_min;
+    QVector3D m_max;
+};
+
+
+
+/// Frustum
+/**
+ * @brief Planes of the view frustum of a view and projection matrix, used to
+ * skip the objects which are not visible.
+ * @details The frustum of the matrix projection * view * model is the view
+ * frustum in the model coordinates: the boxes are then tested in the
+ * coordinates of the model without being transformed.
+ */
+class Frustum {
+public:
+    /**
+     * @brief Result of the test of a box.
+     */
+    enum Test {
+        Outside,        /**< The box is outside the frustum. */
+        Intersecting,   /**< The box is partially inside the frustum. */
+        Inside          /**< The box is inside the frustum. */
+    };
+
+    /**
+     * @brief Extract the six planes of the frustum of a matrix.
+     * @param matrix The matrix transforming the points into the clip space.
+     * @param nearPlane Set to false to extend the frustum to infinity behind
+     * its near plane, e.g. toward the light for the shadow casters.
+     */
+    Frustum(const QMatrix4x4 & matrix, bool nearPlane = true);
+
+    /**
+     * @brief Test a box against the frustum.
+     * @details The test is conservative: a box close to a corner of the
+     * frustum may be reported as intersecting while being outside.
+     */
+    Test test(const BoundingBox & box) const;
+
+private:
+    /**
+     * The planes (a, b, c, d) of the frustum: a point p is inside the plane if
+     * a * p.x + b * p.y + c * p.z + d >= 0.
+     */
+    std::array<QVector4D, 6> m_planes;
+};
+
+
+
+/// Culling statistics
+/**
+ * @brief Number of objects and meshes drawn and culled by the color pass or
+ * the shadow passes of the current frame.
+ */
+struct CullingStats {
+    /** Number of objects of the scene graph drawn. */
+    unsigned int drawnObjects = 0;
+    /** Number of objects of the scene graph culled. */
+    unsigned int culledObjects = 0;
+    /** Number of meshes drawn by the drawn objects. */
+    unsigned int drawnMeshes = 0;
+    /** Number of meshes culled in the drawn objects. */
+    unsigned int culledMeshes = 0;
+
+    /**
+     * @brief Return the statistics of the color pass of the current frame, 
+     * reset by the scene before the color pass.
+     */
+    static CullingStats & color();
+    
+    /**
+     * @brief Return the statistics of the shadow passes of the current frame,
+     * summed over the cascades and reset by the scene before the first 
+     * cascade.
+     */
+    static CullingStats & shadow();
+};
+
+#endif // CULLING_H
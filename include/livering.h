@@ -0,0 +1,112 @@
+#ifndef LIVERING_H
+#define LIVERING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/** @file livering.h
+ * Layout of the shared memory ring buffer used to stream the trajectory of a
+ * vehicle from a running simulation (the producer) to the renderer (the
+ * consumer). This header does not depend on Qt so that it can be included by
+ * the simulation.
+ */
+
+/// Live ring header
+/**
+ * @brief Header of the ring buffer. It is followed in the shared memory by
+ * capacity samples of numChannels floats each.
+ * @details The ring buffer is lock-free with a single producer and a single
+ * consumer. The producer writes the sample number head in the slot
+ * head % capacity then increments head. The consumer reads the samples in
+ * [tail, head) in place and increments tail when it does not need the oldest
+ * samples anymore. The producer can only write a sample if
+ * head - tail < capacity.
+ */
+struct LiveRingHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numChannels;
+    std::uint64_t capacity;
+    /** Number of samples written by the producer. */
+    alignas(64) std::atomic<std::uint64_t> head;
+    /** Number of samples released by the consumer. */
+    alignas(64) std::atomic<std::uint64_t> tail;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "The ring buffer requires lock-free 64-bit atomics");
+
+namespace LiveRing {
+
+const char c_magic[8] = {'V', 'M', 'L', 'I', 'V', 'E', '\0', '\0'};
+const std::uint32_t c_version = 1;
+
+/**
+ * @brief Return the size in bytes of the shared memory of a ring buffer.
+ */
+inline std::size_t size(std::uint64_t capacity, std::uint32_t numChannels) {
+    return sizeof(LiveRingHeader) +
+        static_cast<std::size_t>(capacity) * numChannels * sizeof(float);
+}
+
+/**
+ * @brief Return the first sample slot of a ring buffer.
+ */
+inline float * samples(LiveRingHeader * header) {
+    return reinterpret_cast<float *>(header + 1);
+}
+
+inline const float * samples(const LiveRingHeader * header) {
+    return reinterpret_cast<const float *>(header + 1);
+}
+
+/**
+ * @brief Initialize a ring buffer in a zeroed shared memory. Called by the
+ * producer. The magic number is written last so that the consumer never sees
+ * a partially initialized header.
+ */
+inline void initialize(
+    LiveRingHeader * header, std::uint64_t capacity, std::uint32_t numChannels
+) {
+    header->version = c_version;
+    header->numChannels = numChannels;
+    header->capacity = capacity;
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, c_magic, sizeof(c_magic));
+}
+
+/**
+ * @brief Check the header of a ring buffer. Called by the consumer.
+ */
+inline bool isValid(const LiveRingHeader * header, std::uint32_t numChannels) {
+    bool valid = std::memcmp(header->magic, c_magic, sizeof(c_magic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return valid && header->version == c_version &&
+        header->numChannels == numChannels && header->capacity > 1;
+}
+
+/**
+ * @brief Append a sample to a ring buffer. Called by the producer.
+ * @param header The ring buffer.
+ * @param sample The numChannels values of the sample, the time first.
+ * @return Return false if the ring buffer is full.
+ */
+inline bool push(LiveRingHeader * header, const float * sample) {
+    const std::uint64_t head = header->head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = header->tail.load(std::memory_order_acquire);
+    if (head - tail >= header->capacity)
+        return false;
+    float * slot = samples(header) +
+        (head % header->capacity) * header->numChannels;
+    std::memcpy(slot, sample, header->numChannels * sizeof(float));
+    header->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+} // namespace LiveRing
+
+#endif // LIVERING_H
@@ -0,0 +1,63 @@
+#ifndef LIVETRAJECTORY_H
+#define LIVETRAJECTORY_H
+
+#include "trajectory.h"
+#include "livering.h"
+
+/// Live trajectory
+/**
+ * @brief Trajectory streamed by a running simulation through a ring buffer in
+ * POSIX shared memory (see livering.h).
+ * @details The samples are interpolated in place in the shared memory, without
+ * lock nor copy. The trajectory grows as the simulation writes new samples.
+ * Only the most recent samples are kept: the oldest samples are released to
+ * the producer so that it always has room for new samples.
+ */
+class LiveTrajectory : public TrajectorySource {
+public:
+    /**
+     * @brief Open the shared memory of a ring buffer created by the producer.
+     * @param name The name of the shared memory (e.g. "/vehicle").
+     * @return The trajectory, nullptr if the shared memory does not exist or
+     * is not a valid ring buffer.
+     */
+    static std::unique_ptr<LiveTrajectory> open(const QString & name);
+
+    ~LiveTrajectory() override;
+
+    LiveTrajectory(const LiveTrajectory &) = delete;
+    LiveTrajectory & operator=(const LiveTrajectory &) = delete;
+
+    bool isEmpty() const override;
+    float firstTime() const override;
+    float finalTime() const override;
+    bool getSample(float time, float row[NumChannels]) override;
+
+private:
+    LiveTrajectory();
+
+    /**
+     * @brief Return the s-th sample written by the producer.
+     */
+    const float * sample(std::uint64_t s) const {
+        return p_samples + (s % m_capacity) * NumChannels;
+    }
+
+private:
+    LiveRingHeader * p_header;
+    const float * p_samples;
+    std::size_t m_size;
+    std::uint64_t m_capacity;
+
+    /**
+     * Number of samples kept by the consumer. The older samples are released.
+     */
+    std::uint64_t m_history;
+
+    /**
+     * Sample found by the last call to getSample().
+     */
+    std::uint64_t m_cursor;
+};
+
+#endif // LIVETRAJECTORY_H
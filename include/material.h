@@ -4,6 +4,7 @@
 #include <QString>
 #include <QVector3D>
 #include "texture.h"
+#include <atomic>
 
 /// Material class
 /**
@@ -43,6 +44,12 @@ public:
     void setNormalTexture(Texture * normal);
     void setBumpTexture(Texture * bump);
     
+    /**
+     * @brief Return the unique identifier of the material, used to sort the
+     * draws by material.
+     */
+    unsigned int getId() const {return m_id;};
+    
     QString getName() const {return m_name;};
     QVector3D getAmbientColor() const {return m_ambient;};
     QVector3D getDiffuseColor() const {return m_diffuse;};
@@ -61,6 +68,13 @@ private:
     void setDefaultTexture();
     
 private:
+    /**
+     * Number of materials created, used to identify the materials. The 
+     * materials are created by the threads loading the models.
+     */
+    static std::atomic<unsigned int> m_numMaterials;
+    
+    const unsigned int m_id;
     QString m_name;
     QVector3D m_ambient;
     QVector3D m_diffuse;
@@ -0,0 +1,175 @@
+#ifndef MESHBUILDER_H
+#define MESHBUILDER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/// Span
+/**
+ * @brief View over a contiguous array which does not own its data.
+ */
+template<class T>
+class Span {
+public:
+    Span() : p_data(nullptr), m_size(0) {}
+    Span(T * data, std::size_t size) : p_data(data), m_size(size) {}
+    /** Conversion from a span of non-const elements. */
+    template<class U>
+    Span(const Span<U> & other) : p_data(other.data()), m_size(other.size()) {}
+    
+    T * data() const {return p_data;}
+    std::size_t size() const {return m_size;}
+    bool empty() const {return m_size == 0;}
+    T & operator[](std::size_t i) const {return p_data[i];}
+    T * begin() const {return p_data;}
+    T * end() const {return p_data + m_size;}
+    
+private:
+    T * p_data;
+    std::size_t m_size;
+};
+
+
+
+/// Mesh streams
+/**
+ * @brief Spans over the vertex and index streams of an object. Each vertex has
+ * 3 floats of position, normal, tangent, and bitangent, and 2 floats of 
+ * texture coordinates.
+ * @details While the object is built, the indices are 32-bit indices of the 
+ * vertices of the object. Once packed, they are replaced by the index buffer 
+ * in which each mesh has indices of 16 or 32 bits relative to its first 
+ * vertex.
+ */
+struct MeshStreams {
+    Span<float> vertices;
+    Span<float> normals;
+    Span<float> textureUV;
+    Span<float> tangents;
+    Span<float> bitangents;
+    Span<unsigned int> indices;
+    Span<const char> packedIndices;
+};
+
+
+
+/// Index range
+/**
+ * @brief Indices of a mesh in the index stream and in the packed index buffer.
+ */
+struct IndexRange {
+    /** Offset of the first index in the index stream. */
+    std::size_t first;
+    /** Number of indices. */
+    std::size_t count;
+    /** Offset in bytes of the first index in the packed index buffer. */
+    std::size_t byteOffset;
+    /** First vertex of the mesh, subtracted from the packed indices. */
+    std::size_t baseVertex;
+    /** Size in bytes of a packed index: 2 or 4. */
+    unsigned int indexSize;
+};
+
+
+
+/// Mesh builder
+/**
+ * @brief Build the vertex and index streams of an object.
+ * @details The maximum numbers of vertices and indices are given up front 
+ * (e.g. from the counts of the meshes of an aiScene): all the streams are 
+ * allocated from a single block of memory, the arena, which is never 
+ * reallocated. The meshes then reserve their vertices and indices and write 
+ * them in place. The arena is handed over to the object with the streams and 
+ * released in one free once the buffers are created.
+ */
+class MeshBuilder {
+public:
+    /**
+     * Memory holding the data of all the streams.
+     */
+    typedef std::unique_ptr<char[]> Arena;
+    
+    /**
+     * @brief Allocate the streams.
+     * @param maxVertices The maximum number of vertices.
+     * @param maxIndices The maximum number of indices.
+     */
+    MeshBuilder(std::size_t maxVertices, std::size_t maxIndices);
+    
+    /**
+     * @brief Reserve vertices at the end of the vertex streams.
+     * @param count The number of vertices.
+     * @return The index of the first vertex.
+     */
+    std::size_t addVertices(std::size_t count);
+    
+    /**
+     * @brief Reserve the indices of a mesh at the end of the index stream.
+     * @details The indices are written as 32-bit indices of the vertices of 
+     * the object. They are packed in 16 bits when the mesh has less than 65537
+     * vertices, and in 32 bits otherwise.
+     * @param count The number of indices.
+     * @param baseVertex The first vertex of the mesh.
+     * @param numVertices The number of vertices of the mesh.
+     * @return The range of the indices.
+     */
+    IndexRange addIndices(
+        std::size_t count, std::size_t baseVertex, std::size_t numVertices
+    );
+    
+    /**
+     * @brief Pack the indices of each mesh in place into the index buffer, 
+     * once all the indices are written and processed.
+     */
+    void packIndices();
+    
+    /**
+     * @brief Return the streams of the vertices and indices reserved so far.
+     */
+    MeshStreams getStreams() const;
+    
+    /**
+     * @brief Release the arena holding the data of the streams. The builder 
+     * must not be used afterwards.
+     */
+    Arena releaseArena() {return std::move(p_arena);}
+    
+private:
+    /**
+     * The memory holding the data of all the streams.
+     */
+    Arena p_arena;
+    
+    /**
+     * Streams of the maximum numbers of vertices and indices.
+     */
+    MeshStreams m_capacity;
+    
+    /**
+     * Number of reserved vertices.
+     */
+    std::size_t m_numVertices;
+    
+    /**
+     * Number of reserved indices.
+     */
+    std::size_t m_numIndices;
+    
+    /**
+     * Ranges of the reserved indices.
+     */
+    std::vector<IndexRange> m_ranges;
+    
+    /**
+     * Size in bytes of the packed index buffer.
+     */
+    std::size_t m_packedSize;
+    
+    /**
+     * True once the indices are packed.
+     */
+    bool m_isPacked;
+};
+
+#endif // MESHBUILDER_H
@@ -0,0 +1,124 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <memory>
+
+/// Mesh cache
+/**
+ * @brief Binary file caching the result of the import of a model: the vertex
+ * and index streams, and a description of the nodes, meshes and materials
+ * (the metadata).
+ * @details The cache files are stored in the cache location of the application
+ * and named after their key, which is a hash of the content of the model file,
+ * of the import flags, of the options of the loader and of the version of the
+ * cache format. A modified model therefore never hits a stale cache. The files
+ * referenced by the model (e.g. the material library of an OBJ file) are not
+ * part of the key.
+ * The cache file is memory-mapped when opened: the streams are read in place
+ * when the buffers of the object are created.
+ */
+class MeshCache {
+public:
+    /**
+     * @brief Streams of vertex and index data stored in the cache.
+     */
+    enum Stream : unsigned int {
+        Vertices = 0, Normals, TextureUV, Indices, Tangents, Bitangents,
+        NumStreams
+    };
+
+    /**
+     * @brief Header of a cache file. The metadata and the streams follow the
+     * header at the given offsets, each stream being aligned on 16 bytes.
+     */
+    struct FileHeader {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint8 key[20];
+        quint32 reserved0;
+        quint64 metadataOffset;
+        quint64 metadataSize;
+        quint64 streamOffsets[NumStreams];
+        quint64 streamSizes[NumStreams];
+    };
+
+    /**
+     * @brief Compute the key of the cache of a model.
+     * @param modelFile The path to the model file.
+     * @param importFlags The flags used to import the model.
+     * @param options The options of the loader changing the streams (e.g. the
+     * optimization of the meshes).
+     * @return The key, empty if the model file cannot be read.
+     */
+    static QByteArray key(const QString & modelFile, quint32 importFlags,
+                          quint32 options = 0);
+
+    /**
+     * @brief Open and map the cache file of a key.
+     * @return The cache, nullptr if there is no valid cache file for the key.
+     */
+    static std::unique_ptr<MeshCache> open(const QByteArray & key);
+
+    /**
+     * @brief Write the cache file of a key. The file is replaced atomically.
+     * @param key The key of the cache.
+     * @param metadata The metadata.
+     * @param streams The data of each stream.
+     * @param sizes The size in bytes of each stream.
+     * @return Return true if the file has been written successfully.
+     */
+    static bool save(
+        const QByteArray & key, const QByteArray & metadata,
+        const char * const streams[NumStreams], const qint64 sizes[NumStreams]
+    );
+
+    /**
+     * @brief Return the metadata. The data is not copied from the mapped file.
+     */
+    const QByteArray & metadata() const {return m_metadata;}
+
+    /**
+     * @brief Return a pointer to the data of a stream in the mapped file.
+     */
+    const char * stream(Stream stream) const {return p_streams[stream];}
+
+    /**
+     * @brief Return the size in bytes of a stream.
+     */
+    qint64 streamSize(Stream stream) const {return m_streamSizes[stream];}
+
+private:
+    MeshCache() = default;
+
+    /**
+     * @brief Return the path to the cache file of a key.
+     */
+    static QString fileName(const QByteArray & key);
+
+private:
+    /**
+     * The mapped cache file.
+     */
+    std::unique_ptr<QFile> p_file;
+
+    /**
+     * The metadata, referencing the mapped file.
+     */
+    QByteArray m_metadata;
+
+    /**
+     * Data of each stream in the mapped file.
+     */
+    const char * p_streams[NumStreams];
+
+    /**
+     * Size in bytes of each stream.
+     */
+    qint64 m_streamSizes[NumStreams];
+};
+
+#endif // MESHCACHE_H
@@ -0,0 +1,110 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include "meshbuilder.h"
+#include <vector>
+
+/** @file meshoptimizer.h
+ * Reordering of the triangles and vertices of a mesh to reduce the work of the
+ * vertex shader and of the fragment shader, and simplification of a mesh.
+ * @details Each function works on one mesh: a range of triangles of
+ * MeshStreams::indices which only reference the range of vertices
+ * [firstVertex, firstVertex + numVertices). The indices are global (i.e. the
+ * offset of the first vertex is included).
+ */
+
+namespace MeshOptimizer {
+
+/**
+ * Number of vertices of the post-transform cache used to reorder and analyze
+ * the triangles.
+ */
+const unsigned int c_cacheSize = 32;
+
+/**
+ * @brief Count the vertices transformed to draw the triangles, simulating a
+ * FIFO post-transform cache.
+ * @details The average cache miss ratio (ACMR) of the mesh is the number of
+ * misses per triangle: 0.5 for a regular grid in the best order, 3 in the
+ * worst one.
+ * @param indices The indices of the triangles.
+ * @param firstVertex The first vertex of the mesh.
+ * @param numVertices The number of vertices of the mesh.
+ * @param cacheSize The number of vertices of the cache.
+ * @return The number of cache misses.
+ */
+std::size_t countCacheMisses(
+    Span<const unsigned int> indices, std::size_t firstVertex,
+    std::size_t numVertices, unsigned int cacheSize = c_cacheSize
+);
+
+/**
+ * @brief Reorder the triangles to reuse the vertices in the post-transform
+ * cache, using the linear-speed algorithm of Tom Forsyth.
+ * @param indices The indices of the triangles, reordered in place.
+ * @param firstVertex The first vertex of the mesh.
+ * @param numVertices The number of vertices of the mesh.
+ */
+void optimizeVertexCache(
+    Span<unsigned int> indices, std::size_t firstVertex, std::size_t numVertices
+);
+
+/**
+ * @brief Reorder clusters of triangles so that the triangles facing outwards,
+ * which are likely to occlude the others, are drawn first.
+ * @details The clusters are split where the post-transform cache is flushed
+ * (i.e. on a triangle of three misses): the cache reuse of the triangles
+ * ordered by optimizeVertexCache() is kept.
+ * @param indices The indices of the triangles, reordered in place.
+ * @param vertices The positions of the vertices of all the meshes.
+ * @param firstVertex The first vertex of the mesh.
+ * @param numVertices The number of vertices of the mesh.
+ */
+void optimizeOverdraw(
+    Span<unsigned int> indices, Span<const float> vertices,
+    std::size_t firstVertex, std::size_t numVertices
+);
+
+/**
+ * @brief Reorder the vertices in the order they are first used by the
+ * triangles, so that the vertex data is fetched sequentially. The unused
+ * vertices are moved at the end of the mesh.
+ * @param indices The indices of the triangles, remapped in place.
+ * @param streams The streams whose vertex data is reordered in place.
+ * @param firstVertex The first vertex of the mesh.
+ * @param numVertices The number of vertices of the mesh.
+ */
+void optimizeVertexFetch(
+    Span<unsigned int> indices, const MeshStreams & streams,
+    std::size_t firstVertex, std::size_t numVertices
+);
+
+/**
+ * @brief Simplify a mesh by collapsing its edges in the order of their
+ * quadric error, to generate a level of detail.
+ * @details The edges are collapsed onto one of their vertices: the simplified
+ * mesh references the vertices of the mesh and no vertex is created. The
+ * vertices sharing their position with other vertices (e.g. on texture seams)
+ * are kept, and the vertices of the borders only move along the borders, so
+ * that no crack appears.
+ * @param indices The indices of the triangles.
+ * @param vertices The positions of the vertices of all the meshes.
+ * @param firstVertex The first vertex of the mesh.
+ * @param numVertices The number of vertices of the mesh.
+ * @param targetCount The target number of indices. The simplified mesh may
+ * have more indices if the mesh cannot be simplified further.
+ * @param maxError The maximum geometric error of the simplified mesh, as a
+ * distance in the unit of the positions.
+ * @param[out] error The geometric error of the simplified mesh, as a distance
+ * in the unit of the positions.
+ * @return The indices of the simplified mesh.
+ */
+std::vector<unsigned int> simplify(
+    Span<const unsigned int> indices, Span<const float> vertices,
+    std::size_t firstVertex, std::size_t numVertices, std::size_t targetCount,
+    float maxError, float & error
+);
+
+}
+
+#endif // MESHOPTIMIZER_H
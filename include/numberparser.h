@@ -0,0 +1,203 @@
+#ifndef NUMBERPARSER_H
+#define NUMBERPARSER_H
+
+#include <cstdint>
+#include <limits>
+
+/** @file numberparser.h
+ * Locale-independent parsing of numbers from a character range, in the
+ * spirit of std::from_chars. The functions never allocate memory.
+ */
+
+namespace NumberParser {
+
+/**
+ * @brief Return true if the character is a blank (space or tab).
+ */
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+
+/**
+ * @brief Skip the blank characters.
+ * @return Pointer to the first non-blank character, or last.
+ */
+inline const char * skipBlanks(const char * first, const char * last) {
+    while (first != last && isBlank(*first))
+        ++first;
+    return first;
+}
+
+
+/**
+ * @brief Return true if the character is a white space (blank or end of line).
+ */
+inline bool isSpace(char c) {
+    return isBlank(c) || c == '\n' || c == '\r';
+}
+
+
+/**
+ * @brief Skip the white space characters.
+ * @return Pointer to the first non-space character, or last.
+ */
+inline const char * skipSpaces(const char * first, const char * last) {
+    while (first != last && isSpace(*first))
+        ++first;
+    return first;
+}
+
+
+/**
+ * @brief Parse a decimal unsigned integer (e.g. "42").
+ * @param[in] first Pointer to the first character.
+ * @param[in] last Pointer past the last character.
+ * @param[out] value The parsed value.
+ * @return Pointer to the first character not part of the number, or nullptr
+ * if no number could be parsed or if it overflows 32 bits.
+ */
+inline const char * parseUnsigned(
+    const char * first, const char * last, std::uint32_t & value
+) {
+    const char * p = first;
+    std::uint64_t result = 0;
+    for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+        result = result * 10 + static_cast<unsigned int>(*p - '0');
+        if (result > 0xffffffffu)
+            return nullptr;
+    }
+    if (p == first)
+        return nullptr;
+    value = static_cast<std::uint32_t>(result);
+    return p;
+}
+
+
+/**
+ * @brief Return true if the characters starting at first match the lower
+ * case word, ignoring the case.
+ */
+inline bool matchWord(
+    const char * first, const char * last, const char * word
+) {
+    for (; *word != '\0'; ++first, ++word) {
+        if (first == last || (*first | 0x20) != *word)
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Parse a decimal floating-point number (e.g. "-1.5e-3"), or "nan",
+ * "inf" and "infinity" in any case as QString::toFloat does.
+ * @details At most 19 significant digits are taken into account, which is
+ * more than enough for a float. The result may differ from the correctly
+ * rounded float by one unit in the last place.
+ * @param[in] first Pointer to the first character.
+ * @param[in] last Pointer past the last character.
+ * @param[out] value The parsed value.
+ * @return Pointer to the first character not part of the number, or nullptr
+ * if no number could be parsed.
+ */
+inline const char * parseFloat(
+    const char * first, const char * last, float & value
+) {
+    static const double c_powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char * p = first;
+
+    // Sign
+    bool negative = false;
+    if (p != last && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // Not a number and infinity
+    if (matchWord(p, last, "nan")) {
+        value = std::numeric_limits<float>::quiet_NaN();
+        return p + 3;
+    }
+    if (matchWord(p, last, "inf")) {
+        value = negative ? -std::numeric_limits<float>::infinity() :
+                           std::numeric_limits<float>::infinity();
+        return matchWord(p, last, "infinity") ? p + 8 : p + 3;
+    }
+
+    // Mantissa
+    std::uint64_t mantissa = 0;
+    int numDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+        hasDigits = true;
+        if (numDigits < 19) {
+            mantissa = mantissa * 10 + static_cast<unsigned int>(*p - '0');
+            if (mantissa != 0)
+                numDigits++;
+        }
+        else {
+            exponent++;
+        }
+    }
+    if (p != last && *p == '.') {
+        ++p;
+        for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+            hasDigits = true;
+            if (numDigits < 19) {
+                mantissa = mantissa * 10 + static_cast<unsigned int>(*p - '0');
+                if (mantissa != 0)
+                    numDigits++;
+                exponent--;
+            }
+        }
+    }
+    if (!hasDigits)
+        return nullptr;
+
+    // Exponent
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        const char * q = p + 1;
+        bool negativeExponent = false;
+        if (q != last && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            ++q;
+        }
+        if (q != last && *q >= '0' && *q <= '9') {
+            int e = 0;
+            for (; q != last && *q >= '0' && *q <= '9'; ++q) {
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+            }
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    // Scale the mantissa. The powers of 10 up to 1e22 are exact in double.
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0) {
+        while (exponent > 22) {
+            result *= 1e22;
+            exponent -= 22;
+        }
+        while (exponent < -22) {
+            result /= 1e22;
+            exponent += 22;
+        }
+        if (exponent >= 0)
+            result *= c_powersOf10[exponent];
+        else
+            result /= c_powersOf10[-exponent];
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+} // namespace NumberParser
+
+#endif // NUMBERPARSER_H
@@ -2,8 +2,11 @@
 #define OBJECT_H
 
 #include "abstractobject.h"
+#include "culling.h"
 #include "material.h"
 #include "shaderprogram.h"
+#include "meshcache.h"
+#include "meshbuilder.h"
 #include <QString>
 #include <memory>
 #include <QOpenGLVertexArrayObject>
@@ -20,8 +23,9 @@
  * The vertex data (vertices, normals, indices) are stored in a unique Vertex 
  * Array Object (VAO). The object is decomposed of several nodes organized in a 
  * tree. A node is decomposed of a mesh. Each mesh has a unique material.
- * When rendering the object, the VAO is bound. Then each node is draw 
- * recursively.
+ * The nodes are flattened in depth-first order when the object is created.
+ * When rendering the object, the VAO is bound. Then the nodes are drawn in 
+ * order, skipping the descendants of the nodes outside the view frustum.
  */
 class Object : public ABCObject {
 public:
@@ -34,21 +38,78 @@ private:
     class Mesh;
     
 public:
+    /**
+     * @brief Layout of the vertex data in the buffers.
+     */
+    enum class VertexFormat {
+        /** One buffer of floats per attribute (56 bytes per vertex). */
+        Float,
+        /** 
+         * One interleaved buffer with float positions, normals and tangents
+         * packed in 10_10_10_2 integers and half-float texture coordinates 
+         * (24 bytes per vertex). The bitangent is replaced by the handedness 
+         * of the tangent frame stored in the w component of the tangent.
+         */
+        Packed
+    };
+    
+    /**
+     * @brief Set the layout of the vertex data of the objects initialized 
+     * afterwards.
+     */
+    static void setVertexFormat(VertexFormat format) {m_vertexFormat = format;}
+    
+    /**
+     * @brief Set the maximum projected error of the levels of detail drawn by
+     * the render passes.
+     * @param colorError The maximum error when rendering the objects, in 
+     * fraction of the height of the viewport.
+     * @param shadowError The maximum error when rendering the shadow maps, in
+     * fraction of the height of the shadow map. It is usually larger so that 
+     * the shadows use coarser levels of detail.
+     */
+    static void setLodMaxErrors(float colorError, float shadowError) {
+        m_lodMaxError = colorError;
+        m_shadowLodMaxError = shadowError;
+    }
+    
+    /**
+     * @brief Create an object whose buffer data is built by a MeshBuilder.
+     * @param rootNode The root node of the object.
+     * @param streams The streams of the buffer data.
+     * @param arena The arena holding the data of the streams.
+     */
     Object(
         std::unique_ptr<const Node> rootNode,
-        std::unique_ptr<QVector<float>> vertices,
-        std::unique_ptr<QVector<float>> normals,
-        std::unique_ptr<QVector<QVector<float>>> textureUV,
-        std::unique_ptr<QVector<unsigned int>> indices, 
-        std::unique_ptr<QVector<float>> tangents, 
-        std::unique_ptr<QVector<float>> bitangents
+        const MeshStreams & streams,
+        MeshBuilder::Arena arena
+    ) : 
+    m_error(!rootNode || !arena),
+    m_isInitialized(false),
+    m_isPacked(false),
+    m_vertexBuffer(QOpenGLBuffer::VertexBuffer), 
+    m_normalBuffer(QOpenGLBuffer::VertexBuffer), 
+    m_textureUVBuffer(QOpenGLBuffer::VertexBuffer), 
+    m_indexBuffer(QOpenGLBuffer::IndexBuffer), 
+    m_tangentBuffer(QOpenGLBuffer::VertexBuffer), 
+    m_bitangentBuffer(QOpenGLBuffer::VertexBuffer), 
+    p_objectShader(nullptr), 
+    p_shadowShader(nullptr), 
+    m_streams(streams),
+    p_arena(std::move(arena)) {compileNodes(rootNode.get());};
+    
+    /**
+     * @brief Create an object whose buffer data is read from a mesh cache.
+     * @param rootNode The root node of the object.
+     * @param cache The mesh cache holding the buffer data.
+     */
+    Object(
+        std::unique_ptr<const Node> rootNode, 
+        std::unique_ptr<const MeshCache> cache
     ) : 
-    m_error(
-        !rootNode || !vertices || !normals || !textureUV || !indices ||
-        !tangents || !bitangents
-    ),
+    m_error(!rootNode || !cache),
     m_isInitialized(false),
-    p_rootNode(std::move(rootNode)), 
+    m_isPacked(false),
     m_vertexBuffer(QOpenGLBuffer::VertexBuffer), 
     m_normalBuffer(QOpenGLBuffer::VertexBuffer), 
     m_textureUVBuffer(QOpenGLBuffer::VertexBuffer), 
@@ -57,9 +118,7 @@ public:
     m_bitangentBuffer(QOpenGLBuffer::VertexBuffer), 
     p_objectShader(nullptr), 
     p_shadowShader(nullptr), 
-    p_vertices(std::move(vertices)), p_normals(std::move(normals)),
-    p_textureUV(std::move(textureUV)), p_indices(std::move(indices)),
-    p_tangents(std::move(tangents)), p_bitangents(std::move(bitangents)) {};
+    p_cache(std::move(cache)) {compileNodes(rootNode.get());};
     ~Object() {};
     
     /**
@@ -67,6 +126,13 @@ public:
      */
     virtual void initialize();
     
+    /**
+     * @brief Return the bounding box of the object in model coordinates.
+     */
+    virtual const BoundingBox * getBoundingBox() const {
+        return &m_boundingBox;
+    };
+    
     /**
      * @brief Draw the object.
      * @param view The view matrix.
@@ -96,10 +162,12 @@ public:
     
 private:
     /**
-     * @brief Draw the object using a given shader.
+     * @brief Push the draws of the object into the render queue using a given
+     * shader.
      * @details This function is used as the implementation of both the 
      * Object::render() and Object::renderShadow() functions since these two 
-     * functions perform the same task but using different shader program.
+     * functions perform the same task but using different shader program. 
+     * The draws are drawn when the render queue is submitted.
      * @param view The view matrix.
      * @param projection The projection matrix.
      * @param lightSpace The view and projection matrix of the light (used for 
@@ -130,30 +198,93 @@ private:
      */
     void createBuffers();
     
-private:
     /**
-     * @brief Compute the tangents and bitangents from the vertices and texture
-     * coordinates.
-     * @param[in] vertices The vertex data.
-     * @param[in] textureUV The texture coordinate data.
-     * @param[in] indices The index data.
-     * @param[out] tangents The tangent data.
-     * @param[out] bitangents The bitangent data.
-     */
-    static void getTangentsAndBitangents(
-        const QVector<float> & vertices, 
-        const QVector<QVector<float>> & textureUV,
-        const QVector<unsigned int> & indices, 
-        QVector<float> & tangents,
-        QVector<float> & bitangents
-    );
+     * @brief Create the interleaved vertex buffer of the packed vertex format.
+     * @return The size in bytes of the buffer.
+     */
+    int createPackedVertexBuffer();
+    
+    /**
+     * @brief Return the data used to fill a buffer at initialization and its
+     * size in bytes, either from the mesh cache or from the loaded data.
+     * @param stream The stream of the buffer.
+     */
+    std::pair<const void *, int> getBufferData(MeshCache::Stream stream) const;
     
 private:
     /**
-     * @typedef Container used to store meshes to draw later.
+     * @brief Settings of a render pass: selection of the levels of detail of
+     * the meshes and frustum culling.
+     */
+    struct RenderPass {
+        /** The view and projection matrix of the pass. */
+        QMatrix4x4 viewProjection;
+        /** The maximum projected error, in fraction of the target height. */
+        float maxError;
+        /** 
+         * Test the nodes and meshes against the near plane of the frustum. 
+         * The shadow casters between the light and the near plane are kept.
+         */
+        bool nearPlane;
+        /** The statistics of the culling of the pass. */
+        CullingStats * stats;
+    };
+    
+    /**
+     * @brief Node of the object flattened in depth-first order: the 
+     * descendants of a node follow it in the array.
+     */
+    struct NodeRecord {
+        /** The transformation from the node to the model coordinates. */
+        QMatrix4x4 transformation;
+        /** 
+         * The bounding box of the meshes of the node and of its descendants,
+         * in the coordinates of the node.
+         */
+        BoundingBox boundingBox;
+        /** The first mesh of the node in m_meshes. */
+        unsigned int firstMesh;
+        /** The number of meshes of the node. */
+        unsigned int numMeshes;
+        /** The number of meshes of the node and of its descendants. */
+        unsigned int numSubtreeMeshes;
+        /** The index following the last descendant of the node. */
+        unsigned int end;
+    };
+    
+    /**
+     * @brief Flatten the nodes into m_nodes and m_meshes, and compute the 
+     * bounding box of the object.
+     * @param rootNode The root node of the object.
+     */
+    void compileNodes(const Node * rootNode);
+    
+    /**
+     * @brief Append a node and its descendants to m_nodes in depth-first 
+     * order.
+     * @param node The node to append.
+     * @param parentTransformation The transformation from the parent of the 
+     * node to the model coordinates.
+     */
+    void compileNode(const Node & node, const QMatrix4x4 & parentTransformation);
+    
+    /**
+     * Maximum projected error of the levels of detail of the render and 
+     * shadow passes.
+     */
+    static float m_lodMaxError;
+    static float m_shadowLodMaxError;
+    
+    /**
+     * Layout of the vertex data of the objects initialized afterwards.
+     */
+    static VertexFormat m_vertexFormat;
+    
+    /**
+     * Shader programs shared by the objects, released with the last object.
      */
-    typedef std::multimap<float, std::pair<QMatrix4x4, const Mesh *>> 
-        MeshesToDrawLater;
+    static std::weak_ptr<ObjectShader> m_sharedObjectShader;
+    static std::weak_ptr<ObjectShadowShader> m_sharedShadowShader;
     
     /**
      * Set to true if the model is not valid.
@@ -166,9 +297,30 @@ private:
     bool m_isInitialized;
     
     /**
-     * The root node of the model.
+     * Set to true if the vertex data is stored in the packed format.
+     */
+    bool m_isPacked;
+    
+    /**
+     * The nodes of the model in depth-first order.
+     */
+    std::vector<NodeRecord> m_nodes;
+    
+    /**
+     * The meshes of the nodes, in the order of the nodes.
+     */
+    std::vector<std::shared_ptr<const Mesh>> m_meshes;
+    
+    /**
+     * The world matrices of the nodes, computed from the model matrix when it
+     * changes.
+     */
+    std::vector<QMatrix4x4> m_worldMatrices;
+    
+    /**
+     * The bounding box of the model in model coordinates.
      */
-    std::unique_ptr<const Node> p_rootNode;
+    BoundingBox m_boundingBox;
     
     /**
      * Vertex Array Object containing all the buffer needed to render the 
@@ -209,58 +361,31 @@ private:
     /**
      * The shader used to render the scene.
      */
-    std::unique_ptr<ObjectShader> p_objectShader;
+    std::shared_ptr<ObjectShader> p_objectShader;
     
     /**
      * The shader used to render the object when computing the shadow map.
      */
-    std::unique_ptr<ObjectShadowShader> p_shadowShader;
-    
-    /**
-     * Pointer to the vertices data used to fill the vertex buffer at 
-     * initialization. This pointer is reset after initialization.
-     */
-    std::unique_ptr<QVector<float>> p_vertices;
-    
-    /**
-     * Pointer to the vertices data used to fill the normal buffer at 
-     * initialization. This pointer is reset after initialization.
-     */
-    std::unique_ptr<QVector<float>> p_normals;
-    
-    /**
-     * Pointer to the vertices data used to fill the texture buffer at 
-     * initialization. This pointer is reset after initialization.
-     * @details The textureUV is a vector of vectof of float. The vector of 
-     * float corresponds to the i-th UV channel of all the vertices. Thus, the 
-     * vector of vector of float corresponds to all the UV channels of all 
-     * vertices. 
-     * Other implementation of the textureUV could be:
-     * - a vector of float which combines all the data for each vertices.
-     * - a vector of vector of float which corresponds to a list of points with 
-     *   different dimension depending of the number of UV channel of each mesh.
-     * The reason the texture UV is implemented this way is because it allowed 
-     * to easily resize all the textureUV to use the same number of UV channels.
-     */
-    std::unique_ptr<QVector<QVector<float>>> p_textureUV;
+    std::shared_ptr<ObjectShadowShader> p_shadowShader;
     
     /**
-     * Pointer to the vertices data used to fill the indices buffer at 
-     * initialization. This pointer is reset after initialization.
+     * Streams of the data used to fill the buffers at initialization. The 
+     * streams are reset after initialization.
      */
-    std::unique_ptr<QVector<unsigned int>> p_indices;
+    MeshStreams m_streams;
     
     /**
-     * Pointer to the tangents data used to fill the tangents buffer at 
-     * initialization. This pointer is reset after initialization.
+     * Arena holding the data of the streams. The arena is released after 
+     * initialization.
      */
-    std::unique_ptr<QVector<float>> p_tangents;
+    MeshBuilder::Arena p_arena;
     
     /**
-     * Pointer to the bitangents data used to fill the bitangents buffer at
-     * initialization. This pointer is reset after initialization.
+     * Pointer to the mesh cache holding the data used to fill the buffers at 
+     * initialization when the object is loaded from the cache. This pointer 
+     * is reset (and the cache file unmapped) after initialization.
      */
-    std::unique_ptr<QVector<float>> p_bitangents;
+    std::unique_ptr<const MeshCache> p_cache;
 };
 
 
@@ -276,34 +401,32 @@ private:
 class Object::Node {
 public:
     /**
-     * @brief Node constructor.
+     * @brief Node constructor. The bounding box of the node is computed from
+     * the meshes and the children.
      * @param name The name of the node.
      */
     Node(const QString name, const QMatrix4x4 transformation, 
          const std::vector<std::shared_ptr<const Mesh>> meshes,
-         std::vector<std::unique_ptr<const Node>> children)
-    : m_name(name), m_transformation(transformation), m_meshes(meshes) ,
-    m_children(std::move(children)) {};
+         std::vector<std::unique_ptr<const Node>> children);
     ~Node() {};
     
     const QString getName() const {return m_name;};
     
+    const QMatrix4x4 & getTransformation() const {return m_transformation;};
+    
     /**
-     * @brief Draw the node and its children.
-     * @param model The model matrix use to position the node. Note that the 
-     * transformation stored in the node is applied for positioning the node.
-     * @param view The view matrix.
-     * @param projection The projection matrix.
-     * @param lightSpace The view and projection matrix of the light (used for 
-     * shadow mapping).
-     * @param drawLaterMeshes Container of meshes to draw later (transparent
-     * meshes).
-     * @param objectShader The shader used to render the object.
+     * @brief Return the bounding box of the meshes of the node and of its 
+     * children, in the coordinates of the node.
      */
-    void drawNode(const QMatrix4x4 & model, const QMatrix4x4 & view, 
-                  const QMatrix4x4 & projection, const QMatrix4x4 lightSpace[], 
-                  MeshesToDrawLater & drawLaterMeshes, 
-                  ObjectShader * objectShader) const;
+    const BoundingBox & getBoundingBox() const {return m_boundingBox;};
+    
+    const std::vector<std::shared_ptr<const Mesh>> & getMeshes() const {
+        return m_meshes;
+    };
+    
+    const std::vector<std::unique_ptr<const Node>> & getChildren() const {
+        return m_children;
+    };
     
 private:
     /**
@@ -325,6 +448,12 @@ private:
      * The children of this node.
      */
     std::vector<std::unique_ptr<const Node>> m_children;
+    
+    /**
+     * The bounding box of the meshes of the node and of its children, in the
+     * coordinates of the node.
+     */
+    BoundingBox m_boundingBox;
 };
 
 
@@ -341,27 +470,69 @@ private:
  */
 class Object::Mesh {
 public:
+    /**
+     * @brief Level of detail of the mesh: a range of the index buffer drawing
+     * a simplified version of the mesh with its vertices.
+     */
+    struct Level {
+        /** Number of indices. */
+        unsigned int count;
+        /** Offset in bytes in the index buffer of the first index. */
+        unsigned int offset;
+        /** Geometric error from the full-detail mesh, in local units. */
+        float error;
+    };
+    
     /**
      * @brief Constructor of the mesh.
      * @param name The name of the mesh.
      * @param count The number of indices in the mesh.
-     * @param offset The offset of the first mesh index in the index buffer.
+     * @param offset The offset in bytes of the first mesh index in the index 
+     * buffer.
+     * @param boundingBox The bounding box of the vertices of the mesh.
+     * @param baseVertex The first vertex of the mesh, added to the indices.
+     * @param indexSize The size in bytes of an index: 2 or 4.
      * @param material The material used by the mesh.
      */
     Mesh(const QString name, const unsigned int count, 
-         const unsigned int offset, 
+         const unsigned int offset, const BoundingBox boundingBox,
+         const unsigned int baseVertex, const unsigned int indexSize,
+         const std::shared_ptr<const Material> material
+    ) : m_name(name), m_levels(1, Level{count, offset, 0.0f}), 
+    m_boundingBox(boundingBox), m_center(boundingBox.getCenter()), 
+    m_radius(boundingBox.getRadius()), m_baseVertex(baseVertex), 
+    m_indexSize(indexSize), m_material(material) {};
+    
+    /**
+     * @brief Constructor of a mesh with levels of detail.
+     * @param name The name of the mesh.
+     * @param levels The levels of detail, from the full-detail mesh to the 
+     * coarsest one.
+     * @param boundingBox The bounding box of the vertices of the mesh.
+     * @param baseVertex The first vertex of the mesh, added to the indices.
+     * @param indexSize The size in bytes of an index: 2 or 4.
+     * @param material The material used by the mesh.
+     */
+    Mesh(const QString name, const std::vector<Level> levels, 
+         const BoundingBox boundingBox,
+         const unsigned int baseVertex, const unsigned int indexSize,
          const std::shared_ptr<const Material> material
-    ) : m_name(name), m_indexCount(count), m_indexOffset(offset), 
-    m_material(material) {};
+    ) : m_name(name), m_levels(levels), m_boundingBox(boundingBox), 
+    m_center(boundingBox.getCenter()), m_radius(boundingBox.getRadius()),
+    m_baseVertex(baseVertex), m_indexSize(indexSize), m_material(material) {};
     ~Mesh() {};
     
     /**
-     * @brief Set material uniform and draw the mesh.
-     * @param objectShader The shader used to render the object.
-     * @remark This function does not set the uniform for the model, view, and
-     * projection matrices. It only set the uniforms related to the material.
+     * @brief Select the coarsest level of detail whose error projected on the
+     * render target is below a maximum.
+     * @param modelViewProjection The model, view, and projection matrix of 
+     * the mesh.
+     * @param maxError The maximum projected error, in fraction of the height 
+     * of the render target.
+     * @return The level of detail.
      */
-    void drawMesh(ObjectShader * objectShader) const;
+    unsigned int selectLevel(const QMatrix4x4 & modelViewProjection, 
+                             float maxError) const;
     
     /**
      * @brief Check if the material applied to the node is opaque.
@@ -369,6 +540,26 @@ public:
      */
     bool isOpaque() const {return (m_material->getAlpha() == 1.0f);};
     
+    const QString getName() const {return m_name;};
+    
+    unsigned int getIndexCount() const {return m_levels.front().count;};
+    
+    unsigned int getIndexOffset() const {return m_levels.front().offset;};
+    
+    const std::vector<Level> & getLevels() const {return m_levels;};
+    
+    const BoundingBox & getBoundingBox() const {return m_boundingBox;};
+    
+    const QVector3D & getCenter() const {return m_center;};
+    
+    float getRadius() const {return m_radius;};
+    
+    unsigned int getBaseVertex() const {return m_baseVertex;};
+    
+    unsigned int getIndexSize() const {return m_indexSize;};
+    
+    std::shared_ptr<const Material> getMaterial() const {return m_material;};
+    
 private:
     /**
      * The name of the mesh.
@@ -376,14 +567,33 @@ private:
     const QString m_name;
     
     /**
-     * Number of indices used by the vertices of the mesh.
+     * Ranges of the index buffer of the levels of detail. The first level is
+     * the full-detail mesh.
+     */
+    const std::vector<Level> m_levels;
+    
+    /**
+     * Bounding box of the mesh used to cull the mesh.
+     */
+    const BoundingBox m_boundingBox;
+    
+    /**
+     * Bounding sphere of the mesh used to select the level of detail, 
+     * centered on the bounding box.
+     */
+    const QVector3D m_center;
+    const float m_radius;
+    
+    /**
+     * First vertex of the mesh in the vertex buffers, added to the indices.
      */
-    const unsigned int m_indexCount;
+    const unsigned int m_baseVertex;
     
     /**
-     * Offset in the index buffer of the first mesh index.
+     * Size in bytes of an index: 2 if the mesh has less than 65537 vertices,
+     * 4 otherwise.
      */
-    const unsigned int m_indexOffset;
+    const unsigned int m_indexSize;
     
     /**
      * Pointer to the material of the mesh.
@@ -418,6 +628,7 @@ public:
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
+#include <QDataStream>
 
 
 /// Object Assimp loader
@@ -425,6 +636,8 @@ public:
  * @brief Load an object.
  * @author Louis Filipozzi
  * @details The construction of the object is dealt with the builder pattern.
+ * The loader does not use OpenGL: it can be run by a worker thread, the object
+ * being then initialized by the thread of the OpenGL context.
  */
 class Object::Loader : public Object::IBuilder {
 public:
@@ -440,29 +653,80 @@ public:
     virtual bool build();
     virtual std::unique_ptr<Object>  getObject();
     
+    /**
+     * @brief Enable the optimization of the meshes of the models loaded 
+     * afterwards: the triangles are reordered for the post-transform cache and
+     * to reduce the overdraw, then the vertices are reordered in the order of 
+     * their first use. The optimized meshes are stored in the mesh cache.
+     */
+    static void setMeshOptimization(bool optimize) {m_optimizeMeshes = optimize;}
+    
+    /**
+     * @brief Enable the generation of levels of detail for the meshes of the
+     * models loaded afterwards. The meshes are simplified by quadric error 
+     * edge collapses and the levels are stored in the mesh cache.
+     */
+    static void setLodGeneration(bool generate) {m_generateLods = generate;}
+    
 private:
     /**
-     * @brief Process Assimp material into a Material. 
+     * @brief Description of a material, as read from the model file or from 
+     * the mesh cache.
+     */
+    struct MaterialInfo {
+        QString name;
+        /** False if the shading model is not supported. */
+        bool isSupported = false;
+        QVector3D ambient;
+        QVector3D diffuse;
+        QVector3D specular;
+        float shininess = 0.0f;
+        float alpha = 1.0f;
+        /** Path to the texture relative to the texture directory. */
+        QString diffuseTexture;
+        /** Path to the texture relative to the texture directory. */
+        QString normalTexture;
+    };
+    
+    /**
+     * @brief Process Assimp material into a MaterialInfo. 
      * @details Check if the lighting model is supported and retrieve material
      * information (color, shininess, ...).
      * @param mater The Assimp material.
+     * @return The material information.
+     */
+    MaterialInfo processMaterial(const aiMaterial * material);
+    
+    /**
+     * @brief Create a Material and load its textures.
+     * @param info The material information.
      * @param textureDir The directory containing the textures to load.
-     * @return The processed material.
+     * @return The material.
      */
-    std::shared_ptr<const Material> processMaterial(const aiMaterial * material,
-                                              const QString textureDir);
+    std::shared_ptr<const Material> createMaterial(const MaterialInfo & info,
+                                                   const QString textureDir);
     
     /**
-     * @brief Loads the textures of the material 'material' and of type
-     * 'type'.
+     * @brief Return the path of the first texture of the material 'material' 
+     * and of type 'type'.
      * @param material The Assimp material.
      * @param type The type of texture.
+     * @return The path to the texture, empty if the material has no texture 
+     * of this type.
+     */
+    QString getTexturePath(const aiMaterial * material, 
+                           const Texture::Type type);
+    
+    /**
+     * @brief Load a texture of a material.
+     * @param path The path to the texture relative to textureDir.
+     * @param type The type of texture.
      * @param textureDir The folder containing the texture files.
-     * @return Vector of pointer to the material textures.
+     * @return Pointer to the texture, nullptr if path is empty.
      */
-    std::vector<Texture *> loadMaterialTextures(const aiMaterial * material,
-                                   const Texture::Type type,
-                                   const QString textureDir);
+    Texture * loadMaterialTexture(const QString & path, 
+                                  const Texture::Type type,
+                                  const QString textureDir);
     
     /**
      * @brief Process the Assimp mesh into a Mesh.
@@ -470,28 +734,36 @@ private:
      * texture coordinate buffer of the object, and create the meshes.
      * @param[in] aiMesh The Assimp mesh.
      * @param[in] materials The vector of the processed materials of the object.
-     * @param[out] vertices The data used to fill the vertex buffer.
-     * @param[out] normals The data used to fill the normal buffer.
-     * @param[out] textureUV The data used to fill the texture coordinates 
-     * buffer.
-     * @param[out] indices The data used to fill the index buffer.
-     * @param[out] tangents The data used to fill the tangent buffer.
-     * @param[out] bitangents The data used to fill the bitangent buffer.
-     * @remark The std::unique_ptr vertices, normals, textureUV, and indices are
-     * passed by reference as we don't want to give ownership of the pointer to 
-     * the function, but only perform some action to change its content
+     * @param[in,out] builder The builder in which the vertices and indices of 
+     * the mesh are written.
      * @return The processed mesh.
      */
     std::shared_ptr<const Mesh> processMesh(const aiMesh * mesh,
             const std::vector<std::shared_ptr<const Material>> & materials,
-            std::unique_ptr<QVector<float>> & vertices,
-            std::unique_ptr<QVector<float>> & normals,
-            std::unique_ptr<QVector<QVector<float>>> & textureUV,
-            std::unique_ptr<QVector<unsigned int>> & indices,
-            std::unique_ptr<QVector<float>> & tangents,
-            std::unique_ptr<QVector<float>> & bitangents
+            MeshBuilder & builder
     );
     
+    /**
+     * @brief Optimize the order of the triangles and vertices of each mesh and
+     * report the average cache miss ratio (ACMR) before and after.
+     * @param streams The streams of the meshes, reordered in place.
+     * @param scene The Assimp scene.
+     * @param meshes The processed meshes of the scene.
+     */
+    void optimizeMeshes(const MeshStreams & streams, const aiScene * scene,
+            const std::vector<std::shared_ptr<const Mesh>> & meshes) const;
+    
+    /**
+     * @brief Generate the levels of detail of each mesh.
+     * @param builder The builder in which the indices of the levels are 
+     * written.
+     * @param scene The Assimp scene.
+     * @param[in,out] meshes The processed meshes of the scene, replaced by 
+     * meshes with levels of detail.
+     */
+    void generateLods(MeshBuilder & builder, const aiScene * scene,
+            std::vector<std::shared_ptr<const Mesh>> & meshes) const;
+    
     /**
      * @brief Process the Assimp node into a Node.
      * @param[in] node The Assimp node.
@@ -503,7 +775,67 @@ private:
             const aiScene * scene, 
             const std::vector<std::shared_ptr<const Mesh>> & sceneMeshes);
     
+    /**
+     * @brief Build the object from the mesh cache.
+     * @param key The key of the mesh cache of the model.
+     * @return Return false if there is no valid cache for the key.
+     */
+    bool loadCache(const QByteArray & key);
+    
+    /**
+     * @brief Write the mesh cache of the model.
+     * @param key The key of the mesh cache of the model.
+     * @param scene The Assimp scene.
+     * @param materials The information of the materials of the scene.
+     * @param meshes The processed meshes of the scene.
+     * @param object The object whose buffer data is written.
+     */
+    static void saveCache(const QByteArray & key, const aiScene * scene, 
+            const std::vector<MaterialInfo> & materials,
+            const std::vector<std::shared_ptr<const Mesh>> & meshes,
+            const Object & object);
+    
+    /**
+     * @brief Write a node and its children in the metadata of the mesh cache.
+     */
+    static void writeNode(QDataStream & stream, const aiNode * node);
+    
+    /**
+     * @brief Read a node and its children from the metadata of the mesh 
+     * cache.
+     * @return The node, nullptr if the metadata is corrupted.
+     */
+    static std::unique_ptr<const Node> readNode(QDataStream & stream, 
+            const std::vector<std::shared_ptr<const Mesh>> & meshes);
+    
 private:
+    /**
+     * The flags used to import the models with Assimp.
+     */
+    static const unsigned int c_importFlags;
+    
+    /**
+     * Maximum number of levels of detail generated in addition to the 
+     * full-detail mesh.
+     */
+    static const unsigned int c_maxLodLevels = 4;
+    
+    /**
+     * Maximum geometric error of the coarsest level of detail, in fraction of
+     * the radius of the bounding sphere of the mesh.
+     */
+    static const float c_maxLodError;
+    
+    /**
+     * Enable the optimization of the meshes.
+     */
+    static bool m_optimizeMeshes;
+    
+    /**
+     * Enable the generation of levels of detail.
+     */
+    static bool m_generateLods;
+    
     /**
      * The path to the object to load.
      */
@@ -562,14 +894,60 @@ private:
      */
     static bool qStringToQVector4D(const QString & string, QVector4D & vec);
     
+    /**
+     * @brief Count the numbers separated by white spaces of a string.
+     */
+    static std::size_t countNumbers(const QString & string);
+    
     template<class T>
     /**
-     * @brief Convert a QString to a QVector
-     * @param[in] string The string to convert.
-     * @param[out] vec The vector.
-     * @return Return true if the string is converted to a QVector successfully.
+     * @brief Parse the numbers separated by white spaces of a string, without
+     * allocating memory per number.
+     * @param[in] string The string to parse.
+     * @param[out] values The parsed numbers (float or unsigned int).
+     * @param[in] count The number of numbers to parse.
+     * @return Return true if the string contains exactly count numbers.
+     */
+    static bool parseNumbers(const QString & string, T * values, 
+                             std::size_t count);
+    
+    template<class T>
+    /**
+     * @brief Read a stream of a mesh element into the buffer data. The stream 
+     * is either a text array or, with the attribute encoding="base64", the 
+     * base64 of the little-endian binary array, optionally compressed with 
+     * zlib (compression="zlib").
+     * @param[in] elmt The DOM element of the stream.
+     * @param[out] values The values of the stream (float or unsigned int).
+     * @param[in] count The number of values of the stream.
+     * @return Return true if the stream has exactly count values.
+     */
+    static bool readStream(const QDomElement & elmt, T * values, 
+                           std::size_t count);
+    
+    /**
+     * @brief Centerline of a road resampled at a constant spacing.
      */
-    static bool qStringToQVector(const QString & string, QVector<T> & vec);
+    struct Centerline {
+        /** Points of the centerline. */
+        std::vector<QVector3D> points;
+        /** Distance along the centerline of each point. */
+        std::vector<float> distances;
+        /** Number of segments of each chunk. */
+        std::size_t chunkSegments = 1;
+        
+        /** Number of chunks of the road. */
+        std::size_t numChunks() const {
+            return (points.size() - 2) / chunkSegments + 1;
+        }
+        /** Number of vertices of the road: two per point, the points shared
+         * by two chunks being duplicated. */
+        std::size_t numVertices() const {
+            return 2 * (points.size() + numChunks() - 1);
+        }
+        /** Number of indices of the road. */
+        std::size_t numIndices() const {return 6 * (points.size() - 1);}
+    };
     
     /**
      * @brief Process material. 
@@ -578,6 +956,16 @@ private:
      */
     std::shared_ptr<const Material> processMaterial(const QDomElement & elmt);
     
+    /**
+     * @brief Read the streams of a mesh element into the buffer data.
+     * @param elmt The DOM element.
+     * @param first The first vertex of the mesh.
+     * @param range The range of the indices of the mesh.
+     * @return Return true if the streams are valid.
+     */
+    bool readMesh(const QDomElement & elmt, std::size_t first, 
+                  const IndexRange & range);
+    
     /**
      * @brief Process geometrical shape (e.g. plane) to create a mesh.
      * @param elmt The DOM element.
@@ -585,6 +973,28 @@ private:
      */
     std::shared_ptr<const Mesh> processShape(const QDomElement & elmt);
     
+    /**
+     * @brief Read the centerline of a road element, either from its points or
+     * from the chassis positions of a binary trajectory file, and resample it
+     * at the spacing of the road.
+     * @param[in] elmt The DOM element.
+     * @param[out] centerline The centerline.
+     * @return Return true if the centerline has at least two points.
+     */
+    static bool readCenterline(const QDomElement & elmt, 
+                               Centerline & centerline);
+    
+    /**
+     * @brief Process a road element. The road ribbon is split into chunks of
+     * constant length generated on the thread pool, each chunk being a mesh
+     * with its own bounds.
+     * @param elmt The DOM element.
+     * @return The meshes of the chunks.
+     */
+    std::vector<std::shared_ptr<const Mesh>> processRoad(
+        const QDomElement & elmt
+    );
+    
     /**
      * @brief Process the node
      * @param elmt The DOM element.
@@ -611,14 +1021,15 @@ private:
     std::map<QString, std::shared_ptr<const Material>> m_materials;
     
     /**
-     * Pointer to buffer data.
+     * Centerlines of the road elements, read before the buffer data is
+     * reserved.
+     */
+    std::vector<std::pair<QDomElement, Centerline>> m_roads;
+    
+    /**
+     * Builder of the buffer data.
      */
-    std::unique_ptr<QVector<float>> p_vertices;
-    std::unique_ptr<QVector<float>> p_normals;
-    std::unique_ptr<QVector<QVector<float>>> p_textureUV;
-    std::unique_ptr<QVector<unsigned int>> p_indices;
-    std::unique_ptr<QVector<float>> p_tangents;
-    std::unique_ptr<QVector<float>> p_bitangents;
+    std::unique_ptr<MeshBuilder> p_builder;
 };
 
 
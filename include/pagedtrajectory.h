@@ -0,0 +1,156 @@
+#ifndef PAGEDTRAJECTORY_H
+#define PAGEDTRAJECTORY_H
+
+#include "trajectory.h"
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/// Paged trajectory
+/**
+ * @brief Trajectory streamed from a binary trajectory file.
+ * @details The trajectory is split into chunks of consecutive samples. Only a
+ * limited number of chunks is resident: the chunk containing the requested
+ * time and the following one, which is prefetched, plus the most recently used
+ * chunks. The chunks are read by a background thread so that the render loop
+ * never waits for the disk: while a chunk is loading, getSample() returns false
+ * and the caller keeps the previous position.
+ */
+class PagedTrajectory : public TrajectorySource {
+public:
+    /**
+     * @brief Open a binary trajectory file.
+     * @param fileName The path to the binary trajectory file.
+     * @param chunkSize The number of samples per chunk.
+     * @param maxChunks The maximum number of resident chunks.
+     * @return The trajectory, nullptr if the file is not a valid trajectory
+     * file.
+     */
+    static std::unique_ptr<PagedTrajectory> open(
+        const QString & fileName, std::size_t chunkSize = 4096,
+        std::size_t maxChunks = 16
+    );
+
+    ~PagedTrajectory() override;
+
+    PagedTrajectory(const PagedTrajectory &) = delete;
+    PagedTrajectory & operator=(const PagedTrajectory &) = delete;
+
+    bool isEmpty() const override {return m_numSamples == 0;}
+    float firstTime() const override {return m_firstTime;}
+    float finalTime() const override {return m_finalTime;}
+    bool getSample(float time, float row[NumChannels]) override;
+
+private:
+    /**
+     * @brief Chunk of consecutive samples stored column by column. A chunk
+     * also contains the first sample of the next chunk so that any time
+     * between two samples can be interpolated from a single chunk.
+     */
+    struct Chunk {
+        std::size_t size;
+        std::vector<float> data;
+
+        const float * column(unsigned int channel) const {
+            return data.data() + channel * size;
+        }
+    };
+
+    PagedTrajectory(const QString & fileName, std::size_t chunkSize,
+                    std::size_t maxChunks);
+
+    /**
+     * @brief Return the index of the chunk containing the last sample which
+     * occurs before or at the requested time.
+     * @param time The time.
+     */
+    std::size_t findChunk(float time) const;
+
+    /**
+     * @brief Request the loading of a chunk by the background thread. Must be
+     * called with m_mutex locked.
+     * @param chunk The index of the chunk.
+     * @param urgent If true, the chunk is needed now: it is loaded before the
+     * prefetched chunks, which are discarded.
+     */
+    void request(std::size_t chunk, bool urgent);
+
+    /**
+     * @brief Mark a chunk as the most recently used one. Must be called with
+     * m_mutex locked.
+     * @param chunk The index of the chunk.
+     */
+    void touch(std::size_t chunk);
+
+    /**
+     * @brief Read a chunk from the file.
+     * @param file The binary trajectory file.
+     * @param chunk The index of the chunk.
+     * @return The chunk, nullptr if an error happened.
+     */
+    std::shared_ptr<Chunk> readChunk(QFile & file, std::size_t chunk) const;
+
+    /**
+     * @brief Loop of the background thread loading the requested chunks.
+     */
+    void run();
+
+private:
+    QString m_fileName;
+    std::size_t m_numSamples;
+    std::size_t m_columnStride;
+    quint64 m_dataOffset;
+    std::size_t m_chunkSize;
+    std::size_t m_maxChunks;
+    float m_firstTime;
+    float m_finalTime;
+
+    /**
+     * Time of the first sample of each chunk.
+     */
+    std::vector<float> m_chunkTimes;
+
+    /**
+     * Resident chunks.
+     */
+    std::map<std::size_t, std::shared_ptr<Chunk>> m_chunks;
+
+    /**
+     * Resident chunks, from the most to the least recently used.
+     */
+    std::list<std::size_t> m_recentChunks;
+
+    /**
+     * Chunks needed for rendering, waiting to be loaded by the background
+     * thread.
+     */
+    std::deque<std::size_t> m_requests;
+
+    /**
+     * Chunks prefetched by the background thread once m_requests is empty.
+     */
+    std::deque<std::size_t> m_prefetches;
+
+    /**
+     * True while the background thread reads the chunk m_loadingChunk.
+     */
+    bool m_isLoading;
+    std::size_t m_loadingChunk;
+
+    /**
+     * Chunk and index in the chunk of the sample found by the last call to 
+     * getSample().
+     */
+    std::size_t m_cursorChunk;
+    std::size_t m_cursor;
+
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+};
+
+#endif // PAGEDTRAJECTORY_H
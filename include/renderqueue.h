@@ -0,0 +1,254 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "shaderprogram.h"
+#include "material.h"
+#include "light.h"
+#include "constants.h"
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class QOpenGLFunctions_3_3_Core;
+
+/// Render queue
+/**
+ * @brief Queue of the draws of a render pass, sorted to reduce the changes of
+ * the OpenGL state.
+ * @details The objects push their draws into the queue instead of drawing
+ * them. When the pass is submitted, the draws are sorted by a 64-bit key and
+ * the shader program, the VAO and the material are only set when they differ
+ * from the ones of the previous draw. The consecutive draws of the same range
+ * of indices with the same state, e.g. the wheels of a vehicle or the copies
+ * of a referenced object, are drawn by one instanced draw call: the model
+ * matrices are given to the shaders by per-instance vertex attributes.
+ *
+ * The key of an opaque draw is, from the most significant bits: the pass
+ * (2 bits), the shader program (6 bits), the VAO (12 bits), the material
+ * (12 bits), the range of indices (8 bits) and the depth (24 bits), so that
+ * the draws sharing a state are grouped, the instances of a mesh follow each
+ * other, and they are drawn front to back. The transparent draws of all the
+ * objects are kept in a separate list, radix sorted on their inverted depth
+ * and drawn back to front after the opaque ones.
+ */
+class RenderQueue {
+public:
+    /**
+     * @brief Pass of a draw, sorted in this order.
+     */
+    enum Pass {
+        Shadow,         /**< Draw into a shadow map. */
+        Opaque,         /**< Draw of an opaque mesh. */
+        Transparent     /**< Draw of a transparent mesh. */
+    };
+
+    /**
+     * @brief Draw of a range of the index buffer of a VAO.
+     */
+    struct Draw {
+        /** The shader program of the draw. */
+        ObjectShader * shader;
+        /** The vertex array object of the draw. */
+        QOpenGLVertexArrayObject * vao;
+        /** The material of the draw, nullptr for the shadow pass. */
+        const Material * material;
+        /** The index of the model matrix returned by pushMatrix(). */
+        unsigned int matrix;
+        /** The number of indices. */
+        unsigned int count;
+        /** The offset in bytes of the first index. */
+        unsigned int offset;
+        /** The vertex added to the indices. */
+        unsigned int baseVertex;
+        /** The size in bytes of an index: 2 or 4. */
+        unsigned int indexSize;
+    };
+
+    /**
+     * @brief Number of changes of the OpenGL state.
+     */
+    struct StateChanges {
+        /** Number of shader programs bound. */
+        unsigned int shaderBinds = 0;
+        /** Number of VAOs bound. */
+        unsigned int vaoBinds = 0;
+        /** Number of materials set. */
+        unsigned int materialChanges = 0;
+        /**
+         * Number of times the model matrices are set: uploaded as uniforms
+         * for each node before the queue, set as the range of the instance
+         * attributes for each draw call after sorting.
+         */
+        unsigned int matrixUploads = 0;
+    };
+
+    /**
+     * @brief Statistics of the passes submitted since the last reset.
+     */
+    struct Stats {
+        /** Number of draws submitted. */
+        unsigned int draws = 0;
+        /** Number of instanced draw calls issued for the draws. */
+        unsigned int drawCalls = 0;
+        /**
+         * State changes of the draws in the order they are pushed, as they
+         * were issued before the queue: the shader program and the VAO bound
+         * for each object and the material set for each draw.
+         */
+        StateChanges unsorted;
+        /** State changes of the sorted draws. */
+        StateChanges sorted;
+    };
+
+    /**
+     * @brief Return the queue of the application.
+     */
+    static RenderQueue & global();
+
+    /**
+     * @brief Start a color pass: the draws pushed are drawn with the light,
+     * the camera and the shadow cascades given.
+     * @param light The light.
+     * @param view The view matrix.
+     * @param projection The projection matrix.
+     * @param lightSpace The view and projection matrices of the cascades.
+     * @param cascades The distance of each cascade.
+     */
+    void begin(const CasterLight & light, const QMatrix4x4 & view,
+               const QMatrix4x4 & projection,
+               const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
+               const std::array<float,NUM_CASCADES+1> & cascades);
+
+    /**
+     * @brief Start a shadow pass: the draws pushed are drawn into the shadow
+     * map of a cascade.
+     * @param lightSpace The view and projection matrix of the cascade.
+     */
+    void beginShadow(const QMatrix4x4 & lightSpace);
+
+    /**
+     * @brief Store a model matrix for the draws of the pass.
+     * @return The index of the matrix, to be set in Draw::matrix.
+     */
+    unsigned int pushMatrix(const QMatrix4x4 & model);
+
+    /**
+     * @brief Add a draw to the pass.
+     * @param pass The pass of the draw.
+     * @param depth The distance of the draw to the camera, e.g. the w of its
+     * center in clip coordinates. Negative distances are clamped to 0.
+     * @param draw The draw.
+     */
+    void push(Pass pass, float depth, const Draw & draw);
+
+    /**
+     * @brief Sort and draw the draws of the pass, then clear the queue.
+     */
+    void submit();
+
+    /**
+     * @brief Release the buffer of the instances. Requires the OpenGL context
+     * to be current.
+     */
+    void cleanUp();
+
+    /**
+     * @brief Reset the statistics, e.g. at the beginning of a frame.
+     */
+    void resetStats() {m_stats = Stats();};
+
+    const Stats & getStats() const {return m_stats;};
+
+    /**
+     * @brief Compute the sort key of an opaque or shadow draw.
+     * @param pass The pass of the draw.
+     * @param shader The identifier of the shader program.
+     * @param vao The identifier of the VAO.
+     * @param material The identifier of the material.
+     * @param range The offset of the first index of the draw.
+     * @param depth The distance of the draw to the camera.
+     */
+    static std::uint64_t makeKey(Pass pass, unsigned int shader,
+                                 unsigned int vao, unsigned int material,
+                                 unsigned int range, float depth);
+
+private:
+    /**
+     * @brief Per-instance vertex attributes: the model matrix at the layout
+     * locations 5 to 8 and its normal matrix at the locations 9 to 11, both
+     * stored by columns.
+     */
+    struct Instance {
+        float model[16];
+        float normal[9];
+    };
+
+    RenderQueue() : m_instanceBuffer(QOpenGLBuffer::VertexBuffer) {};
+
+    /**
+     * @brief Count the state changes of the draws in the order they were
+     * pushed.
+     */
+    void countUnsorted();
+
+    /**
+     * @brief Sort the transparent draws from farthest to closest.
+     */
+    void sortTransparent();
+
+    /**
+     * @brief Point the instance attributes of the bound VAO to a range of
+     * the buffer of the instances.
+     * @param glFunctions The OpenGL functions of the current context.
+     * @param first The first instance of the range.
+     */
+    void setInstanceAttributes(QOpenGLFunctions_3_3_Core * glFunctions,
+                               std::size_t first);
+
+    /**
+     * Context of the pass: the light, the camera and the shadow cascades.
+     */
+    CasterLight m_light;
+    QMatrix4x4 m_view;
+    QMatrix4x4 m_projection;
+    std::array<QMatrix4x4,NUM_CASCADES> m_lightSpace;
+    std::array<float,NUM_CASCADES+1> m_cascades;
+    bool m_isShadow = false;
+
+    /**
+     * The draws of the pass in the order they were pushed, and the sort keys
+     * of the opaque and shadow draws with their index in m_draws.
+     */
+    std::vector<Draw> m_draws;
+    std::vector<std::pair<std::uint64_t, unsigned int>> m_keys;
+
+    /**
+     * The inverted quantized depth of the transparent draws with their index
+     * in m_draws, and the buffer of the radix sort. The containers are 
+     * cleared after each pass but keep their memory for the next frames.
+     */
+    std::vector<std::pair<std::uint32_t, unsigned int>> m_transparent;
+    std::vector<std::pair<std::uint32_t, unsigned int>> m_sortBuffer;
+
+    /**
+     * The indices in m_draws of the sorted draws.
+     */
+    std::vector<unsigned int> m_order;
+
+    /**
+     * The model matrices of the draws of the pass, and the instances of the
+     * sorted draws uploaded to the buffer of the instances.
+     */
+    std::vector<Instance> m_matrices;
+    std::vector<Instance> m_instances;
+    QOpenGLBuffer m_instanceBuffer;
+
+    Stats m_stats;
+};
+
+#endif // RENDERQUEUE_H
@@ -7,6 +7,7 @@
 #include "frame.h"
 #include "skybox.h"
 #include <memory>
+#include <set>
 #include "camera.h"
 #include "object.h"
 #include "constants.h"
@@ -21,6 +22,7 @@ class Scene {
 private:
     class Loader;
     class Node;
+    class Graph;
     
 public:
     Scene(unsigned int refreshRate, QString envFile, std::vector<QString> vehList);
@@ -134,6 +136,12 @@ public:
         m_vehFollow = id;
     };
     
+    /**
+     * @brief Report the number of objects and meshes drawn and culled by the 
+     * color pass once per second (i.e. every refresh rate frames).
+     */
+    static void setCullingReport(bool flag) {m_cullingReport = flag;}
+    
 private:
     /**
      * View matrix: transform from the world (scene) coordinates to the camera 
@@ -170,7 +178,7 @@ private:
     /**
      * The scene graph.
      */
-    std::unique_ptr<Node> p_graph;
+    std::unique_ptr<Graph> p_graph;
 
     /**
      * The vehicle.
@@ -247,10 +255,45 @@ private:
      */
     unsigned int m_numSnapshot;
     
+    /**
+     * Time-steps at which the vehicles are drawn in the current frame: the 
+     * current time-step followed by the snapshot time-steps in snapshot mode.
+     */
+    std::vector<float> m_frameTimesteps;
+    
+    /**
+     * Positions of each vehicle at each time-step of m_frameTimesteps, stored 
+     * as m_frameMatrices.
+     */
+    std::vector<VehiclePosition> m_framePositions;
+    
+    /**
+     * Model matrices of each vehicle at each time-step of m_frameTimesteps, 
+     * computed once per frame by update(). The matrices of the i-th vehicle at
+     * the k-th time-step are at index i * m_frameTimesteps.size() + k.
+     */
+    std::vector<VehicleGraphics::Matrices> m_frameMatrices;
+    
     /**
      * Vehicle to follow
      */
     unsigned int m_vehFollow;
+    
+    /**
+     * Number of frames rendered, used to report the culling statistics.
+     */
+    unsigned int m_numFrames;
+    
+    /**
+     * Report the culling statistics of the color pass.
+     */
+    static bool m_cullingReport;
+    
+    /**
+     * Number of vehicles updated by a task of the thread pool. The update of 
+     * a single vehicle is too short to be worth a task.
+     */
+    static const std::size_t c_vehicleBatchSize;
 };
 
 
@@ -337,27 +380,43 @@ private:
      */
     ABCObject * processReference(const QDomElement & elmt);
     
+    /**
+     * @brief Start loading the models of all the model elements of the 
+     * document on the thread pool, before the scene graph is built.
+     * @param domDoc The DOM document.
+     */
+    void loadModels(const QDomDocument & domDoc);
+    
 private:
     std::unique_ptr<Node> p_rootNode;
+    
+    /**
+     * Names of the models loaded by loadModels() which have not been added to
+     * the scene graph yet.
+     */
+    std::set<QString> m_loadingModels;
 };
 
 
 
 /// Node to represent a scene graph
 /**
- * @brief This class defines a node to represent a scene graph.
+ * @brief This class defines a node to represent a scene graph. The nodes are
+ * built by the loader and compiled into a Scene::Graph.
  */
 class Scene::Node {
 public:
     /**
      * @brief Node constructor
-     * @param parentWorldMatrix The world matrix of the parentWorldMatrix.
      * @param localMatrix The matrix to transform from the parent to this node.
+     * @param parentWorldMatrix The world matrix of the parent.
      */
     Node(
         const QMatrix4x4 & localMatrix = QMatrix4x4(), 
         const QMatrix4x4 & parentWorldMatrix = QMatrix4x4()
-    ) : m_worldMatrix(parentWorldMatrix * localMatrix) {};
+    ) : m_localMatrix(localMatrix), 
+    m_parentWorldMatrix(parentWorldMatrix),
+    m_worldMatrix(parentWorldMatrix * localMatrix) {};
     ~Node() {};
     
     /**
@@ -376,13 +435,79 @@ public:
         m_objects.push_back(object);
     };
     
+    /**
+     * @brief Return the local matrix.
+     */
+    QMatrix4x4 getLocalMatrix() const {return m_localMatrix;};
+    
+    /**
+     * @brief Return the world matrix of the parent.
+     */
+    QMatrix4x4 getParentWorldMatrix() const {return m_parentWorldMatrix;};
+    
     /**
      * @brief Return the world matrix.
      */
     QMatrix4x4 getWorldMatrix() const {return m_worldMatrix;};
     
+    const std::vector<std::unique_ptr<Node>> & getChildren() const {
+        return m_children;
+    };
+    
+    const std::vector<ABCObject *> & getObjects() const {return m_objects;};
+    
+private:
+    QMatrix4x4 m_localMatrix;
+    QMatrix4x4 m_parentWorldMatrix;
+    QMatrix4x4 m_worldMatrix;
+    std::vector<std::unique_ptr<Node>> m_children;
+    std::vector<ABCObject *> m_objects;
+};
+
+
+
+/// Compiled scene graph
+/**
+ * @brief Scene graph flattened into arrays of nodes and of draw records in 
+ * depth-first order, with the world matrices and the bounding boxes 
+ * precomputed.
+ * @details The descendants of a node follow it in the arrays: the render 
+ * passes stream over the arrays and skip the descendants of the nodes outside
+ * the frustum. When the local matrix of a node changes, the node is marked 
+ * dirty and update() only computes again the world matrices of the dirty 
+ * nodes and of their descendants, and the bounding boxes of their ancestors.
+ */
+class Scene::Graph {
+public:
+    /**
+     * @brief Compile a scene graph.
+     * @param root The root node of the scene graph.
+     */
+    Graph(const Node & root);
+    ~Graph() {};
+    
+    /**
+     * @brief Return the number of nodes. The root node is the node 0.
+     */
+    std::size_t getNumNodes() const {return m_nodes.size();};
+    
+    /**
+     * @brief Set the local matrix of a node and mark it dirty. The local 
+     * matrix of the root node is relative to the world matrix of the parent 
+     * of the root node given to the loader.
+     * @param node The index of the node in depth-first order.
+     * @param localMatrix The matrix to transform from the parent to the node.
+     */
+    void setLocalMatrix(std::size_t node, const QMatrix4x4 & localMatrix);
+    
+    /**
+     * @brief Compute the world matrices and the bounding boxes of the dirty 
+     * nodes.
+     */
+    void update();
+    
     /**
-     * @brief Render the node and all its descendants.
+     * @brief Render the objects inside the view frustum.
      * @param view The view matrix.
      * @param projection The projection matrix.
      * @param lightSpace The view and projection matrix of the light (used for 
@@ -397,16 +522,111 @@ public:
     );
     
     /**
-     * @brief Render the shadow of the node and of all its descendants.
+     * @brief Render the shadow of the objects inside the frustum of a cascade,
+     * extended toward the light.
      * @param lightSpace The view and projection matrix of the light (used for 
      * shadow mapping).
      */
     void renderShadow(const QMatrix4x4 & lightSpace);
     
 private:
-    QMatrix4x4 m_worldMatrix;
-    std::vector<std::unique_ptr<Node>> m_children;
-    std::vector<ABCObject *> m_objects;
+    /**
+     * @brief Node of the graph.
+     */
+    struct NodeRecord {
+        /** The matrix to transform from the parent to the node. */
+        QMatrix4x4 localMatrix;
+        /** The world matrix of the node. */
+        QMatrix4x4 worldMatrix;
+        /** 
+         * The bounding box of the objects of the node and of its descendants,
+         * in world coordinates.
+         */
+        BoundingBox boundingBox;
+        /** 
+         * Set to false if the bounds of an object of the node or of its 
+         * descendants are not known: the node is then never skipped.
+         */
+        bool isBounded;
+        /** Set to true if the local matrix of the node has changed. */
+        bool isDirty;
+        /** The index of the parent (the root node is its own parent). */
+        std::size_t parent;
+        /** The index following the last descendant of the node. */
+        std::size_t end;
+        /** The first draw record of the node. */
+        std::size_t firstDraw;
+        /** The draw record following the draw records of the node. */
+        std::size_t endDraw;
+        /** The draw record following the draw records of the descendants. */
+        std::size_t endSubtreeDraw;
+    };
+    
+    /**
+     * @brief Object drawn by a node.
+     */
+    struct DrawRecord {
+        /** The object. */
+        ABCObject * object;
+        /** The world matrix of the object, i.e. of its node. */
+        QMatrix4x4 worldMatrix;
+        /** The bounding box of the object in world coordinates. */
+        BoundingBox boundingBox;
+        /** Set to false if the bounds of the object are not known. */
+        bool isBounded;
+    };
+    
+    /**
+     * @brief Append a node and its descendants in depth-first order.
+     * @param node The node to append.
+     * @param parent The index of the parent.
+     */
+    void compileNode(const Node & node, std::size_t parent);
+    
+    /**
+     * @brief Compute the world matrix and the bounding boxes of the draw 
+     * records of a node from the world matrix of its parent, or from 
+     * m_rootParentMatrix for the root node.
+     */
+    void updateWorldMatrix(std::size_t node);
+    
+    /**
+     * @brief Compute the bounding box of a node from its draw records and its
+     * children.
+     */
+    void updateBoundingBox(std::size_t node);
+    
+    /**
+     * @brief Call a function for each draw record inside the frustum.
+     * @param frustum The frustum in world coordinates.
+     * @param stats The statistics of the culling of the pass.
+     * @param draw The function called with each draw record.
+     */
+    template<class Draw>
+    void forEachVisible(
+        const Frustum & frustum, CullingStats & stats, Draw draw
+    );
+    
+    /**
+     * The nodes in depth-first order.
+     */
+    std::vector<NodeRecord> m_nodes;
+    
+    /**
+     * The objects of the nodes, in the order of the nodes.
+     */
+    std::vector<DrawRecord> m_draws;
+    
+    /**
+     * The world matrix of the parent of the root node, from which the world 
+     * matrix of the root node is computed.
+     */
+    QMatrix4x4 m_rootParentMatrix;
+    
+    /**
+     * Set to true if a node is dirty.
+     */
+    bool m_isDirty;
 };
 
 #endif // SCENE_H
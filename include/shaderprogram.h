@@ -44,6 +44,13 @@ public:
     : Shader(vShader, fShader) {};
     virtual ~ObjectShader() {};
     
+    /**
+     * @brief Set the uniforms in OpenGL defining the texture units of the 
+     * samplers. The texture units are constant: the uniforms are set once 
+     * when the shader program is created.
+     */
+    virtual void setSamplerUniforms();
+    
     /**
      * @brief Set the uniforms in OpenGL defining the material.
      * @param material The material to apply.
@@ -51,17 +58,16 @@ public:
     virtual void setMaterialUniforms(const Material & material);
     
     /**
-     * @brief Set the matrix uniforms in OpenGL.
-     * @param M The model matrix.
+     * @brief Set the view and projection uniforms in OpenGL. The model 
+     * matrices are given per instance by the vertex attributes.
      * @param V The view matrix.
      * @param P The projection matrix.
      * @param lVP The light transform matrix. This correspond to the product of 
      * the light projection matrix by the light view matrix.
      */
-    virtual void setMatrixUniforms(const QMatrix4x4 & M, 
-                                   const QMatrix4x4 & V, 
-                                   const QMatrix4x4 & P, 
-                                   const QMatrix4x4 lVP[]);
+    virtual void setViewUniforms(const QMatrix4x4 & V, 
+                                 const QMatrix4x4 & P, 
+                                 const QMatrix4x4 lVP[]);
     
     /**
      * @brief Set the light uniforms in OpenGL.
@@ -99,6 +105,15 @@ public:
     : ObjectShader(vShader, fShader) {};
     virtual ~ObjectShadowShader() {};
     
+    /**
+     * @overload
+     * @brief Set the uniforms in OpenGL defining the texture units of the 
+     * samplers.
+     * @remark This function does not set any uniform as no texture is sampled
+     * when computing the shadow map.
+     */
+    virtual void setSamplerUniforms();
+    
     /**
      * @overload
      * @brief Set the uniforms in OpenGL defining the material.
@@ -110,17 +125,15 @@ public:
     
     /**
      * @overload
-     * @brief Set the matrix uniforms in OpenGL.
-     * @param M The model matrix.
+     * @brief Set the view and projection uniforms in OpenGL.
      * @param V The view matrix.
      * @param P The projection matrix.
      * @param lVP The light transform matrix. This correspond to the product of 
      * the light projection matrix by the light view matrix.
      */
-    virtual void setMatrixUniforms(const QMatrix4x4 & M, 
-                                   const QMatrix4x4 & V, 
-                                   const QMatrix4x4 & P, 
-                                   const QMatrix4x4 lVP[]);
+    virtual void setViewUniforms(const QMatrix4x4 & V, 
+                                 const QMatrix4x4 & P, 
+                                 const QMatrix4x4 lVP[]);
     
     /**
      * @brief Set the light uniforms in OpenGL.
@@ -0,0 +1,38 @@
+#ifndef TANGENTSPACE_H
+#define TANGENTSPACE_H
+
+#include "meshbuilder.h"
+
+/** @file tangentspace.h
+ * Generation of the tangent space of a mesh for normal mapping.
+ */
+
+namespace TangentSpace {
+
+/**
+ * @brief Compute the tangents and bitangents of a range of vertices from 
+ * their positions, normals, and texture coordinates.
+ * @details The tangent and bitangent of each triangle are accumulated on its 
+ * vertices, weighted by the area of the triangle in texture space. The 
+ * tangent of each vertex is then orthonormalized against its normal 
+ * (Gram-Schmidt), and the bitangent is the cross product of the normal and 
+ * the tangent, flipped when the texture is mirrored. A vertex without 
+ * texture coordinates gets any tangent orthogonal to its normal.
+ * The triangles are accumulated sequentially since they share their 
+ * vertices. The vertices are orthonormalized four at a time with SSE2 when 
+ * available, and in parallel on the thread pool for large meshes. No memory 
+ * is allocated.
+ * @param streams The streams of the mesh. The triangles are read from 
+ * streams.indices, which must only reference vertices of the range. The 
+ * tangents and bitangents of the range are written.
+ * @param firstVertex The first vertex of the range.
+ * @param numVertices The number of vertices of the range.
+ */
+void generate(
+    const MeshStreams & streams, std::size_t firstVertex, 
+    std::size_t numVertices
+);
+
+}
+
+#endif // TANGENTSPACE_H
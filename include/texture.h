@@ -5,10 +5,14 @@
 #include <QImage>
 #include <QOpenGLTexture>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 /// Texture class
 /**
  * @brief Texture class inherited from QOpenGLTexture.
+ * @details A texture created from an image does not use OpenGL until upload()
+ * is called. It can therefore be created by any thread.
  * @author Louis Filipozzi
  */
 class Texture : public QOpenGLTexture {
@@ -19,18 +23,36 @@ public:
     
     Texture(Type type, QImage & image, 
             QOpenGLTexture::MipMapGeneration genMipMaps = GenerateMipMaps) 
-    : QOpenGLTexture(image.mirrored(), genMipMaps), m_type(type) {}
+    : QOpenGLTexture(QOpenGLTexture::Target2D), m_type(type), 
+    m_image(image.mirrored()), m_genMipMaps(genMipMaps) {}
     
     Texture(Type type, QOpenGLTexture::Target target) 
-    : QOpenGLTexture(target), m_type(type) {}
+    : QOpenGLTexture(target), m_type(type), m_genMipMaps(DontGenerateMipMaps) 
+    {}
 
     Type getType() const {return m_type;}
     
+    /**
+     * @brief Create the OpenGL texture from the image and release the image.
+     * @remark Must be called from the thread of the OpenGL context.
+     */
+    void upload();
+    
 private:
     /**
      * Texture type.
      */
     Type m_type;
+    
+    /**
+     * Image of the texture, released once uploaded.
+     */
+    QImage m_image;
+    
+    /**
+     * Generate the mip maps when the image is uploaded.
+     */
+    QOpenGLTexture::MipMapGeneration m_genMipMaps;
 };
 
 
@@ -66,6 +88,12 @@ public:
      */
     static Texture * getTexture(QString name, Texture::Type type);
     
+    /**
+     * @brief Upload the textures loaded since the last call.
+     * @remark Must be called from the thread of the OpenGL context.
+     */
+    static void initialize();
+    
     /**
      * @brief Properly deallocate all textures.
      */
@@ -83,6 +111,17 @@ private:
      * can have a same name but a different type.
      */
     static TexturesMapsContainer m_textures;
+    
+    /**
+     * Textures which have not been uploaded yet.
+     */
+    static std::vector<Texture *> m_pendingTextures;
+    
+    /**
+     * Mutex protecting the textures: the models, and thus their textures, are
+     * loaded by worker threads.
+     */
+    static std::mutex m_mutex;
 };
 
 #endif // TEXTURE_H
@@ -0,0 +1,94 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Thread pool
+/**
+ * @brief Pool of worker threads executing tasks in the background.
+ * @details The tasks are executed in the order they are submitted. A single
+ * pool, returned by ThreadPool::global(), is shared by the application so that
+ * the number of threads never exceeds the number of cores.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Start the worker threads.
+     * @param numThreads The number of worker threads. If 0, one thread per
+     * core is started.
+     */
+    ThreadPool(unsigned int numThreads = 0);
+
+    /**
+     * @brief Wait for the tasks already submitted and stop the threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Return the pool shared by the application.
+     */
+    static ThreadPool & global();
+
+    /**
+     * @brief Return the number of worker threads.
+     */
+    unsigned int size() const {
+        return static_cast<unsigned int>(m_threads.size());
+    }
+
+    /**
+     * @brief Execute a task in the background.
+     * @param task The task.
+     * @return The future holding the result of the task.
+     */
+    template<class Task>
+    auto submit(Task && task) -> std::future<decltype(task())> {
+        typedef decltype(task()) Result;
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(
+            std::forward<Task>(task)
+        );
+        std::future<Result> future = packagedTask->get_future();
+        enqueue([packagedTask]{(*packagedTask)();});
+        return future;
+    }
+
+    /**
+     * @brief Call function(i) for i in [0, count) on the worker threads and
+     * the calling thread, and wait for all the calls to return.
+     * @param count The number of calls.
+     * @param function The function to call. The calls must be independent.
+     */
+    void parallelFor(
+        std::size_t count, const std::function<void(std::size_t)> & function
+    );
+
+private:
+    /**
+     * @brief Add a task to the queue.
+     */
+    void enqueue(std::function<void()> task);
+
+    /**
+     * @brief Loop of the worker threads.
+     */
+    void run();
+
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,340 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <QString>
+#include <QFile>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Trajectory source
+/**
+ * @brief Interface of the classes providing the trajectory of a vehicle.
+ */
+class TrajectorySource {
+public:
+    /**
+     * @brief Channels of the trajectory. The order of the channels is the
+     * order of the columns of the CSV trajectory.
+     */
+    enum Channel : unsigned int {
+        Time = 0,
+        ChassisX, ChassisY, ChassisZ, ChassisYaw, ChassisPitch, ChassisRoll,
+        WheelFLX, WheelFLY, WheelFLZ, WheelFLRotation, WheelFLSteer,
+        ForceFLX, ForceFLY, ForceFLZ,
+        WheelFRX, WheelFRY, WheelFRZ, WheelFRRotation, WheelFRSteer,
+        ForceFRX, ForceFRY, ForceFRZ,
+        WheelRLX, WheelRLY, WheelRLZ, WheelRLRotation, WheelRLSteer,
+        ForceRLX, ForceRLY, ForceRLZ,
+        WheelRRX, WheelRRY, WheelRRZ, WheelRRRotation, WheelRRSteer,
+        ForceRRX, ForceRRY, ForceRRZ,
+        NumChannels
+    };
+
+    virtual ~TrajectorySource() {}
+
+    /**
+     * @brief Return true if the trajectory has no sample.
+     */
+    virtual bool isEmpty() const = 0;
+
+    /**
+     * @brief Return the time of the first sample.
+     */
+    virtual float firstTime() const = 0;
+
+    /**
+     * @brief Return the time of the last sample.
+     */
+    virtual float finalTime() const = 0;
+
+    /**
+     * @brief Linearly interpolate the channels of the trajectory at the 
+     * requested time. The time is clamped to the time range of the trajectory.
+     * @param[in] time The time.
+     * @param[out] row The value of each channel.
+     * @return Return false if the samples are not available yet, in which
+     * case row is left unchanged.
+     */
+    virtual bool getSample(float time, float row[NumChannels]) = 0;
+
+    /**
+     * @brief Linearly interpolate the channels of the trajectory at several
+     * times at once.
+     * @param[in] times The times, preferably sorted in increasing order.
+     * @param[in] count The number of times.
+     * @param[out] samples The value of the channels, stored channel by
+     * channel: samples[c * count + k] is the channel c at times[k]. The 
+     * samples which are not available yet are left unchanged.
+     * @return Return false if some samples are not available yet.
+     */
+    virtual bool getSamples(
+        const float * times, std::size_t count, float * samples
+    );
+};
+
+
+
+/// Trajectory
+/**
+ * @brief Columnar storage of a vehicle trajectory.
+ * @details The trajectory is stored channel by channel: each channel (time,
+ * chassis position, wheel positions, tire forces) is a contiguous array of
+ * float sorted by time. The data is either owned by the trajectory (when
+ * parsed from the CSV text of a vehicle XML file) or memory-mapped from a
+ * binary trajectory file, in which case it is never copied in memory.
+ *
+ * The binary trajectory file is made of a header of 64 bytes followed by the
+ * channel columns:
+ * | Offset | Type       | Description                                   |
+ * |--------|------------|-----------------------------------------------|
+ * | 0      | char[8]    | Magic number "VMTRAJ" padded with zeros.      |
+ * | 8      | quint32    | Version of the format.                        |
+ * | 12     | quint32    | Byte order mark (0x01020304).                 |
+ * | 16     | quint32    | Number of channels (including the time).      |
+ * | 20     | quint32    | Reserved.                                     |
+ * | 24     | quint64    | Number of samples.                            |
+ * | 32     | quint64    | Column stride: number of floats per column.   |
+ * | 40     | quint64    | Offset in bytes of the first column.          |
+ * | 48     | quint8[16] | Reserved.                                     |
+ *
+ * Each column is padded to a multiple of 64 bytes so that all columns are
+ * aligned on a cache line. The channels are stored in the order of the enum
+ * Trajectory::Channel, the first column being the time. The time must never
+ * decrease: fromFile() checks it when the file is mapped, while a 
+ * PagedTrajectory only checks the first time of each chunk.
+ */
+class Trajectory : public TrajectorySource {
+public:
+    /**
+     * @brief Header of a binary trajectory file.
+     */
+    struct FileHeader {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 numChannels;
+        quint32 reserved0;
+        quint64 numSamples;
+        quint64 columnStride;
+        quint64 dataOffset;
+        quint8 reserved1[16];
+    };
+
+    /**
+     * @brief Maximum error allowed when decimating a trajectory.
+     */
+    struct Tolerance {
+        /** Tolerance on the coordinates of the chassis and the wheels. */
+        float position = 0.0f;
+        /** Tolerance on the angles of the chassis and the wheels. */
+        float angle = 0.0f;
+        /** Tolerance on the tire forces. */
+        float force = 0.0f;
+    };
+
+    /**
+     * @brief Create an empty trajectory.
+     */
+    Trajectory();
+    ~Trajectory() override;
+
+    Trajectory(const Trajectory &) = delete;
+    Trajectory & operator=(const Trajectory &) = delete;
+
+    /**
+     * @brief Parse the CSV text of a trajectory. The first line (header) is
+     * ignored.
+     * @param csv The CSV text.
+     * @return The trajectory. If a line cannot be parsed, the trajectory
+     * contains the samples read before the faulty line.
+     */
+    static std::unique_ptr<Trajectory> fromCsv(const QString & csv);
+
+    /**
+     * @brief Parse the CSV text of a trajectory on all cores. The first line
+     * (header) is ignored.
+     * @param text The CSV text.
+     * @param size The size of the text in bytes.
+     * @return The trajectory. If a line cannot be parsed, the trajectory
+     * contains the samples read before the faulty line.
+     */
+    static std::unique_ptr<Trajectory> fromCsv(
+        const char * text, std::size_t size
+    );
+
+    /**
+     * @brief Memory-map a binary trajectory file.
+     * @details The whole time channel is read once to check that the time 
+     * never decreases.
+     * @param fileName The path to the binary trajectory file.
+     * @return The trajectory, nullptr if the file is not a valid trajectory
+     * file.
+     */
+    static std::unique_ptr<Trajectory> fromFile(const QString & fileName);
+
+    /**
+     * @brief Write the trajectory to a binary trajectory file.
+     * @param fileName The path to the binary trajectory file.
+     * @return Return true if the file has been written successfully.
+     */
+    bool save(const QString & fileName) const;
+
+    /**
+     * @brief Remove the samples which can be interpolated from the remaining 
+     * samples within the tolerance (Douglas-Peucker algorithm). The first and
+     * last samples are always kept.
+     * @details Douglas-Peucker is quadratic in the number of samples in the 
+     * worst case, so the trajectory is decimated by windows of 512 samples 
+     * whose ends are kept: the cost is linear in the number of samples and 
+     * the compression ratio is at most 512.
+     * @param tolerance The maximum error allowed on each channel.
+     * @return The decimated trajectory.
+     */
+    std::unique_ptr<Trajectory> decimate(const Tolerance & tolerance) const;
+
+    /**
+     * @brief Read and check the header of a binary trajectory file.
+     * @param[in] file The opened binary trajectory file.
+     * @param[out] header The header.
+     * @return Return true if the header is valid and the file is large enough
+     * to contain the columns.
+     */
+    static bool readHeader(QFile & file, FileHeader & header);
+
+    /**
+     * @brief Return the number of samples of the trajectory.
+     */
+    std::size_t size() const {return m_numSamples;}
+
+    bool isEmpty() const override {return m_numSamples == 0;}
+    float firstTime() const override;
+    float finalTime() const override;
+    bool getSample(float time, float row[NumChannels]) override;
+    bool getSamples(
+        const float * times, std::size_t count, float * samples
+    ) override;
+
+    /**
+     * @brief Return true if the data is memory-mapped from a file.
+     */
+    bool isMapped() const {return p_file != nullptr;}
+
+    /**
+     * @brief Return a pointer to the first element of a channel.
+     * @param channel The channel.
+     */
+    const float * column(unsigned int channel) const {
+        return p_data + channel * m_columnStride;
+    }
+
+    /**
+     * @brief Return the time of the i-th sample.
+     */
+    float time(std::size_t i) const {return column(Time)[i];}
+
+    /**
+     * @brief Gather all the channels of the i-th sample.
+     * @param[in] i The index of the sample.
+     * @param[out] row The value of each channel.
+     */
+    void sample(std::size_t i, float row[NumChannels]) const;
+
+    /**
+     * @brief Find the last sample which occurs before or at the requested
+     * time.
+     * @details Uniformly sampled trajectories are indexed with a direct index
+     * computation. Otherwise, the samples following the hint are checked
+     * first since the playback is mostly monotonic, before falling back on a
+     * binary search in the Eytzinger layout of the time channel.
+     * @param time The time.
+     * @param hint The index returned by the previous lookup.
+     * @return The index of the sample, 0 if the time is before the first
+     * sample. The trajectory must not be empty.
+     */
+    std::size_t findSample(float time, std::size_t hint = 0) const;
+
+    /**
+     * @brief Return true if the samples are uniformly spaced in time.
+     */
+    bool isUniform() const {return m_uniformStep > 0.0f;}
+
+private:
+    /**
+     * @brief Build the index used to find the samples. Must be called once
+     * the time channel is set.
+     */
+    void buildIndex();
+
+    /**
+     * @brief Binary search of the last sample which occurs before or at the
+     * requested time in the Eytzinger layout of the time channel.
+     * @param time The time.
+     */
+    std::size_t searchSample(float time) const;
+
+    /**
+     * @brief Return the number of float per column such that each column is
+     * aligned on 64 bytes.
+     * @param numSamples The number of samples.
+     */
+    static std::size_t columnStride(std::size_t numSamples);
+
+private:
+    /**
+     * Number of samples.
+     */
+    std::size_t m_numSamples;
+
+    /**
+     * Number of float between the first element of two consecutive channels.
+     */
+    std::size_t m_columnStride;
+
+    /**
+     * Time between two samples if the trajectory is uniformly sampled, 0
+     * otherwise.
+     */
+    float m_uniformStep;
+
+    /**
+     * Time channel in Eytzinger (BFS) layout, with a sentinel at index 0.
+     * Only built for non-uniform trajectories.
+     */
+    std::vector<float> m_eytzinger;
+
+    /**
+     * Index of the sample of each element of m_eytzinger.
+     */
+    std::vector<std::size_t> m_eytzingerIndex;
+
+    /**
+     * Pointer to the first element of the time channel.
+     */
+    const float * p_data;
+
+    /**
+     * Channel data when the trajectory owns its data.
+     */
+    std::vector<float> m_data;
+
+    /**
+     * The binary trajectory file when the data is memory-mapped.
+     */
+    std::unique_ptr<QFile> p_file;
+
+    /**
+     * Index of the sample found by the last call to getSample(). Used as a
+     * hint since the playback is mostly monotonic.
+     */
+    std::size_t m_cursor;
+
+    /**
+     * Interval and interpolation factor of each time of the last call to
+     * getSamples(). Kept between the calls to avoid allocating them.
+     */
+    std::vector<std::uint32_t> m_indices;
+    std::vector<float> m_alphas;
+};
+
+#endif // TRAJECTORY_H
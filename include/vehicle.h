@@ -3,8 +3,11 @@
 
 #include "abstractobject.h"
 #include "position.h"
+#include "trajectory.h"
+#include <QDomDocument>
 #include <QFile>
 #include <QMatrix4x4>
+#include <future>
 
 /**
  * @brief Contains the position of the vehicle (chassis, wheels, tire forces).
@@ -45,42 +48,6 @@ struct VehiclePosition {
     forceFR(fFR),
     forceRL(fRL),
     forceRR(fRR) {};
-    
-    void operator+=(const VehiclePosition & a) {
-        chassis += a.chassis;
-        wheelFL += a.wheelFL;
-        wheelFR += a.wheelFR;
-        wheelRL += a.wheelRL;
-        wheelRR += a.wheelRR;
-        forceFL += a.forceFL;
-        forceFR += a.forceFR;
-        forceRL += a.forceRL;
-        forceRR += a.forceRR;
-    };
-    
-    void operator-=(const VehiclePosition & a) {
-        chassis -= a.chassis;
-        wheelFL -= a.wheelFL;
-        wheelFR -= a.wheelFR;
-        wheelRL -= a.wheelRL;
-        wheelRR -= a.wheelRR;
-        forceFL -= a.forceFL;
-        forceFR -= a.forceFR;
-        forceRL -= a.forceRL;
-        forceRR -= a.forceRR;
-    };
-    
-    VehiclePosition operator+(const VehiclePosition & a) {
-        VehiclePosition tmp(*this);
-        tmp += a;
-        return tmp;
-    };
-    
-    VehiclePosition operator-(const VehiclePosition & a) {
-        VehiclePosition tmp(*this);
-        tmp -= a;
-        return tmp;
-    };
 };
 
 
@@ -96,23 +63,27 @@ public:
      * @brief Constructor of the vehicle
      * @param trajectory The data describing the trajectory.
      */
-    VehicleController(const QString trajectory);
+    VehicleController(std::unique_ptr<TrajectorySource> trajectory);
     
     /**
-     * @brief Return the position of the vehicle at the requested time-step.
-     * @param timestep The time-step
-     * @return The position of the chassis
+     * @brief Return the positions of the vehicle at several time-steps. All 
+     * the channels are interpolated for all the time-steps at once.
+     * @param[in] timesteps The time-steps, preferably sorted.
+     * @param[in,out] positions The position of the vehicle at each time-step.
+     * The positions whose trajectory samples are not available yet (e.g. a 
+     * chunk of a paged trajectory still being read) are left unchanged, so 
+     * that they keep the last valid pose of the vehicle.
      */
-    VehiclePosition getVehiclePosition(const float timestep);
+    void getVehiclePositions(
+        const std::vector<float> & timesteps, VehiclePosition * positions
+    );
 
     /**
      * @brief Return the first time-step for which a vehicle position is 
      * defined.
      */
     float getFirstTimeStep() const {
-        if (m_trajectory.begin() != m_trajectory.end()) 
-            return m_trajectory.begin()->first;
-        return 0.0f;
+        return p_trajectory->firstTime();
     }
 
     /**
@@ -120,21 +91,30 @@ public:
      * defined.
      */
     float getFinalTimeStep() const {
-        if (m_trajectory.rbegin() != m_trajectory.rend())
-            return m_trajectory.rbegin()->first;
-        return 0.0f;
+        return p_trajectory->finalTime();
     }
     
 private:
     /**
-     * @typedef A trajectory is a map of time-step to vehicle position.
+     * @brief Convert the channels of a trajectory sample into a vehicle 
+     * position.
+     * @param row The value of each channel of the trajectory.
      */
-    typedef std::map<float, VehiclePosition> Trajectory;
-
+    static VehiclePosition toVehiclePosition(
+        const float row[Trajectory::NumChannels]
+    );
+    
+private:
     /**
      * @brief The time-step of the vehicle trajectory.
      */
-    Trajectory m_trajectory;
+    std::unique_ptr<TrajectorySource> p_trajectory;
+    
+    /**
+     * @brief Channels interpolated by getVehiclePositions(), stored channel by
+     * channel. The buffer only grows.
+     */
+    std::vector<float> m_samples;
 };
 
 
@@ -146,6 +126,21 @@ private:
  */
 class VehicleGraphics {
 public:
+    /**
+     * @brief Model matrices of the parts of the vehicle at a given position.
+     */
+    struct Matrices {
+        QMatrix4x4 chassis;
+        QMatrix4x4 wheelFL;
+        QMatrix4x4 wheelFR;
+        QMatrix4x4 wheelRL;
+        QMatrix4x4 wheelRR;
+        QMatrix4x4 forceFL;
+        QMatrix4x4 forceFR;
+        QMatrix4x4 forceRL;
+        QMatrix4x4 forceRR;
+    };
+    
     VehicleGraphics(
         ABCObject * chassisModel, ABCObject * wheelModel, ABCObject * line
     ) : 
@@ -156,13 +151,14 @@ public:
     m_showTireForce(true) {};
     
     /**
-     * @brief Update the model matrices.
+     * @brief Compute the model matrices.
      * @param vehiclePosition The vehicle position.
      */
-    void updateMatrices(const VehiclePosition vehiclePosition);
+    Matrices computeMatrices(const VehiclePosition & vehiclePosition) const;
     
     /**
      * @brief Draw the object.
+     * @param matrices The model matrices.
      * @param view The view matrix.
      * @param projection The projection matrix.
      * @param lightSpace The view and projection matrices of the light (used for 
@@ -170,6 +166,7 @@ public:
      * @param cascades Array containing the distance for cascade shadow mapping.
      */
     void render(
+        const Matrices & matrices, 
         const CasterLight & light, const QMatrix4x4 & view, 
         const QMatrix4x4 & projection, 
         const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
@@ -178,10 +175,13 @@ public:
     
     /**
      * @brief Draw the object when computing the framebuffer for shadow mapping.
+     * @param matrices The model matrices.
      * @param lightSpace The view and projection matrix of the light (used for 
      * shadow mapping).
      */
-    void renderShadow(const QMatrix4x4 & lightSpace);
+    void renderShadow(
+        const Matrices & matrices, const QMatrix4x4 & lightSpace
+    );
     
     /**
      * @brief Render/hide tire forces.
@@ -200,7 +200,7 @@ private:
     QMatrix4x4 getForceModelMatrix(const QVector3D &force,
                                    const Position &wheelPos, 
                                    const Position &chassisPos,
-                                   const QVector3D &offset);
+                                   const QVector3D &offset) const;
     
 private:
     /**
@@ -227,16 +227,6 @@ private:
      * Show the tire frame of the vehicle.
      */
     bool m_showTireForce;
-    
-    QMatrix4x4 m_chassisMatrix;
-    QMatrix4x4 m_wheelFLMatrix;
-    QMatrix4x4 m_wheelFRMatrix;
-    QMatrix4x4 m_wheelRLMatrix;
-    QMatrix4x4 m_wheelRRMatrix;
-    QMatrix4x4 m_forceFLMatrix;
-    QMatrix4x4 m_forceFRMatrix;
-    QMatrix4x4 m_forceRLMatrix;
-    QMatrix4x4 m_forceRRMatrix;
 };
 
 
@@ -252,20 +242,11 @@ class Vehicle {
 public:
     Vehicle(
         ABCObject * chassisModel, ABCObject * wheelModel, ABCObject * line, 
-        const QString trajectory
+        std::unique_ptr<TrajectorySource> trajectory
     ) :
     m_graphics(chassisModel, wheelModel, line),
-    m_controller(trajectory) {};
+    m_controller(std::move(trajectory)) {};
     
-    /**
-     * @brief Return the position of the vehicle at the requested time-step.
-     * @param timestep The time-step
-     * @return The position of the chassis
-     */
-    Position getPosition(const float timestep) {
-        return m_controller.getVehiclePosition(timestep).chassis;
-    }
-
     /**
      * @brief Return the first time-step for which a vehicle position is 
      * defined.
@@ -283,39 +264,60 @@ public:
     }
     
     /**
-     * @brief Update the position of the vehicle.
-     * @param timestep The time-step.
+     * @brief Return the positions of the vehicle at several time-steps.
+     * @param[in] timesteps The time-steps.
+     * @param[in,out] positions The position of the vehicle at each 
+     * time-step. The positions which are not available yet are left 
+     * unchanged.
      */
-    void updatePosition(float timestep) {
-        VehiclePosition vehiclePosition = 
-            m_controller.getVehiclePosition(timestep);
-        m_graphics.updateMatrices(vehiclePosition);
+    void getPositions(
+        const std::vector<float> & timesteps, VehiclePosition * positions
+    ) {
+        m_controller.getVehiclePositions(timesteps, positions);
+    }
+    
+    /**
+     * @brief Compute the model matrices of the vehicle at a given position.
+     * @param position The position.
+     */
+    VehicleGraphics::Matrices getMatrices(
+        const VehiclePosition & position
+    ) const {
+        return m_graphics.computeMatrices(position);
     }
     
     /**
      * @brief Draw the vehicle.
+     * @param matrices The model matrices of the vehicle.
      * @param view The view matrix.
      * @param projection The projection matrix.
      * @param lightSpace The view and projection matrix of the light (used for 
      * shadow mapping).
      */
     void render(
+        const VehicleGraphics::Matrices & matrices, 
         const CasterLight & light, const QMatrix4x4 & view, 
         const QMatrix4x4 & projection, 
         const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
         const std::array<float,NUM_CASCADES+1> & cascades
     ) {
-        m_graphics.render(light, view, projection, lightSpace, cascades);
+        m_graphics.render(
+            matrices, light, view, projection, lightSpace, cascades
+        );
     };
     
     /**
      * @brief Draw the vehicle when computing the framebuffer for shadow 
      * mapping.
+     * @param matrices The model matrices of the vehicle.
      * @param lightSpace The view and projection matrix of the light (used for 
      * shadow mapping).
      */
-    void renderShadow(const QMatrix4x4 & lightSpace) {
-        m_graphics.renderShadow(lightSpace);
+    void renderShadow(
+        const VehicleGraphics::Matrices & matrices, 
+        const QMatrix4x4 & lightSpace
+    ) {
+        m_graphics.renderShadow(matrices, lightSpace);
     };
     
     /**
@@ -346,10 +348,71 @@ class VehicleBuilder {
 public:
     VehicleBuilder(QString file) : m_file(file), p_vehicle(nullptr) {};
     
+    /**
+     * @brief Start loading the vehicle on the thread pool: the XML file is 
+     * parsed, then the models and the trajectory are loaded in parallel.
+     */
+    void start();
+    
+    /**
+     * @brief Build the vehicle, waiting for the loads started by start(). 
+     * start() is called if it has not been called yet.
+     * @remark Must be called from the thread of the OpenGL context, which 
+     * initializes the models.
+     * @return Return true if the vehicle has been loaded successfully.
+     */
     virtual bool build();
     virtual std::unique_ptr<Vehicle>  getVehicle();
     
+    /**
+     * @brief Convert the CSV trajectory of a vehicle XML file into a binary
+     * trajectory file.
+     * @param file The path to the vehicle XML file.
+     * @param trajectoryFile The path to the binary trajectory file to write.
+     * @return Return true if the trajectory has been converted successfully.
+     */
+    static bool exportTrajectory(
+        const QString & file, const QString & trajectoryFile
+    );
+    
 private:
+    /**
+     * @brief Validate the vehicle XML file against the XML schema and parse 
+     * it.
+     * @param[in] file The path to the vehicle XML file.
+     * @param[out] domDoc The parsed document.
+     * @return Return true if the file has been parsed successfully.
+     */
+    static bool parse(const QString & file, QDomDocument & domDoc);
+    
+    /**
+     * @brief Load the trajectory described by the trajectory element. The 
+     * trajectory is either memory-mapped from the binary trajectory file given
+     * by the attribute 'file' or parsed from the CSV text of the element.
+     * @param elmt The trajectory element.
+     * @return The trajectory, nullptr if an error happened.
+     */
+    static std::unique_ptr<TrajectorySource> loadTrajectory(
+        const QDomElement & elmt
+    );
+    
+    /**
+     * @brief Components of the vehicle loaded on the thread pool.
+     */
+    struct Components {
+        QString chassisModel;
+        QString wheelModel;
+        /** The trajectory, nullptr if an error happened. */
+        std::unique_ptr<TrajectorySource> trajectory;
+    };
+    
+    /**
+     * @brief Parse the vehicle XML file, start loading the models on the 
+     * thread pool and load the trajectory. Called by a worker thread.
+     * @param file The path to the vehicle XML file.
+     * @return The components of the vehicle.
+     */
+    static Components loadComponents(const QString & file);
     
 private:
     /**
@@ -357,6 +420,11 @@ private:
      */
     QString m_file;
     
+    /**
+     * The components of the vehicle being loaded since start().
+     */
+    std::future<Components> m_components;
+    
     /**
      * Pointer to the vehicle.
      */
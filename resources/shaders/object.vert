@@ -2,17 +2,19 @@
 
 const int NUM_CASCADES = 3;     // Number of cascaded shadows
 
-in highp   vec3 vertexPosition;
-in highp   vec3 vertexNormal;
-in mediump vec2 texCoord2D;
-in highp   vec3 vertexTangent;
-in highp   vec3 vertexBitangent;
-
-uniform highp mat4 M;
-uniform highp mat4 MV;
-uniform highp mat4 MVP;
-uniform highp mat4 lMVP[NUM_CASCADES];
-uniform highp mat3 N;
+layout(location = 0) in highp   vec3 vertexPosition;
+layout(location = 1) in highp   vec3 vertexNormal;
+layout(location = 2) in mediump vec2 texCoord2D;
+layout(location = 3) in highp   vec4 vertexTangent; // w is the handedness
+layout(location = 4) in highp   vec3 vertexBitangent;
+
+// Model matrix and its normal matrix of the instance
+layout(location = 5) in highp   mat4 instanceM;
+layout(location = 9) in highp   mat3 instanceN;
+
+uniform highp mat4 V;
+uniform highp mat4 VP;
+uniform highp mat4 lVP[NUM_CASCADES];
 
 uniform vec4 lightDirection;
 
@@ -38,6 +40,12 @@ out Tangent {
 
 
 void main(void) {    
+    // Matrices of the instance. The view matrix is a rigid transformation: 
+    // its normal matrix is its rotation.
+    highp mat4 MV = V * instanceM;
+    highp mat3 N = mat3(V) * instanceN;
+    highp vec4 worldPosition = instanceM * highp vec4(vertexPosition, 1.0);
+    
     // Pass texture coordinates to the fragment shader
     texCoord = texCoord2D;
     
@@ -46,22 +54,22 @@ void main(void) {
     
     // Transform to light space (for shadow mapping)
 //     for (int i = 0; i < NUM_CASCADES; i++)
-//         lightProj.position[i] = lMVP[i] * highp vec4(vertexPosition, 1.0);
-    lightProj.position[0] = lMVP[0] * highp vec4(vertexPosition, 1.0);
-    lightProj.position[1] = lMVP[1] * highp vec4(vertexPosition, 1.0);
-    lightProj.position[2] = lMVP[2] * highp vec4(vertexPosition, 1.0);
+//         lightProj.position[i] = lVP[i] * worldPosition;
+    lightProj.position[0] = lVP[0] * worldPosition;
+    lightProj.position[1] = lVP[1] * worldPosition;
+    lightProj.position[2] = lVP[2] * worldPosition;
     
     // Transform the vertex position to clip space
-    gl_Position = MVP * highp vec4(vertexPosition, 1.0);
+    gl_Position = VP * worldPosition;
     
     // Give the z-coordinate in the clip space for cascaded shadow mapping
     proj.z = gl_Position.z;
     
     // Compute TBN matrix
-    vec3 Tvec = normalize(N * vertexTangent);
+    vec3 Tvec = normalize(N * vertexTangent.xyz);
     // vec3 Bvec = normalize(N * vertexBitangent);
     vec3 Nvec = normalize(N * vertexNormal);
-    vec3 Bvec = cross(Nvec,Tvec);
+    vec3 Bvec = cross(Nvec,Tvec) * vertexTangent.w;
     mat3 TBN = transpose(mat3(Tvec, Bvec, Nvec));
     
     // Transform from view space to tangent space
@@ -1,12 +1,15 @@
-#version 120
+#version 330
 
 // Simple vertex shader used to transform to light space for shadow mapping
 
-attribute highp vec3 vertexPosition;
+layout(location = 0) in highp vec3 vertexPosition;
 
-uniform mat4 lMVP;
+// Model matrix of the instance
+layout(location = 5) in highp mat4 instanceM;
+
+uniform mat4 lVP;
 
 void main()
 {
-    gl_Position = lMVP * vec4(vertexPosition, 1.0);
+    gl_Position = lVP * instanceM * vec4(vertexPosition, 1.0);
 }  
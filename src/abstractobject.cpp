@@ -1,4 +1,8 @@
 #include "../include/abstractobject.h"
+#include "../include/texture.h"
+#include "../include/threadpool.h"
+#include <QDebug>
+#include <exception>
 
 /***
  *              ____   _      _              _         
@@ -18,11 +22,19 @@
 
 // Instantiate static member variables
 ObjectManager::ObjectsMap ObjectManager::m_objects;
+std::vector<ABCObject *> ObjectManager::m_uninitializedObjects;
+std::set<QString> ObjectManager::m_loadingObjects;
+std::deque<std::pair<QString, std::unique_ptr<ABCObject>>> 
+    ObjectManager::m_loadedObjects;
+std::mutex ObjectManager::m_mutex;
+std::condition_variable ObjectManager::m_loaded;
 
 
 ABCObject * ObjectManager::loadObject(
     QString name, std::unique_ptr<ABCObject> object
 ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
     // Check if a model with the same name has already been loaded
     ObjectsMap::iterator it = m_objects.find(name);
     if (it != m_objects.end()) {
@@ -31,11 +43,49 @@ ABCObject * ObjectManager::loadObject(
     }
     // The object has not been loaded yet
     m_objects[name] = std::move(object);
+    m_uninitializedObjects.push_back(m_objects[name].get());
     return m_objects[name].get();
 }
 
 
+void ObjectManager::loadObjectAsync(
+    QString name, std::function<std::unique_ptr<ABCObject>()> load
+) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_objects.count(name) != 0 || m_loadingObjects.count(name) != 0)
+            return;
+        m_loadingObjects.insert(name);
+    }
+    
+    // The future is not needed: the object is queued when loaded. A failed 
+    // load is queued as nullptr so that the name is no longer loading.
+    ThreadPool::global().submit([name, load]{
+        std::unique_ptr<ABCObject> object;
+        try {
+            object = load();
+        }
+        catch (const std::exception & e) {
+            qWarning() << "Unable to load the object" << name << ":" 
+                       << e.what();
+        }
+        catch (...) {
+            qWarning() << "Unable to load the object" << name;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_loadedObjects.emplace_back(name, std::move(object));
+        }
+        m_loaded.notify_all();
+    });
+}
+
+
 ABCObject * ObjectManager::getObject(QString name) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_loadingObjects.count(name) != 0)
+        receiveObject(lock);
+    
     ObjectsMap::iterator it(m_objects.find(name));
     if (it != m_objects.end())
         return it->second.get();
@@ -45,16 +95,45 @@ ABCObject * ObjectManager::getObject(QString name) {
 
 
 void ObjectManager::initialize() {
-    // Delete all textures
-    for (
-        ObjectsMap::iterator it = m_objects.begin(); it != m_objects.end(); it++
-    ) {
-        if (it->second != nullptr)
-            it->second->initialize();
+    // Initialize the objects loaded on the thread pool as they are received
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_loadingObjects.empty())
+        receiveObject(lock);
+    std::vector<ABCObject *> objects;
+    objects.swap(m_uninitializedObjects);
+    lock.unlock();
+    
+    // Initialize the other objects
+    TextureManager::initialize();
+    for (ABCObject * object : objects) {
+        if (object != nullptr)
+            object->initialize();
     }
 }
 
 
+void ObjectManager::receiveObject(std::unique_lock<std::mutex> & lock) {
+    m_loaded.wait(lock, []{return !m_loadedObjects.empty();});
+    std::pair<QString, std::unique_ptr<ABCObject>> loaded = 
+        std::move(m_loadedObjects.front());
+    m_loadedObjects.pop_front();
+    m_loadingObjects.erase(loaded.first);
+    
+    // Ignore the object if it could not be loaded or if an object with the 
+    // same name has been loaded by loadObject() in the meantime
+    if (loaded.second == nullptr || m_objects.count(loaded.first) != 0)
+        return;
+    ABCObject * object = loaded.second.get();
+    m_objects[loaded.first] = std::move(loaded.second);
+    
+    // Upload the object and its textures
+    lock.unlock();
+    TextureManager::initialize();
+    object->initialize();
+    lock.lock();
+}
+
+
 void ObjectManager::cleanUp() {
     // Delete all textures
     for (
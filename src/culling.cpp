@@ -0,0 +1,115 @@
+#include "../include/culling.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+BoundingBox::BoundingBox() :
+    m_min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+          std::numeric_limits<float>::max()),
+    m_max(std::numeric_limits<float>::lowest(),
+          std::numeric_limits<float>::lowest(),
+          std::numeric_limits<float>::lowest()) {}
+
+
+BoundingBox BoundingBox::fromPositions(
+    const float * positions, std::size_t numVertices
+) {
+    BoundingBox box;
+    for (std::size_t i = 0; i < numVertices; i++) {
+        box.expand(QVector3D(
+            positions[3*i], positions[3*i+1], positions[3*i+2]
+        ));
+    }
+    return box;
+}
+
+
+void BoundingBox::expand(const QVector3D & point) {
+    for (int i = 0; i < 3; i++) {
+        m_min[i] = std::min(m_min[i], point[i]);
+        m_max[i] = std::max(m_max[i], point[i]);
+    }
+}
+
+
+void BoundingBox::expand(const BoundingBox & box) {
+    if (box.isEmpty())
+        return;
+    expand(box.m_min);
+    expand(box.m_max);
+}
+
+
+BoundingBox BoundingBox::transformed(const QMatrix4x4 & matrix) const {
+    if (isEmpty())
+        return *this;
+
+    // The center is transformed, the half extents are projected on the axes
+    // (J. Arvo, Transforming Axis-Aligned Bounding Boxes, 1990)
+    const QVector3D center = matrix * getCenter();
+    const QVector3D extent = (m_max - m_min) / 2.0f;
+    QVector3D newExtent;
+    for (int i = 0; i < 3; i++) {
+        newExtent[i] = std::abs(matrix(i, 0)) * extent.x() +
+            std::abs(matrix(i, 1)) * extent.y() +
+            std::abs(matrix(i, 2)) * extent.z();
+    }
+    return BoundingBox(center - newExtent, center + newExtent);
+}
+
+
+
+Frustum::Frustum(const QMatrix4x4 & matrix, bool nearPlane) {
+    // A point is inside the frustum if -w <= x, y, z <= w in the clip space
+    // (G. Gribb, K. Hartmann, Fast Extraction of Viewing Frustum Planes from
+    // the World-View-Projection Matrix, 2001)
+    const QVector4D w = matrix.row(3);
+    for (int i = 0; i < 3; i++) {
+        m_planes[2*i] = w + matrix.row(i);
+        m_planes[2*i+1] = w - matrix.row(i);
+    }
+    
+    // The near plane -w <= z is replaced by a plane every point is inside
+    if (!nearPlane)
+        m_planes[4] = QVector4D(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+
+Frustum::Test Frustum::test(const BoundingBox & box) const {
+    if (box.isEmpty())
+        return Outside;
+
+    // For each plane, the corner of the box the farthest along the normal of
+    // the plane (p-vertex) and the closest one (n-vertex)
+    const QVector3D & min = box.getMin();
+    const QVector3D & max = box.getMax();
+    Test result = Inside;
+    for (const QVector4D & plane : m_planes) {
+        const float farthest = plane.w() +
+            plane.x() * (plane.x() > 0.0f ? max.x() : min.x()) +
+            plane.y() * (plane.y() > 0.0f ? max.y() : min.y()) +
+            plane.z() * (plane.z() > 0.0f ? max.z() : min.z());
+        if (farthest < 0.0f)
+            return Outside;
+        const float closest = plane.w() +
+            plane.x() * (plane.x() > 0.0f ? min.x() : max.x()) +
+            plane.y() * (plane.y() > 0.0f ? min.y() : max.y()) +
+            plane.z() * (plane.z() > 0.0f ? min.z() : max.z());
+        if (closest < 0.0f)
+            result = Intersecting;
+    }
+    return result;
+}
+
+
+
+CullingStats & CullingStats::color() {
+    static CullingStats stats;
+    return stats;
+}
+
+
+CullingStats & CullingStats::shadow() {
+    static CullingStats stats;
+    return stats;
+}
@@ -70,12 +70,17 @@ void DepthMap::bind(const unsigned int cacadeIdx) {
             m_textureId[cacadeIdx], 0
         );
         p_glFunctions->glClear(GL_DEPTH_BUFFER_BIT);
+        
+        // The shadow casters between the light and the near plane of the 
+        // cascade are clamped to the near plane instead of being clipped
+        p_glFunctions->glEnable(GL_DEPTH_CLAMP);
     }
 }
 
 
 void DepthMap::release() {
     if (p_glFunctions != nullptr) {
+        p_glFunctions->glDisable(GL_DEPTH_CLAMP);
         p_glFunctions->glBindFramebuffer(GL_FRAMEBUFFER, 0);
         p_glFunctions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
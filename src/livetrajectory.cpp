@@ -0,0 +1,161 @@
+#include "../include/livetrajectory.h"
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+LiveTrajectory::LiveTrajectory() :
+    p_header(nullptr),
+    p_samples(nullptr),
+    m_size(0),
+    m_capacity(0),
+    m_history(0),
+    m_cursor(0) {}
+
+
+LiveTrajectory::~LiveTrajectory() {
+#ifdef Q_OS_UNIX
+    if (p_header != nullptr)
+        munmap(p_header, m_size);
+#endif
+}
+
+
+std::unique_ptr<LiveTrajectory> LiveTrajectory::open(const QString & name) {
+#ifdef Q_OS_UNIX
+    const QByteArray shmName = name.toLocal8Bit();
+    int fd = shm_open(shmName.constData(), O_RDWR, 0);
+    if (fd < 0) {
+        qWarning() << "Unable to open the shared memory" << name;
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        static_cast<std::size_t>(status.st_size) < sizeof(LiveRingHeader)) {
+        qWarning() << "The shared memory" << name << "is not a ring buffer.";
+        close(fd);
+        return nullptr;
+    }
+    const std::size_t size = static_cast<std::size_t>(status.st_size);
+    void * data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        qWarning() << "Unable to map the shared memory" << name;
+        return nullptr;
+    }
+
+    std::unique_ptr<LiveTrajectory> trajectory(new LiveTrajectory());
+    trajectory->p_header = static_cast<LiveRingHeader *>(data);
+    trajectory->m_size = size;
+    if (!LiveRing::isValid(trajectory->p_header, NumChannels) ||
+        LiveRing::size(trajectory->p_header->capacity, NumChannels) > size) {
+        qWarning() << "The shared memory" << name << "is not a valid ring "
+            "buffer.";
+        return nullptr;
+    }
+    trajectory->p_samples = LiveRing::samples(trajectory->p_header);
+    trajectory->m_capacity = trajectory->p_header->capacity;
+    // Keep three quarters of the ring buffer for the playback
+    trajectory->m_history = std::max<std::uint64_t>(
+        trajectory->m_capacity - trajectory->m_capacity / 4, 2
+    );
+    trajectory->m_cursor = trajectory->p_header->tail.load();
+    return trajectory;
+#else
+    qWarning() << "Live trajectories are not supported on this platform:"
+        << name << "cannot be opened.";
+    return nullptr;
+#endif
+}
+
+
+bool LiveTrajectory::isEmpty() const {
+    return p_header->head.load(std::memory_order_acquire) ==
+        p_header->tail.load(std::memory_order_relaxed);
+}
+
+
+float LiveTrajectory::firstTime() const {
+    if (isEmpty())
+        return 0.0f;
+    return sample(p_header->tail.load(std::memory_order_relaxed))[Time];
+}
+
+
+float LiveTrajectory::finalTime() const {
+    if (isEmpty())
+        return 0.0f;
+    return sample(p_header->head.load(std::memory_order_acquire) - 1)[Time];
+}
+
+
+bool LiveTrajectory::getSample(float time, float row[NumChannels]) {
+    const std::uint64_t head = p_header->head.load(std::memory_order_acquire);
+    std::uint64_t tail = p_header->tail.load(std::memory_order_relaxed);
+    if (head == tail)
+        return false;
+
+    // Release the oldest samples to the producer
+    if (head - tail > m_history) {
+        tail = head - m_history;
+        p_header->tail.store(tail, std::memory_order_release);
+    }
+
+    // Find the last sample which occurs before the time. The playback is
+    // mostly monotonic: start from the previous sample.
+    const std::uint64_t last = head - 1;
+    std::uint64_t s;
+    if (time <= sample(tail)[Time]) {
+        s = tail;
+    }
+    else if (time >= sample(last)[Time]) {
+        s = last;
+    }
+    else {
+        // Last sample in [lower, upper] which occurs before the time, knowing
+        // that the sample lower does
+        auto search = [this, time](std::uint64_t lower, std::uint64_t upper) {
+            std::uint64_t count = upper - lower;
+            std::uint64_t first = lower + 1;
+            while (count > 0) {
+                std::uint64_t step = count / 2;
+                if (sample(first + step)[Time] <= time) {
+                    first += step + 1;
+                    count -= step + 1;
+                }
+                else {
+                    count = step;
+                }
+            }
+            return first - 1;
+        };
+        s = std::max(tail, std::min(m_cursor, last));
+        if (sample(s)[Time] > time) {
+            s = search(tail, s);
+        }
+        else {
+            for (int step = 0; step < 4 && sample(s + 1)[Time] <= time; step++)
+                s++;
+            if (sample(s + 1)[Time] <= time)
+                s = search(s, last);
+        }
+    }
+    m_cursor = s;
+
+    // Linear interpolation in place
+    const float * sample0 = sample(s);
+    if (s == last || time <= sample0[Time]) {
+        std::copy(sample0, sample0 + NumChannels, row);
+        return true;
+    }
+    const float * sample1 = sample(s + 1);
+    const float alpha = (time - sample0[Time]) / (sample1[Time] - sample0[Time]);
+    for (unsigned int c = 0; c < NumChannels; c++)
+        row[c] = sample0[c] + alpha * (sample1[c] - sample0[c]);
+    return true;
+}
@@ -1,5 +1,8 @@
 #include <QApplication>
 #include "../include/animationwindow.h"
+#include "../include/vehicle.h"
+#include "../include/object.h"
+#include "../include/scene.h"
 #include <iostream>
 
 
@@ -9,7 +12,23 @@ void helpPrinter() {
     << "Options:\n"
     << "  -h, --help        Displays help on command line options.\n"
     << "  -v <file>         Load vehicle trajectory data file." 
-    << "  -e, --env <file>  Load environment XML file." << std::endl;
+    << "  -e, --env <file>  Load environment XML file.\n"
+    << "  -c, --convert <vehicle> <output>\n"
+    << "                    Convert the trajectory of a vehicle XML file into a\n"
+    << "                    binary trajectory file.\n"
+    << "  -p, --packed-vertices\n"
+    << "                    Store the vertices of the models in a compact\n"
+    << "                    interleaved format.\n"
+    << "  -o, --optimize-meshes\n"
+    << "                    Reorder the triangles and vertices of the models\n"
+    << "                    for the vertex cache and report the ACMR.\n"
+    << "  -l, --lod         Generate levels of detail of the models, drawn\n"
+    << "                    according to their distance to the camera.\n"
+    << "  -s, --stats       Report the number of objects and meshes drawn and\n"
+    << "                    culled by the view frustum and by the shadow\n"
+    << "                    cascades, and the OpenGL state changes saved by\n"
+    << "                    the render queue every second." 
+    << std::endl;
 }
 
 
@@ -17,6 +36,7 @@ int main(int argc, char *argv[]) {
     // Parse arguments
     std::vector<QString> vehicle;
     QString environment;
+    QString convertVehicle, convertOutput;
     for (int i = 1; i < argc; i++) {
         if ((strcmp(argv[i],"-h") == 0) || (strcmp(argv[i],"--help") == 0)) {
             helpPrinter();
@@ -38,12 +58,45 @@ int main(int argc, char *argv[]) {
             }
             environment = QString(argv[++i]);
         }
+        else if ((strcmp(argv[i],"-c") == 0) || 
+                 (strcmp(argv[i],"--convert") == 0)) {
+            if (i+2 >= argc) {
+                std::cout << "Argument '-c' must be followed by two values." 
+                    << std::endl;
+                return -1;
+            }
+            convertVehicle = QString(argv[++i]);
+            convertOutput = QString(argv[++i]);
+        }
+        else if ((strcmp(argv[i],"-p") == 0) || 
+                 (strcmp(argv[i],"--packed-vertices") == 0)) {
+            Object::setVertexFormat(Object::VertexFormat::Packed);
+        }
+        else if ((strcmp(argv[i],"-o") == 0) || 
+                 (strcmp(argv[i],"--optimize-meshes") == 0)) {
+            Object::Loader::setMeshOptimization(true);
+        }
+        else if ((strcmp(argv[i],"-l") == 0) || 
+                 (strcmp(argv[i],"--lod") == 0)) {
+            Object::Loader::setLodGeneration(true);
+        }
+        else if ((strcmp(argv[i],"-s") == 0) || 
+                 (strcmp(argv[i],"--stats") == 0)) {
+            Scene::setCullingReport(true);
+        }
         else {
             std::cout << "Invalid argument: " << argv[i] << "." << std::endl;
             return -1;
         }
     }
     
+    // Convert trajectory without starting the GUI
+    if (!convertVehicle.isEmpty()) {
+        QCoreApplication app(argc, argv);
+        return VehicleBuilder::exportTrajectory(convertVehicle, convertOutput) 
+            ? 0 : -1;
+    }
+    
     // Start application
     QApplication app(argc, argv);
     app.setApplicationName("3D viewer");
@@ -3,9 +3,13 @@
 #include <QDebug>
 
 
+std::atomic<unsigned int> Material::m_numMaterials(0);
+
+
 Material::Material(
     QString name, Texture * diffuse, Texture * normal, Texture * bump
 ) :
+    m_id(m_numMaterials++),
     m_name(name), 
     m_ambient(QVector3D(0.0f,0.0f,0.0f)), 
     m_diffuse(QVector3D(0.0f,0.0f,0.0f)), 
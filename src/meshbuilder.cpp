@@ -0,0 +1,106 @@
+#include "../include/meshbuilder.h"
+#include <QtGlobal>
+#include <cstring>
+
+MeshBuilder::MeshBuilder(std::size_t maxVertices, std::size_t maxIndices) :
+    m_numVertices(0),
+    m_numIndices(0),
+    m_packedSize(0),
+    m_isPacked(false) {
+    // Layout of the arena: the float streams, then the indices
+    const std::size_t vec3Size = 3 * maxVertices;
+    const std::size_t vec2Size = 2 * maxVertices;
+    const std::size_t numFloats = 4 * vec3Size + vec2Size;
+    p_arena.reset(new char[
+        numFloats * sizeof(float) + maxIndices * sizeof(unsigned int)
+    ]);
+    
+    float * floats = reinterpret_cast<float *>(p_arena.get());
+    m_capacity.vertices = Span<float>(floats, vec3Size);
+    m_capacity.normals = Span<float>(floats + vec3Size, vec3Size);
+    m_capacity.tangents = Span<float>(floats + 2 * vec3Size, vec3Size);
+    m_capacity.bitangents = Span<float>(floats + 3 * vec3Size, vec3Size);
+    m_capacity.textureUV = Span<float>(floats + 4 * vec3Size, vec2Size);
+    m_capacity.indices = Span<unsigned int>(
+        reinterpret_cast<unsigned int *>(floats + numFloats), maxIndices
+    );
+}
+
+
+std::size_t MeshBuilder::addVertices(std::size_t count) {
+    Q_ASSERT(3 * (m_numVertices + count) <= m_capacity.vertices.size());
+    const std::size_t first = m_numVertices;
+    m_numVertices += count;
+    return first;
+}
+
+
+IndexRange MeshBuilder::addIndices(
+    std::size_t count, std::size_t baseVertex, std::size_t numVertices
+) {
+    Q_ASSERT(!m_isPacked);
+    Q_ASSERT(m_numIndices + count <= m_capacity.indices.size());
+    IndexRange range;
+    range.first = m_numIndices;
+    range.count = count;
+    range.baseVertex = baseVertex;
+    range.indexSize = numVertices <= 65536 ? 2 : 4;
+    // The 32-bit indices are aligned on 4 bytes
+    range.byteOffset = 
+        (m_packedSize + range.indexSize - 1) / range.indexSize * range.indexSize;
+    m_packedSize = range.byteOffset + count * range.indexSize;
+    m_numIndices += count;
+    m_ranges.push_back(range);
+    return range;
+}
+
+
+void MeshBuilder::packIndices() {
+    // The packed indices never overtake the indices to pack: the ranges are
+    // packed in place in order
+    char * packed = reinterpret_cast<char *>(m_capacity.indices.data());
+    const unsigned int * indices = m_capacity.indices.data();
+    for (const IndexRange & range : m_ranges) {
+        char * output = packed + range.byteOffset;
+        const unsigned int baseVertex = 
+            static_cast<unsigned int>(range.baseVertex);
+        for (std::size_t i = range.first; i < range.first + range.count; i++) {
+            if (range.indexSize == 2) {
+                const quint16 index = static_cast<quint16>(indices[i] - baseVertex);
+                std::memcpy(output, &index, sizeof(quint16));
+            }
+            else {
+                const quint32 index = indices[i] - baseVertex;
+                std::memcpy(output, &index, sizeof(quint32));
+            }
+            output += range.indexSize;
+        }
+    }
+    m_isPacked = true;
+}
+
+
+MeshStreams MeshBuilder::getStreams() const {
+    MeshStreams streams;
+    streams.vertices = 
+        Span<float>(m_capacity.vertices.data(), 3 * m_numVertices);
+    streams.normals = 
+        Span<float>(m_capacity.normals.data(), 3 * m_numVertices);
+    streams.textureUV = 
+        Span<float>(m_capacity.textureUV.data(), 2 * m_numVertices);
+    streams.tangents = 
+        Span<float>(m_capacity.tangents.data(), 3 * m_numVertices);
+    streams.bitangents = 
+        Span<float>(m_capacity.bitangents.data(), 3 * m_numVertices);
+    if (m_isPacked) {
+        streams.packedIndices = Span<const char>(
+            reinterpret_cast<const char *>(m_capacity.indices.data()), 
+            m_packedSize
+        );
+    }
+    else {
+        streams.indices = 
+            Span<unsigned int>(m_capacity.indices.data(), m_numIndices);
+    }
+    return streams;
+}
@@ -0,0 +1,154 @@
+#include "../include/meshcache.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace {
+    static_assert(sizeof(MeshCache::FileHeader) == 152, "Invalid mesh cache file header");
+
+    const char c_magic[8] = {'V', 'M', 'M', 'E', 'S', 'H', '\0', '\0'};
+    const quint32 c_version = 5;
+    const quint32 c_byteOrder = 0x01020304;
+    const quint64 c_alignment = 16;
+
+    quint64 align(quint64 offset) {
+        return (offset + c_alignment - 1) / c_alignment * c_alignment;
+    }
+}
+
+
+QByteArray MeshCache::key(const QString & modelFile, quint32 importFlags,
+                          quint32 options) {
+    QFile file(modelFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file))
+        return QByteArray();
+    hash.addData(reinterpret_cast<const char *>(&importFlags), sizeof(quint32));
+    hash.addData(reinterpret_cast<const char *>(&options), sizeof(quint32));
+    hash.addData(reinterpret_cast<const char *>(&c_version), sizeof(quint32));
+    return hash.result();
+}
+
+
+QString MeshCache::fileName(const QByteArray & key) {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        "/meshes/" + QString::fromLatin1(key.toHex()) + ".mesh";
+}
+
+
+std::unique_ptr<MeshCache> MeshCache::open(const QByteArray & key) {
+    std::unique_ptr<QFile> file = std::make_unique<QFile>(fileName(key));
+    if (key.size() != static_cast<int>(sizeof(FileHeader::key)) ||
+        !file->open(QIODevice::ReadOnly))
+        return nullptr;
+
+    // Map the whole file: the pages are loaded by the OS when first accessed
+    const qint64 fileSize = file->size();
+    if (fileSize < static_cast<qint64>(sizeof(FileHeader))) {
+        qWarning() << "The mesh cache file" << file->fileName() <<
+            "is truncated.";
+        return nullptr;
+    }
+    const uchar * data = file->map(0, fileSize);
+    if (data == nullptr) {
+        qWarning() << "Unable to map the mesh cache file" << file->fileName();
+        return nullptr;
+    }
+
+    // Check the header
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(FileHeader));
+    if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+        header.version != c_version || header.byteOrder != c_byteOrder ||
+        std::memcmp(header.key, key.constData(), sizeof(header.key)) != 0) {
+        qWarning() << "The mesh cache file" << file->fileName() <<
+            "is not valid.";
+        return nullptr;
+    }
+    const quint64 size = static_cast<quint64>(fileSize);
+    bool valid = header.metadataOffset <= size &&
+        header.metadataSize <= size - header.metadataOffset;
+    for (unsigned int s = 0; s < NumStreams; s++) {
+        valid = valid && header.streamOffsets[s] % c_alignment == 0 &&
+            header.streamOffsets[s] <= size &&
+            header.streamSizes[s] <= size - header.streamOffsets[s];
+    }
+    if (!valid) {
+        qWarning() << "The mesh cache file" << file->fileName() <<
+            "is corrupted.";
+        return nullptr;
+    }
+
+    std::unique_ptr<MeshCache> cache(new MeshCache());
+    const char * bytes = reinterpret_cast<const char *>(data);
+    cache->m_metadata = QByteArray::fromRawData(
+        bytes + header.metadataOffset, static_cast<int>(header.metadataSize)
+    );
+    for (unsigned int s = 0; s < NumStreams; s++) {
+        cache->p_streams[s] = bytes + header.streamOffsets[s];
+        cache->m_streamSizes[s] = static_cast<qint64>(header.streamSizes[s]);
+    }
+    cache->p_file = std::move(file);
+    return cache;
+}
+
+
+bool MeshCache::save(
+    const QByteArray & key, const QByteArray & metadata,
+    const char * const streams[NumStreams], const qint64 sizes[NumStreams]
+) {
+    const QString name = fileName(key);
+    if (key.size() != static_cast<int>(sizeof(FileHeader::key)) ||
+        !QDir().mkpath(QFileInfo(name).absolutePath())) {
+        qWarning() << "Unable to create the mesh cache file" << name;
+        return false;
+    }
+
+    // Layout of the file
+    FileHeader header;
+    std::memset(&header, 0, sizeof(FileHeader));
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version = c_version;
+    header.byteOrder = c_byteOrder;
+    std::memcpy(header.key, key.constData(), sizeof(header.key));
+    header.metadataOffset = sizeof(FileHeader);
+    header.metadataSize = static_cast<quint64>(metadata.size());
+    quint64 offset = header.metadataOffset + header.metadataSize;
+    for (unsigned int s = 0; s < NumStreams; s++) {
+        header.streamOffsets[s] = align(offset);
+        header.streamSizes[s] = static_cast<quint64>(sizes[s]);
+        offset = header.streamOffsets[s] + header.streamSizes[s];
+    }
+
+    // Write the file. QSaveFile only replaces the existing file on commit so
+    // that a concurrent reader never sees a partial file.
+    QSaveFile file(name);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Unable to open file" << name << "for writing.";
+        return false;
+    }
+    const qint64 headerSize = static_cast<qint64>(sizeof(FileHeader));
+    bool ok = file.write(reinterpret_cast<const char *>(&header), headerSize)
+        == headerSize && file.write(metadata) == metadata.size();
+    const QByteArray padding(static_cast<int>(c_alignment), '\0');
+    quint64 position = header.metadataOffset + header.metadataSize;
+    for (unsigned int s = 0; ok && s < NumStreams; s++) {
+        const int paddingSize =
+            static_cast<int>(header.streamOffsets[s] - position);
+        ok = file.write(padding.constData(), paddingSize) == paddingSize &&
+            (sizes[s] == 0 || file.write(streams[s], sizes[s]) == sizes[s]);
+        position = header.streamOffsets[s] + header.streamSizes[s];
+    }
+    if (!ok || !file.commit()) {
+        qWarning() << "Error while writing file" << name;
+        return false;
+    }
+    return true;
+}
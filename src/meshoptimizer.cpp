@@ -0,0 +1,664 @@
+#include "../include/meshoptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace {
+    /**
+     * Parameters of the vertex score of the algorithm of Tom Forsyth.
+     */
+    const float c_cacheDecayPower = 1.5f;
+    const float c_lastTriangleScore = 0.75f;
+    const float c_valenceBoostScale = 2.0f;
+    const float c_valenceBoostPower = 0.5f;
+
+    /**
+     * Number of valences whose score is tabulated.
+     */
+    const unsigned int c_maxValence = 64;
+
+    /**
+     * Value of a triangle index meaning no triangle.
+     */
+    const std::size_t c_noTriangle = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Scores of the vertices by position in the cache and by number of
+     * remaining triangles.
+     */
+    struct ScoreTables {
+        float cache[MeshOptimizer::c_cacheSize];
+        float valence[c_maxValence];
+
+        ScoreTables() {
+            const unsigned int size = MeshOptimizer::c_cacheSize;
+            for (unsigned int i = 0; i < size; i++) {
+                // The vertices of the last triangle get a fixed score so that
+                // the strip does not always turn the same way
+                if (i < 3)
+                    cache[i] = c_lastTriangleScore;
+                else
+                    cache[i] = std::pow(1.0f - static_cast<float>(i - 3) /
+                        static_cast<float>(size - 3), c_cacheDecayPower);
+            }
+            valence[0] = 0.0f;
+            for (unsigned int i = 1; i < c_maxValence; i++) {
+                valence[i] = c_valenceBoostScale *
+                    std::pow(static_cast<float>(i), -c_valenceBoostPower);
+            }
+        }
+
+        /**
+         * @brief Score of a vertex, -1 when all its triangles are emitted.
+         * @param cachePosition The position in the cache, -1 if not cached.
+         * @param remaining The number of triangles not yet emitted.
+         */
+        float score(int cachePosition, unsigned int remaining) const {
+            if (remaining == 0)
+                return -1.0f;
+            float result = cachePosition < 0 ? 0.0f : cache[cachePosition];
+            // Boost the vertices with few triangles left to get rid of them
+            result += remaining < c_maxValence ? valence[remaining] :
+                c_valenceBoostScale * std::pow(static_cast<float>(remaining),
+                                               -c_valenceBoostPower);
+            return result;
+        }
+    };
+
+    /**
+     * Weight of the quadrics keeping the borders in place, relative to the
+     * quadrics of the triangles.
+     */
+    const float c_borderWeight = 10.0f;
+
+    /**
+     * @brief Quadric measuring the squared distance of a point to a set of
+     * weighted planes.
+     */
+    struct Quadric {
+        float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+        float a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+        float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+        float c = 0.0f;
+        float weight = 0.0f;
+
+        /**
+         * @brief Add the plane of unit normal n and going through the point p.
+         */
+        void addPlane(const float n[3], const float p[3], float w) {
+            const float d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+            a00 += w * n[0] * n[0];
+            a11 += w * n[1] * n[1];
+            a22 += w * n[2] * n[2];
+            a01 += w * n[0] * n[1];
+            a02 += w * n[0] * n[2];
+            a12 += w * n[1] * n[2];
+            b0 += w * d * n[0];
+            b1 += w * d * n[1];
+            b2 += w * d * n[2];
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric & q) {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22;
+            a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        /**
+         * @brief Return the weighted sum of the squared distances of p to the
+         * planes.
+         */
+        float evaluate(const float p[3]) const {
+            const float x = p[0], y = p[1], z = p[2];
+            const float result = a00 * x * x + a11 * y * y + a22 * z * z +
+                2.0f * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                2.0f * (b0 * x + b1 * y + b2 * z) + c;
+            return std::max(result, 0.0f);
+        }
+    };
+
+    /**
+     * @brief Cross product of the edges of a triangle, whose norm is twice its
+     * area.
+     */
+    void triangleNormal(
+        const float * p0, const float * p1, const float * p2, float n[3]
+    ) {
+        const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    /**
+     * @brief Key of the directed edge from the vertex a to the vertex b.
+     */
+    std::uint64_t edgeKey(unsigned int a, unsigned int b) {
+        return (static_cast<std::uint64_t>(a) << 32) | b;
+    }
+
+    /**
+     * @brief Return the sorted directed edges of the triangles.
+     */
+    std::vector<std::uint64_t> directedEdges(
+        const std::vector<unsigned int> & triangles
+    ) {
+        std::vector<std::uint64_t> edges(triangles.size());
+        for (std::size_t i = 0; i < triangles.size(); i += 3) {
+            for (unsigned int k = 0; k < 3; k++) {
+                edges[i + k] =
+                    edgeKey(triangles[i + k], triangles[i + (k + 1) % 3]);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        return edges;
+    }
+
+    /**
+     * @brief Return true if the directed edge from a to b is on a border, i.e.
+     * if no triangle has the edge from b to a.
+     */
+    bool isBorder(
+        const std::vector<std::uint64_t> & edges, unsigned int a, unsigned int b
+    ) {
+        return !std::binary_search(edges.begin(), edges.end(), edgeKey(b, a));
+    }
+}
+
+
+std::size_t MeshOptimizer::countCacheMisses(
+    Span<const unsigned int> indices, std::size_t firstVertex,
+    std::size_t numVertices, unsigned int cacheSize
+) {
+    // A vertex is in the FIFO cache if it has been added during the last
+    // cacheSize misses
+    std::vector<std::size_t> timestamps(numVertices, 0);
+    std::size_t time = cacheSize + 1;
+    std::size_t misses = 0;
+    for (unsigned int index : indices) {
+        const std::size_t v = index - firstVertex;
+        if (time - timestamps[v] > cacheSize) {
+            timestamps[v] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+
+void MeshOptimizer::optimizeVertexCache(
+    Span<unsigned int> indices, std::size_t firstVertex, std::size_t numVertices
+) {
+    const std::size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+    static const ScoreTables tables;
+
+    // Local indices of the vertices
+    std::vector<unsigned int> triangles(3 * numTriangles);
+    for (std::size_t i = 0; i < triangles.size(); i++)
+        triangles[i] = static_cast<unsigned int>(indices[i] - firstVertex);
+
+    // Triangles of each vertex. The triangles not yet emitted are at the
+    // beginning of the list of the vertex.
+    std::vector<unsigned int> remaining(numVertices, 0);
+    for (unsigned int v : triangles)
+        remaining[v]++;
+    std::vector<std::size_t> adjacencyOffsets(numVertices + 1, 0);
+    for (std::size_t v = 0; v < numVertices; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+    std::vector<std::size_t> adjacency(triangles.size());
+    {
+        std::vector<std::size_t> cursors(
+            adjacencyOffsets.begin(), adjacencyOffsets.end() - 1
+        );
+        for (std::size_t t = 0; t < numTriangles; t++) {
+            for (unsigned int k = 0; k < 3; k++)
+                adjacency[cursors[triangles[3 * t + k]]++] = t;
+        }
+    }
+
+    // Initial scores
+    std::vector<int> cachePositions(numVertices, -1);
+    std::vector<float> vertexScores(numVertices);
+    for (std::size_t v = 0; v < numVertices; v++)
+        vertexScores[v] = tables.score(-1, remaining[v]);
+    std::vector<float> triangleScores(numTriangles);
+    std::vector<bool> emitted(numTriangles, false);
+    std::size_t best = 0;
+    for (std::size_t t = 0; t < numTriangles; t++) {
+        triangleScores[t] = vertexScores[triangles[3 * t]] +
+            vertexScores[triangles[3 * t + 1]] +
+            vertexScores[triangles[3 * t + 2]];
+        if (triangleScores[t] > triangleScores[best])
+            best = t;
+    }
+
+    // Emit the triangles one by one, the next triangle being the best one
+    // among the triangles of the cached vertices
+    unsigned int cache[c_cacheSize + 3], newCache[c_cacheSize + 3];
+    unsigned int cacheCount = 0;
+    std::size_t cursor = 0;
+    unsigned int * output = indices.data();
+    for (std::size_t n = 0; n < numTriangles; n++) {
+        if (best == c_noTriangle) {
+            // Dead end: continue with the next triangle in the input order
+            while (emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+        emitted[best] = true;
+
+        // Emit the triangle and put its vertices at the front of the cache
+        unsigned int newCount = 0;
+        const unsigned int * triangle = &triangles[3 * best];
+        for (unsigned int k = 0; k < 3; k++) {
+            const unsigned int v = triangle[k];
+            *output++ = static_cast<unsigned int>(v + firstVertex);
+            std::size_t * first = &adjacency[adjacencyOffsets[v]];
+            std::size_t * last = first + remaining[v];
+            std::iter_swap(std::find(first, last, best), last - 1);
+            remaining[v]--;
+            if (std::find(newCache, newCache + newCount, v) ==
+                newCache + newCount)
+                newCache[newCount++] = v;
+        }
+        for (unsigned int i = 0; i < cacheCount; i++) {
+            const unsigned int v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache[newCount++] = v;
+        }
+
+        // Update the scores of the cached and evicted vertices
+        for (unsigned int i = 0; i < newCount; i++) {
+            const unsigned int v = newCache[i];
+            cachePositions[v] = i < c_cacheSize ? static_cast<int>(i) : -1;
+            vertexScores[v] = tables.score(cachePositions[v], remaining[v]);
+        }
+        cacheCount = std::min(newCount, c_cacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // Update the scores of their triangles and find the best one
+        best = c_noTriangle;
+        float bestScore = -1.0f;
+        for (unsigned int i = 0; i < newCount; i++) {
+            const unsigned int v = newCache[i];
+            const std::size_t * first = &adjacency[adjacencyOffsets[v]];
+            for (const std::size_t * t = first; t < first + remaining[v]; t++) {
+                const unsigned int * vertices = &triangles[3 * *t];
+                triangleScores[*t] = vertexScores[vertices[0]] +
+                    vertexScores[vertices[1]] + vertexScores[vertices[2]];
+                if (triangleScores[*t] > bestScore) {
+                    bestScore = triangleScores[*t];
+                    best = *t;
+                }
+            }
+        }
+    }
+}
+
+
+void MeshOptimizer::optimizeOverdraw(
+    Span<unsigned int> indices, Span<const float> vertices,
+    std::size_t firstVertex, std::size_t numVertices
+) {
+    const std::size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+
+    // Split the triangles into clusters where the cache is flushed
+    std::vector<std::size_t> clusterStarts;
+    std::vector<std::size_t> timestamps(numVertices, 0);
+    std::size_t time = c_cacheSize + 1;
+    for (std::size_t t = 0; t < numTriangles; t++) {
+        unsigned int misses = 0;
+        for (unsigned int k = 0; k < 3; k++) {
+            const std::size_t v = indices[3 * t + k] - firstVertex;
+            if (time - timestamps[v] > c_cacheSize) {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+            clusterStarts.push_back(t);
+    }
+    clusterStarts.push_back(numTriangles);
+
+    // Centroid of the mesh
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    for (std::size_t v = firstVertex; v < firstVertex + numVertices; v++) {
+        for (unsigned int c = 0; c < 3; c++)
+            center[c] += vertices[3 * v + c];
+    }
+    for (unsigned int c = 0; c < 3; c++)
+        center[c] /= static_cast<float>(std::max<std::size_t>(numVertices, 1));
+
+    // Sort the clusters by decreasing distance of their centroid to the
+    // centroid of the mesh along their normal: the clusters on the outside
+    // facing outwards first
+    struct Cluster {
+        float key;
+        std::size_t first;
+        std::size_t last;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size() - 1);
+    for (std::size_t i = 0; i < clusters.size(); i++) {
+        float centroid[3] = {0.0f, 0.0f, 0.0f}, normal[3] = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+        for (std::size_t t = clusterStarts[i]; t < clusterStarts[i + 1]; t++) {
+            const float * p0 = &vertices[3 * indices[3 * t]];
+            const float * p1 = &vertices[3 * indices[3 * t + 1]];
+            const float * p2 = &vertices[3 * indices[3 * t + 2]];
+            const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            const float n[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]
+            };
+            const float a = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (unsigned int c = 0; c < 3; c++) {
+                centroid[c] += a * (p0[c] + p1[c] + p2[c]) / 3.0f;
+                normal[c] += n[c];
+            }
+            area += a;
+        }
+        const float length = std::sqrt(
+            normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]
+        );
+        float key = 0.0f;
+        if (area > 0.0f && length > 0.0f) {
+            for (unsigned int c = 0; c < 3; c++)
+                key += (centroid[c] / area - center[c]) * normal[c] / length;
+        }
+        clusters[i] = {key, clusterStarts[i], clusterStarts[i + 1]};
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const Cluster & a, const Cluster & b) {return a.key > b.key;}
+    );
+
+    // Write the triangles of the clusters in order
+    const std::vector<unsigned int> input(indices.begin(), indices.end());
+    unsigned int * output = indices.data();
+    for (const Cluster & cluster : clusters) {
+        output = std::copy(
+            input.begin() + 3 * cluster.first, input.begin() + 3 * cluster.last,
+            output
+        );
+    }
+}
+
+
+void MeshOptimizer::optimizeVertexFetch(
+    Span<unsigned int> indices, const MeshStreams & streams,
+    std::size_t firstVertex, std::size_t numVertices
+) {
+    // New position of each vertex, in the order of first use
+    const unsigned int c_unused = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(numVertices, c_unused);
+    unsigned int next = 0;
+    for (unsigned int & index : indices) {
+        unsigned int & v = remap[index - firstVertex];
+        if (v == c_unused)
+            v = next++;
+        index = static_cast<unsigned int>(v + firstVertex);
+    }
+    for (unsigned int & v : remap) {
+        if (v == c_unused)
+            v = next++;
+    }
+
+    // Move the data of the vertices
+    std::vector<float> buffer(3 * numVertices);
+    auto permute = [&](const Span<float> & stream, unsigned int components) {
+        float * data = stream.data() + components * firstVertex;
+        std::copy(data, data + components * numVertices, buffer.begin());
+        for (std::size_t v = 0; v < numVertices; v++) {
+            std::copy_n(&buffer[components * v], components,
+                        data + components * remap[v]);
+        }
+    };
+    permute(streams.vertices, 3);
+    permute(streams.normals, 3);
+    permute(streams.textureUV, 2);
+    permute(streams.tangents, 3);
+    permute(streams.bitangents, 3);
+}
+
+
+std::vector<unsigned int> MeshOptimizer::simplify(
+    Span<const unsigned int> indices, Span<const float> vertices,
+    std::size_t firstVertex, std::size_t numVertices, std::size_t targetCount,
+    float maxError, float & error
+) {
+    // Local indices of the vertices
+    std::vector<unsigned int> triangles(indices.size() / 3 * 3);
+    for (std::size_t i = 0; i < triangles.size(); i++)
+        triangles[i] = static_cast<unsigned int>(indices[i] - firstVertex);
+    const float * positions = vertices.data() + 3 * firstVertex;
+    auto position = [positions](unsigned int v) {return positions + 3 * v;};
+
+    // Kind of the vertices: the vertices sharing their position with another
+    // vertex, and the vertices of non-manifold edges or of several borders
+    // are locked
+    enum Kind : unsigned char {Manifold, Border, Locked};
+    std::vector<Kind> kinds(numVertices, Manifold);
+    {
+        std::vector<unsigned int> order(numVertices);
+        for (unsigned int v = 0; v < numVertices; v++)
+            order[v] = v;
+        auto less = [&](unsigned int a, unsigned int b) {
+            return std::lexicographical_compare(
+                position(a), position(a) + 3, position(b), position(b) + 3
+            );
+        };
+        std::sort(order.begin(), order.end(), less);
+        for (std::size_t i = 1; i < numVertices; i++) {
+            if (!less(order[i - 1], order[i]))
+                kinds[order[i - 1]] = kinds[order[i]] = Locked;
+        }
+    }
+    std::vector<unsigned char> borderEdges(numVertices, 0);
+    {
+        const std::vector<std::uint64_t> edges = directedEdges(triangles);
+        for (std::size_t i = 0; i < edges.size(); i++) {
+            const unsigned int a = static_cast<unsigned int>(edges[i] >> 32);
+            const unsigned int b = static_cast<unsigned int>(edges[i]);
+            if (i > 0 && edges[i] == edges[i - 1])
+                kinds[a] = kinds[b] = Locked;
+            else if (isBorder(edges, a, b)) {
+                borderEdges[a]++;
+                borderEdges[b]++;
+            }
+        }
+    }
+    for (std::size_t v = 0; v < numVertices; v++) {
+        if (kinds[v] == Manifold && borderEdges[v] > 0)
+            kinds[v] = borderEdges[v] == 2 ? Border : Locked;
+    }
+
+    // Quadrics of the planes of the triangles, weighted by their area, and of
+    // the planes keeping the borders in place
+    std::vector<Quadric> quadrics(numVertices);
+    {
+        const std::vector<std::uint64_t> edges = directedEdges(triangles);
+        for (std::size_t i = 0; i < triangles.size(); i += 3) {
+            float n[3];
+            triangleNormal(
+                position(triangles[i]), position(triangles[i + 1]),
+                position(triangles[i + 2]), n
+            );
+            const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0f)
+                continue;
+            for (unsigned int c = 0; c < 3; c++)
+                n[c] /= length;
+            for (unsigned int k = 0; k < 3; k++) {
+                quadrics[triangles[i + k]].addPlane(
+                    n, position(triangles[i]), 0.5f * length
+                );
+                const unsigned int a = triangles[i + k];
+                const unsigned int b = triangles[i + (k + 1) % 3];
+                if (!isBorder(edges, a, b))
+                    continue;
+                // Plane of the border perpendicular to the triangle
+                const float * pa = position(a);
+                const float * pb = position(b);
+                const float e[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+                float m[3] = {
+                    e[1] * n[2] - e[2] * n[1],
+                    e[2] * n[0] - e[0] * n[2],
+                    e[0] * n[1] - e[1] * n[0]
+                };
+                const float edgeLength =
+                    std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+                if (edgeLength == 0.0f)
+                    continue;
+                for (unsigned int c = 0; c < 3; c++)
+                    m[c] /= edgeLength;
+                const float w = c_borderWeight * edgeLength * edgeLength;
+                quadrics[a].addPlane(m, pa, w);
+                quadrics[b].addPlane(m, pa, w);
+            }
+        }
+    }
+
+    // Collapse the edges by passes, the cheapest first. A vertex moves at most
+    // once per pass, and the vertices around a collapsed vertex do not move.
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        float cost;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> targets(numVertices);
+    std::vector<bool> locked(numVertices);
+    std::vector<std::size_t> adjacencyOffsets(numVertices + 1);
+    std::vector<std::size_t> adjacency;
+    float maxCost = 0.0f;
+    while (triangles.size() > targetCount) {
+        // Triangles of each vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int v : triangles)
+            adjacencyOffsets[v + 1]++;
+        for (std::size_t v = 0; v < numVertices; v++)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(triangles.size());
+        {
+            std::vector<std::size_t> cursors(
+                adjacencyOffsets.begin(), adjacencyOffsets.end() - 1
+            );
+            for (std::size_t i = 0; i < triangles.size(); i++)
+                adjacency[cursors[triangles[i]]++] = i / 3;
+        }
+
+        // Cost of the possible collapses
+        const std::vector<std::uint64_t> edges = directedEdges(triangles);
+        collapses.clear();
+        for (std::size_t i = 0; i < triangles.size(); i += 3) {
+            for (unsigned int k = 0; k < 3; k++) {
+                const unsigned int a = triangles[i + k];
+                const unsigned int b = triangles[i + (k + 1) % 3];
+                for (unsigned int d = 0; d < 2; d++) {
+                    const unsigned int from = d == 0 ? a : b;
+                    const unsigned int to = d == 0 ? b : a;
+                    if (kinds[from] == Locked || (kinds[from] == Border &&
+                        !isBorder(edges, a, b) && !isBorder(edges, b, a)))
+                        continue;
+                    Quadric quadric = quadrics[from];
+                    quadric.add(quadrics[to]);
+                    const float cost = quadric.evaluate(position(to)) /
+                        std::max(quadric.weight, 1e-20f);
+                    collapses.push_back({from, to, cost});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse & a, const Collapse & b) {return a.cost < b.cost;}
+        );
+
+        // Collapse the edges until the target is reached. A collapse removes
+        // two triangles.
+        const std::size_t goal =
+            std::max<std::size_t>((triangles.size() - targetCount) / 6, 1);
+        std::size_t count = 0;
+        for (unsigned int v = 0; v < numVertices; v++)
+            targets[v] = v;
+        std::fill(locked.begin(), locked.end(), false);
+        for (const Collapse & collapse : collapses) {
+            if (count >= goal || collapse.cost > maxError * maxError)
+                break;
+            if (locked[collapse.from] || locked[collapse.to])
+                continue;
+
+            // Reject the collapses flipping a triangle
+            bool flip = false;
+            for (std::size_t j = adjacencyOffsets[collapse.from];
+                 j < adjacencyOffsets[collapse.from + 1] && !flip; j++) {
+                const unsigned int * t = &triangles[3 * adjacency[j]];
+                if (t[0] == collapse.to || t[1] == collapse.to ||
+                    t[2] == collapse.to)
+                    continue;
+                float before[3], after[3];
+                triangleNormal(position(t[0]), position(t[1]),
+                               position(t[2]), before);
+                const unsigned int moved[3] = {
+                    t[0] == collapse.from ? collapse.to : t[0],
+                    t[1] == collapse.from ? collapse.to : t[1],
+                    t[2] == collapse.from ? collapse.to : t[2]
+                };
+                triangleNormal(position(moved[0]), position(moved[1]),
+                               position(moved[2]), after);
+                const float dot = before[0] * after[0] +
+                    before[1] * after[1] + before[2] * after[2];
+                const float lengths = std::sqrt(
+                    (before[0] * before[0] + before[1] * before[1] +
+                     before[2] * before[2]) *
+                    (after[0] * after[0] + after[1] * after[1] +
+                     after[2] * after[2])
+                );
+                flip = dot < 0.25f * lengths;
+            }
+            if (flip)
+                continue;
+
+            targets[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+            for (std::size_t j = adjacencyOffsets[collapse.from];
+                 j < adjacencyOffsets[collapse.from + 1]; j++) {
+                const unsigned int * t = &triangles[3 * adjacency[j]];
+                locked[t[0]] = locked[t[1]] = locked[t[2]] = true;
+            }
+            locked[collapse.to] = true;
+            count++;
+        }
+        if (count == 0)
+            break;
+
+        // Remove the degenerate triangles
+        std::size_t size = 0;
+        for (std::size_t i = 0; i < triangles.size(); i += 3) {
+            const unsigned int a = targets[triangles[i]];
+            const unsigned int b = targets[triangles[i + 1]];
+            const unsigned int c = targets[triangles[i + 2]];
+            if (a != b && b != c && a != c) {
+                triangles[size++] = a;
+                triangles[size++] = b;
+                triangles[size++] = c;
+            }
+        }
+        triangles.resize(size);
+    }
+
+    error = std::sqrt(maxCost);
+    for (unsigned int & v : triangles)
+        v = static_cast<unsigned int>(v + firstVertex);
+    return triangles;
+}
@@ -1,4 +1,45 @@
 #include "../include/object.h"
+#include "../include/meshoptimizer.h"
+#include "../include/numberparser.h"
+#include "../include/renderqueue.h"
+#include "../include/tangentspace.h"
+#include "../include/threadpool.h"
+#include "../include/trajectory.h"
+#include <QCoreApplication>
+#include <qfloat16.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+    /**
+     * Vertex of the packed vertex format.
+     */
+    struct PackedVertex {
+        float position[3];
+        /** Normal in GL_INT_2_10_10_10_REV. */
+        quint32 normal;
+        /** Tangent in GL_INT_2_10_10_10_REV, w is the handedness. */
+        quint32 tangent;
+        qfloat16 texCoord[2];
+    };
+    static_assert(sizeof(PackedVertex) == 24, "Invalid packed vertex");
+    
+    /**
+     * @brief Pack a vector of components in [-1, 1] into a 
+     * GL_INT_2_10_10_10_REV integer, normalized as in OpenGL 4.2 and later.
+     */
+    quint32 packSnorm1010102(float x, float y, float z, float w) {
+        auto pack = [](float value, float scale, quint32 mask) {
+            value = std::max(-1.0f, std::min(1.0f, value));
+            return static_cast<quint32>(
+                static_cast<qint32>(std::round(value * scale))
+            ) & mask;
+        };
+        return pack(x, 511.0f, 0x3ff) | (pack(y, 511.0f, 0x3ff) << 10) |
+            (pack(z, 511.0f, 0x3ff) << 20) | (pack(w, 1.0f, 0x3) << 30);
+    }
+}
 
 /***
  *       ____   _      _              _   
@@ -11,6 +52,13 @@
  *                  |__/                  
  */
 
+Object::VertexFormat Object::m_vertexFormat = Object::VertexFormat::Float;
+
+float Object::m_lodMaxError = 0.001f;
+
+float Object::m_shadowLodMaxError = 0.004f;
+
+
 void Object::initialize() {
     // If the model is not correctly loaded, do nothing
     if(m_error) {
@@ -27,13 +75,34 @@ void Object::initialize() {
 }
 
 
+std::weak_ptr<ObjectShader> Object::m_sharedObjectShader;
+
+std::weak_ptr<ObjectShadowShader> Object::m_sharedShadowShader;
+
+
 void Object::createShaderPrograms() {
-    p_objectShader = std::make_unique<ObjectShader>(
-        ":/shaders/object.vert", ":/shaders/object.frag"
-    );
-    p_shadowShader = std::make_unique<ObjectShadowShader>(
-        ":/shaders/object_shadow.vert", ":/shaders/object_shadow.frag"
-    );
+    // The programs are shared by the objects so that the render queue groups
+    // their draws
+    p_objectShader = m_sharedObjectShader.lock();
+    if (!p_objectShader) {
+        p_objectShader = std::make_shared<ObjectShader>(
+            ":/shaders/object.vert", ":/shaders/object.frag"
+        );
+        p_objectShader->bind();
+        p_objectShader->setSamplerUniforms();
+        p_objectShader->release();
+        m_sharedObjectShader = p_objectShader;
+    }
+    p_shadowShader = m_sharedShadowShader.lock();
+    if (!p_shadowShader) {
+        p_shadowShader = std::make_shared<ObjectShadowShader>(
+            ":/shaders/object_shadow.vert", ":/shaders/object_shadow.frag"
+        );
+        p_shadowShader->bind();
+        p_shadowShader->setSamplerUniforms();
+        p_shadowShader->release();
+        m_sharedShadowShader = p_shadowShader;
+    }
 }
 
 
@@ -41,73 +110,192 @@ void Object::createBuffers() {
     // Create a vertex array object
     m_vao.create();
     m_vao.bind();
+    
+    // Size of the vertex data in the float format
+    const int numVertices = 
+        getBufferData(MeshCache::Vertices).second / (3 * sizeof(float));
+    int floatSize = 0;
+    for (unsigned int s = 0; s < MeshCache::NumStreams; s++) {
+        if (s != MeshCache::Indices)
+            floatSize += getBufferData(static_cast<MeshCache::Stream>(s)).second;
+    }
+    int vertexSize = floatSize;
+    
+    m_isPacked = m_vertexFormat == VertexFormat::Packed;
+    if (m_isPacked) {
+        vertexSize = createPackedVertexBuffer();
+    }
+    else {
+        // Create a buffer and copy the vertex data to it
+        std::pair<const void *, int> data = 
+            getBufferData(MeshCache::Vertices);
+        m_vertexBuffer.create();
+        m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_vertexBuffer.bind();
+        m_vertexBuffer.allocate(data.first, data.second);
+
+        // Create a buffer and copy the vertex data to it
+        data = getBufferData(MeshCache::Normals);
+        m_normalBuffer.create();
+        m_normalBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_normalBuffer.bind();
+        m_normalBuffer.allocate(data.first, data.second);
+
+        // Create a buffer and copy the vertex data to it
+        data = getBufferData(MeshCache::TextureUV);
+        if (data.second != 0) {
+            m_textureUVBuffer.create();
+            m_textureUVBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+            m_textureUVBuffer.bind();
+            m_textureUVBuffer.allocate(data.first, data.second);
+        }
+        
+        // Create a buffer and copy the tangent data to it
+        data = getBufferData(MeshCache::Tangents);
+        m_tangentBuffer.create();
+        m_tangentBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_tangentBuffer.bind();
+        m_tangentBuffer.allocate(data.first, data.second);
+        
+        // Create a buffer and copy the bitangent data to it
+        data = getBufferData(MeshCache::Bitangents);
+        m_bitangentBuffer.create();
+        m_bitangentBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_bitangentBuffer.bind();
+        m_bitangentBuffer.allocate(data.first, data.second);
+    }
 
-    // Create a buffer and copy the vertex data to it
+    // Create a buffer and copy the index data to it
+    std::pair<const void *, int> data = getBufferData(MeshCache::Indices);
+    m_indexBuffer.create();
+    m_indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_indexBuffer.bind();
+    m_indexBuffer.allocate(data.first, data.second);
+    
+    // Report the memory used by the vertex data
+    qInfo().nospace() << "Vertex data of the object: " << numVertices 
+        << " vertices, " << vertexSize << " bytes in the " 
+        << (m_isPacked ? "packed" : "float") << " format (" << floatSize 
+        << " bytes in the float format), " << data.second 
+        << " bytes of indices.";
+    
+    // Free the buffer data in one go
+    m_streams = MeshStreams();
+    p_arena.reset();
+    p_cache.reset();
+}
+
+
+int Object::createPackedVertexBuffer() {
+    // Streams of the float format
+    const std::pair<const void *, int> positionData = 
+        getBufferData(MeshCache::Vertices);
+    const std::pair<const void *, int> normalData = 
+        getBufferData(MeshCache::Normals);
+    const std::pair<const void *, int> texCoordData = 
+        getBufferData(MeshCache::TextureUV);
+    const std::pair<const void *, int> tangentData = 
+        getBufferData(MeshCache::Tangents);
+    const std::pair<const void *, int> bitangentData = 
+        getBufferData(MeshCache::Bitangents);
+    const float * positions = static_cast<const float *>(positionData.first);
+    const float * normals = static_cast<const float *>(normalData.first);
+    const float * texCoords = static_cast<const float *>(texCoordData.first);
+    const float * tangents = static_cast<const float *>(tangentData.first);
+    const float * bitangents = static_cast<const float *>(bitangentData.first);
+    
+    // The streams are shorter than the vertices if the meshes have no normals,
+    // texture coordinates or tangents
+    const int vec3Size = 3 * sizeof(float);
+    const int numVertices = positionData.second / vec3Size;
+    const int numNormals = normalData.second / vec3Size;
+    const int numTexCoords = texCoordData.second / (2 * sizeof(float));
+    const int numTangents = 
+        std::min(tangentData.second, bitangentData.second) / vec3Size;
+    
+    // Interleave and pack the attributes
+    std::vector<PackedVertex> vertices(static_cast<std::size_t>(numVertices));
+    for (int i = 0; i < numVertices; i++) {
+        PackedVertex & vertex = vertices[static_cast<std::size_t>(i)];
+        std::copy(positions + 3*i, positions + 3*i + 3, vertex.position);
+        
+        const float * n = i < numNormals ? normals + 3*i : nullptr;
+        vertex.normal = n != nullptr ? 
+            packSnorm1010102(n[0], n[1], n[2], 0.0f) : 0;
+        
+        // The handedness of the tangent frame replaces the bitangent: the 
+        // bitangent is cross(normal, tangent) * handedness
+        if (i < numTangents && n != nullptr) {
+            const float * t = tangents + 3*i;
+            const float * b = bitangents + 3*i;
+            const float handedness = 
+                (n[1]*t[2] - n[2]*t[1]) * b[0] + 
+                (n[2]*t[0] - n[0]*t[2]) * b[1] + 
+                (n[0]*t[1] - n[1]*t[0]) * b[2] < 0.0f ? -1.0f : 1.0f;
+            vertex.tangent = packSnorm1010102(t[0], t[1], t[2], handedness);
+        }
+        else {
+            vertex.tangent = packSnorm1010102(1.0f, 0.0f, 0.0f, 1.0f);
+        }
+        
+        if (i < numTexCoords) {
+            vertex.texCoord[0] = qfloat16(texCoords[2*i]);
+            vertex.texCoord[1] = qfloat16(texCoords[2*i+1]);
+        }
+        else {
+            vertex.texCoord[0] = vertex.texCoord[1] = qfloat16(0.0f);
+        }
+    }
+    
+    // Create a buffer and copy the interleaved data to it
+    const int size = numVertices * static_cast<int>(sizeof(PackedVertex));
     m_vertexBuffer.create();
     m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
     m_vertexBuffer.bind();
-    m_vertexBuffer.allocate(
-        &(*p_vertices)[0],
-        p_vertices->size() * sizeof(float)
-    );
+    m_vertexBuffer.allocate(vertices.data(), size);
+    return size;
+}
 
-    // Create a buffer and copy the vertex data to it
-    m_normalBuffer.create();
-    m_normalBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_normalBuffer.bind();
-    m_normalBuffer.allocate(
-        &(*p_normals)[0], 
-        p_normals->size() * sizeof(float)
-    );
 
-    // Create a buffer and copy the vertex data to it
-    if (p_textureUV != nullptr && p_textureUV->size() != 0) {
-        m_textureUVBuffer.create();
-        m_textureUVBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-        m_textureUVBuffer.bind();
-        int texSize = 0;
-        for (int i = 0; i < p_textureUV->size(); i++)
-            texSize += p_textureUV->at(i).size();
-        m_textureUVBuffer.allocate(
-            &(*p_textureUV)[0][0], 
-            texSize * sizeof(float)
+std::pair<const void *, int> Object::getBufferData(
+    MeshCache::Stream stream
+) const {
+    if (p_cache != nullptr) {
+        return std::make_pair(
+            static_cast<const void *>(p_cache->stream(stream)), 
+            static_cast<int>(p_cache->streamSize(stream))
         );
     }
-
-    // Create a buffer and copy the index data to it
-    m_indexBuffer.create();
-    m_indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_indexBuffer.bind();
-    m_indexBuffer.allocate(
-        &(*p_indices)[0], 
-        p_indices->size() * sizeof(unsigned int)
-    );
-    
-    // Create a buffer and copy the tangent data to it
-    m_tangentBuffer.create();
-    m_tangentBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_tangentBuffer.bind();
-    m_tangentBuffer.allocate(
-        &(*p_tangents)[0],
-        p_tangents->size() * sizeof(float)
-    );
     
-    // Create a buffer and copy the bitangent data to it
-    m_bitangentBuffer.create();
-    m_bitangentBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_bitangentBuffer.bind();
-    m_bitangentBuffer.allocate(
-        &(*p_bitangents)[0],
-        p_bitangents->size() * sizeof(float)
+    Span<float> data;
+    switch (stream) {
+        case MeshCache::Vertices:
+            data = m_streams.vertices;
+            break;
+        case MeshCache::Normals:
+            data = m_streams.normals;
+            break;
+        case MeshCache::TextureUV:
+            data = m_streams.textureUV;
+            break;
+        case MeshCache::Indices:
+            return std::make_pair(
+                static_cast<const void *>(m_streams.packedIndices.data()), 
+                static_cast<int>(m_streams.packedIndices.size())
+            );
+        case MeshCache::Tangents:
+            data = m_streams.tangents;
+            break;
+        case MeshCache::Bitangents:
+            data = m_streams.bitangents;
+            break;
+        default:
+            return std::make_pair(nullptr, 0);
+    }
+    return std::make_pair(
+        static_cast<const void *>(data.data()), 
+        static_cast<int>(data.size() * sizeof(float))
     );
-    
-    // Free the buffer data
-    p_vertices.reset();
-    p_normals.reset();
-    p_textureUV.reset();
-    p_indices.reset();
-    p_tangents.reset();
-    p_bitangents.reset();
 }
 
 
@@ -123,11 +311,33 @@ void Object::createAttributes() {
     p_shadowShader->setAttributeBuffer(0,          // layout location
                                        GL_FLOAT,   // data type
                                        0,          // Offset to data in buffer
-                                       3);         // number of components
+                                       3,          // number of components
+                                       m_isPacked ? sizeof(PackedVertex) : 0);
     
     // Set up the vertex array state
     p_objectShader->bind();
 
+    if (m_isPacked) {
+        // Map the interleaved vertex data to the vertex shader layout 
+        // locations. The normal and tangent are normalized integers, the 
+        // bitangent is computed from the handedness in the w of the tangent.
+        const int stride = sizeof(PackedVertex);
+        m_vertexBuffer.bind();
+        p_objectShader->enableAttributeArray(0);
+        p_objectShader->setAttributeBuffer(0, GL_FLOAT, 
+            offsetof(PackedVertex, position), 3, stride);
+        p_objectShader->enableAttributeArray(1);
+        p_objectShader->setAttributeBuffer(1, GL_INT_2_10_10_10_REV, 
+            offsetof(PackedVertex, normal), 4, stride);
+        p_objectShader->enableAttributeArray(2);
+        p_objectShader->setAttributeBuffer(2, GL_HALF_FLOAT, 
+            offsetof(PackedVertex, texCoord), 2, stride);
+        p_objectShader->enableAttributeArray(3);
+        p_objectShader->setAttributeBuffer(3, GL_INT_2_10_10_10_REV, 
+            offsetof(PackedVertex, tangent), 4, stride);
+        return;
+    }
+
     // Map vertex data to the vertex shader layout location '0'
     m_vertexBuffer.bind();
     p_objectShader->enableAttributeArray(0);       // layout location
@@ -172,78 +382,8 @@ void Object::createAttributes() {
 }
 
 
-void Object::getTangentsAndBitangents(
-    const QVector<float> & vertices, 
-    const QVector<QVector<float>> & textureUV,
-    const QVector<unsigned int> & indices, 
-    QVector<float> & tangents,
-    QVector<float> & bitangents
-) {
-    const unsigned int numTriangles = indices.size() / 3;
-    const unsigned int numVertices = vertices.size() / 3;
-    tangents   = QVector<float>(3 * numVertices);
-    bitangents = QVector<float>(3 * numVertices);
-    for (unsigned int i = 0; i < numTriangles; i++) {
-        // Indices of the triangle vertices
-        unsigned int i0 = indices.at(3*i);
-        unsigned int i1 = indices.at(3*i+1);
-        unsigned int i2 = indices.at(3*i+2);
-        // Position of the triangle vertices
-        QVector<float> pos0 = vertices.mid(3*i0,3);
-        QVector<float> pos1 = vertices.mid(3*i1,3);
-        QVector<float> pos2 = vertices.mid(3*i2,3);
-        // Texture coordinates of the triangle vertices
-        QVector<float> tex0 = textureUV.at(0).mid(2*i0,2);
-        QVector<float> tex1 = textureUV.at(0).mid(2*i1,2);
-        QVector<float> tex2 = textureUV.at(0).mid(2*i2,2);
-        // Compute edges
-        QVector3D edge1 = QVector3D(
-            pos1[0] - pos0[0], pos1[1] - pos0[1], pos1[2] - pos0[2]
-        );
-        QVector3D edge2 = QVector3D(
-            pos2[0] - pos0[0], pos2[1] - pos0[1], pos2[2] - pos0[2]
-        );
-        QVector2D uv1 = QVector2D(tex1[0] - tex0[0], tex1[1] - tex0[1]);
-        QVector2D uv2 = QVector2D(tex2[0] - tex0[0], tex2[1] - tex0[1]);
-        // Compute the tangent and bitangent of the triangle
-        float r = 1.0f / (uv1.x() * uv2.y() - uv2.x() * uv1.y());
-        QVector3D tangent = r * QVector3D(
-            edge1.x() * uv2.y() - edge2.x() * uv1.y(),
-            edge1.y() * uv2.y() - edge2.y() * uv1.y(),
-            edge1.z() * uv2.y() - edge2.z() * uv1.y()
-        );
-        tangent.normalize();
-        QVector3D bitangent = r * QVector3D(
-            -edge1.x() * uv2.x() + edge2.x() * uv1.x(),
-            -edge1.y() * uv2.x() + edge2.y() * uv1.x(),
-            -edge1.z() * uv2.x() + edge2.z() * uv1.x()
-        );
-        bitangent.normalize();
-        // Add tangent and bitangent to the buffer data
-        tangents[3*i0  ] = tangent.x();
-        tangents[3*i0+1] = tangent.y();
-        tangents[3*i0+2] = tangent.z();
-        tangents[3*i1  ] = tangent.x();
-        tangents[3*i1+1] = tangent.y();
-        tangents[3*i1+2] = tangent.z();
-        tangents[3*i2  ] = tangent.x();
-        tangents[3*i2+1] = tangent.y();
-        tangents[3*i2+2] = tangent.z();
-        bitangents[3*i0  ] = bitangent.x();
-        bitangents[3*i0+1] = bitangent.y();
-        bitangents[3*i0+2] = bitangent.z();
-        bitangents[3*i1  ] = bitangent.x();
-        bitangents[3*i1+1] = bitangent.y();
-        bitangents[3*i1+2] = bitangent.z();
-        bitangents[3*i2  ] = bitangent.x();
-        bitangents[3*i2+1] = bitangent.y();
-        bitangents[3*i2+2] = bitangent.z();
-    }
-}
-
-
 void Object::render(
-    const CasterLight & light, const QMatrix4x4 & view, 
+    const CasterLight & /*light*/, const QMatrix4x4 & view, 
     const QMatrix4x4 & projection, const QMatrix4x4 lightSpace[], 
     const std::array<float,NUM_CASCADES+1> * cascades, ObjectShader * shader
 )  {
@@ -258,38 +398,97 @@ void Object::render(
         exit(1);
     }
     
-    // Bind shader program
-    shader->bind();
-
-    // Set light shader uniform
-    shader->setLightUniforms(light, view);
-    
-    // Set cascade uniform
-    if (cascades != nullptr)
-        shader->setCascadeUniforms(*cascades);
-
-    // Bind VAO and draw everything
-    m_vao.bind();
+    // The levels of detail are selected and the meshes culled with the 
+    // projection of the pass: the camera for the color pass, the cascade for
+    // the shadow pass. The shadow casters between the light and the cascade
+    // are kept: they may cast shadows into it.
+    RenderPass pass;
+    if (cascades != nullptr) {
+        pass.viewProjection = projection * view;
+        pass.maxError = m_lodMaxError;
+        pass.nearPlane = true;
+        pass.stats = &CullingStats::color();
+    }
+    else {
+        pass.viewProjection = lightSpace[0];
+        pass.maxError = m_shadowLodMaxError;
+        pass.nearPlane = false;
+        pass.stats = &CullingStats::shadow();
+    }
     
-    // Draw opaque node
-    MeshesToDrawLater tMeshes;
-    p_rootNode->drawNode(
-        m_model, view, projection, lightSpace, tMeshes, shader
-    );
+    // The world matrices of the nodes are computed when the model matrix 
+    // changes
+    if (m_isModelDirty) {
+        for (std::size_t i = 0; i < m_nodes.size(); i++)
+            m_worldMatrices[i] = m_model * m_nodes[i].transformation;
+        m_isModelDirty = false;
+    }
     
-    // Draw transparent nodes from farthest to closest
-    for (
-        MeshesToDrawLater::reverse_iterator it = tMeshes.rbegin(); 
-        it != tMeshes.rend(); it++
-    ) {
-        if (it->second.second != nullptr) {
-            shader->setMatrixUniforms(
-                it->second.first, view, projection, lightSpace
+    // Push the meshes into the render queue, which sorts them by state and 
+    // draws the transparent meshes from farthest to closest. The nodes are 
+    // skipped with their descendants if they are outside the frustum. The 
+    // descendants of a node inside the frustum (i.e. before insideEnd) are 
+    // not tested.
+    RenderQueue & queue = RenderQueue::global();
+    RenderQueue::Draw draw;
+    draw.shader = shader;
+    draw.vao = &m_vao;
+    CullingStats & stats = *pass.stats;
+    std::size_t insideEnd = 0;
+    for (std::size_t i = 0; i < m_nodes.size(); ) {
+        const NodeRecord & node = m_nodes[i];
+        const QMatrix4x4 & object = m_worldMatrices[i];
+        const QMatrix4x4 modelViewProjection = pass.viewProjection * object;
+        const Frustum frustum(modelViewProjection, pass.nearPlane);
+        const bool inside = i < insideEnd;
+        if (!inside) {
+            const Frustum::Test test = frustum.test(node.boundingBox);
+            if (test == Frustum::Outside) {
+                stats.culledMeshes += node.numSubtreeMeshes;
+                i = node.end;
+                continue;
+            }
+            if (test == Frustum::Inside)
+                insideEnd = node.end;
+        }
+        i++;
+        if (node.numMeshes == 0)
+            continue;
+        draw.matrix = queue.pushMatrix(object);
+        
+        // Push the meshes of the node
+        for (unsigned int m = node.firstMesh; 
+             m < node.firstMesh + node.numMeshes; m++) {
+            const Mesh * mesh = m_meshes[m].get();
+            if (!inside && 
+                frustum.test(mesh->getBoundingBox()) == Frustum::Outside) {
+                stats.culledMeshes++;
+                continue;
+            }
+            stats.drawnMeshes++;
+            
+            const Mesh::Level & level = mesh->getLevels()[
+                mesh->selectLevel(modelViewProjection, pass.maxError)
+            ];
+            draw.material = cascades != nullptr ? 
+                mesh->getMaterial().get() : nullptr;
+            draw.count = level.count;
+            draw.offset = level.offset;
+            draw.baseVertex = mesh->getBaseVertex();
+            draw.indexSize = mesh->getIndexSize();
+            
+            // The depth of the mesh is the w of its center in clip 
+            // coordinates, i.e. its distance along the view direction
+            const float depth = QVector4D::dotProduct(
+                modelViewProjection.row(3), QVector4D(mesh->getCenter(), 1.0f)
             );
-            it->second.second->drawMesh(shader);
+            RenderQueue::Pass meshPass = RenderQueue::Shadow;
+            if (cascades != nullptr)
+                meshPass = mesh->isOpaque() ? 
+                    RenderQueue::Opaque : RenderQueue::Transparent;
+            queue.push(meshPass, depth, draw);
         }
     }
-    m_vao.release();
 }
 
 
@@ -321,6 +520,40 @@ void Object::cleanUp() {
 }
 
 
+void Object::compileNodes(const Node * rootNode) {
+    if (rootNode == nullptr)
+        return;
+    compileNode(*rootNode, QMatrix4x4());
+    m_worldMatrices.resize(m_nodes.size());
+    m_boundingBox = m_nodes.front().boundingBox.transformed(
+        m_nodes.front().transformation
+    );
+}
+
+
+void Object::compileNode(
+    const Node & node, const QMatrix4x4 & parentTransformation
+) {
+    const std::size_t index = m_nodes.size();
+    NodeRecord record;
+    record.transformation = parentTransformation * node.getTransformation();
+    record.boundingBox = node.getBoundingBox();
+    record.firstMesh = static_cast<unsigned int>(m_meshes.size());
+    record.numMeshes = static_cast<unsigned int>(node.getMeshes().size());
+    m_nodes.push_back(record);
+    m_meshes.insert(
+        m_meshes.end(), node.getMeshes().begin(), node.getMeshes().end()
+    );
+    
+    // The descendants follow the node
+    for (const std::unique_ptr<const Node> & child : node.getChildren())
+        compileNode(*child, record.transformation);
+    m_nodes[index].numSubtreeMeshes = 
+        static_cast<unsigned int>(m_meshes.size()) - record.firstMesh;
+    m_nodes[index].end = static_cast<unsigned int>(m_nodes.size());
+}
+
+
 
 /***
  *      _   _             _       
@@ -333,50 +566,19 @@ void Object::cleanUp() {
  *                                
  */
 
-void Object::Node::drawNode(
-    const QMatrix4x4 & model, const QMatrix4x4 & view, 
-    const QMatrix4x4 & projection, const QMatrix4x4 lightSpace[],
-    Object::MeshesToDrawLater& drawLaterMeshes, ObjectShader* objectShader
-) const {
-    if (!objectShader) {
-        qWarning() << __FILE__ << __LINE__ <<
-             "The pointer to the shader is null.";
-        return;
-    }
-    
-    // Compute model matrix of the node and set uniforms
-    QMatrix4x4 object = model * m_transformation;
-    objectShader->setMatrixUniforms(object, view, projection, lightSpace);
-    
-    // Draw the meshes of the node
-    for (unsigned int i = 0; i < m_meshes.size(); i++) {
-        // Check if the mesh is opaque or transparent
-        if (m_meshes[i]->isOpaque()) {
-            // Draw now
-            m_meshes[i]->drawMesh(objectShader);
-        }
-        else {
-            // Store the mesh in the container to draw it later
-            QVector3D objectPosition(object * QVector3D(0.0f, 0.0f, 0.0f));
-            QVector3D cameraPosition(view.inverted().column(3));
-            float distance(cameraPosition.distanceToPoint(objectPosition));
-            
-            // Add the info on the mesh to the map to draw it later
-            drawLaterMeshes.insert(
-                std::make_pair(
-                    distance,                   // Key of the map
-                    std::make_pair(             // Mesh and model matrix
-                        object, m_meshes[i].get()
-                    )
-                )
-            );
-        }
-    }
-    
-    // Draw the children recursively
-    for (unsigned int i = 0; i < m_children.size(); i++) {
-        m_children[i]->drawNode(
-            object, view, projection, lightSpace, drawLaterMeshes, objectShader
+Object::Node::Node(
+    const QString name, const QMatrix4x4 transformation, 
+    const std::vector<std::shared_ptr<const Mesh>> meshes,
+    std::vector<std::unique_ptr<const Node>> children
+) : m_name(name), m_transformation(transformation), m_meshes(meshes), 
+m_children(std::move(children)) {
+    // The bounding box contains the meshes and the children moved into the
+    // coordinates of the node
+    for (const std::shared_ptr<const Mesh> & mesh : m_meshes)
+        m_boundingBox.expand(mesh->getBoundingBox());
+    for (const std::unique_ptr<const Node> & child : m_children) {
+        m_boundingBox.expand(
+            child->m_boundingBox.transformed(child->m_transformation)
         );
     }
 }
@@ -394,37 +596,35 @@ void Object::Node::drawNode(
  *                               
  */
 
-#include <QOpenGLFunctions>
+#include <QOpenGLFunctions_3_3_Core>
 
-void Object::Mesh::drawMesh(ObjectShader * objectShader) const {
-    if (!objectShader) {
-        qWarning() << __FILE__ << __LINE__ <<
-             "The pointer to the shader is null.";
-        return;
-    }
-    QOpenGLContext * context = QOpenGLContext::currentContext();
-    if (!context) {
-        qWarning() << __FILE__ << __LINE__ <<
-                      "Requires a valid current OpenGL context. \n" <<
-                      "Unable to draw the object.";
-        return;
-    }
-    QOpenGLFunctions * glFunctions = context->functions();
-    
-    // Set material uniforms in OpenGL
-    objectShader->setMaterialUniforms(*m_material);
-    
-    // Draw the mesh
-    glFunctions->glDrawElements(
-        GL_TRIANGLES,
-        static_cast<GLsizei>(m_indexCount),
-        GL_UNSIGNED_INT,
-        reinterpret_cast<const void*>(m_indexOffset * sizeof(unsigned int))
-    );
+unsigned int Object::Mesh::selectLevel(
+    const QMatrix4x4 & modelViewProjection, float maxError
+) const {
+    if (m_levels.size() == 1)
+        return 0;
+    
+    // Smallest clip-space w of the bounding sphere, i.e. distance to the 
+    // camera of its closest point (constant for an orthographic projection).
+    // The full-detail mesh is drawn if the sphere crosses the near plane.
+    const QVector4D rowW = modelViewProjection.row(3);
+    const float w = QVector4D::dotProduct(rowW, QVector4D(m_center, 1.0f)) - 
+        m_radius * rowW.toVector3D().length();
+    if (w <= 0.0f)
+        return 0;
+    
+    // An error of e in the mesh spans e * scale / w in normalized device 
+    // coordinates, whose height is 2
+    const float scale = modelViewProjection.row(1).toVector3D().length();
+    const float maxMeshError = 2.0f * maxError * w / scale;
+    unsigned int level = 0;
+    while (level + 1 < m_levels.size() && 
+           m_levels[level + 1].error <= maxMeshError)
+        level++;
+    return level;
 }
 
 
-
 /***
  *                             _                     
  *            /\              (_)                    
@@ -451,7 +651,24 @@ void Object::Mesh::drawMesh(ObjectShader * objectShader) const {
 #include <QFile>
 #include <QDir>
 
+const unsigned int Object::Loader::c_importFlags = 
+    aiProcess_GenSmoothNormals |
+    aiProcess_CalcTangentSpace |
+    aiProcess_Triangulate |
+    aiProcess_JoinIdenticalVertices |
+    aiProcess_SortByPType;
+
+const float Object::Loader::c_maxLodError = 0.05f;
+
+bool Object::Loader::m_optimizeMeshes = false;
+
+bool Object::Loader::m_generateLods = false;
+
 std::unique_ptr<Object> Object::Loader::getObject() {
+    // The vertex array object is a QObject: when the model is loaded by a 
+    // worker thread, move it to the main thread which initializes the object
+    if (p_object != nullptr && QCoreApplication::instance() != nullptr)
+        p_object->m_vao.moveToThread(QCoreApplication::instance()->thread());
     return move(p_object);
 }
 
@@ -468,14 +685,19 @@ bool Object::Loader::build() {
             << "The directory" << m_textureDir << "does not exist.";
     }
     
+    // Load the model from the mesh cache if the model has not changed since
+    // the cache has been written
+    const QByteArray cacheKey = MeshCache::key(
+        m_filePath, c_importFlags, 
+        (m_optimizeMeshes ? 1u : 0u) | (m_generateLods ? 2u : 0u)
+    );
+    if (!cacheKey.isEmpty() && loadCache(cacheKey))
+        return true;
+    
     // Load the model with Assimp
     Assimp::Importer importer;
     const aiScene * scene = importer.ReadFile(m_filePath.toStdString(),
-            aiProcess_GenSmoothNormals |
-            aiProcess_CalcTangentSpace |
-            aiProcess_Triangulate |
-            aiProcess_JoinIdenticalVertices |
-            aiProcess_SortByPType);
+                                              c_importFlags);
     
     if (!scene) {
         qDebug() << __FILE__ << __LINE__ <<"Error loading file: (assimp:) " <<
@@ -484,30 +706,38 @@ bool Object::Loader::build() {
     }
     
     // Process the materials of the model
+    std::vector<MaterialInfo> materialInfos;
     std::vector<std::shared_ptr<const Material>> materials;
     if (scene->HasMaterials()) {
         for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+            materialInfos.push_back(processMaterial(scene->mMaterials[i]));
             materials.push_back(
-                processMaterial(scene->mMaterials[i], m_textureDir)
+                createMaterial(materialInfos.back(), m_textureDir)
             );
         }
     }
     
-    // Process the meshes
+    // Process the meshes. The streams are sized from the mesh counts so that
+    // they are allocated once.
     std::vector<std::shared_ptr<const Mesh>> meshes;
-    std::unique_ptr<QVector<float>> vertices;
-    std::unique_ptr<QVector<float>> normals;
-    std::unique_ptr<QVector<QVector<float>>> textureUV;
-    std::unique_ptr<QVector<unsigned int>> indices;
-    std::unique_ptr<QVector<float>> tangents;
-    std::unique_ptr<QVector<float>> bitangents;
+    std::size_t numVertices = 0, numIndices = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        numVertices += scene->mMeshes[i]->mNumVertices;
+        numIndices += 3 * static_cast<std::size_t>(scene->mMeshes[i]->mNumFaces);
+    }
+    // The levels of detail are appended after the meshes. Each level has at
+    // most 3/4 of the indices of the previous one.
+    std::size_t maxIndices = numIndices;
+    for (std::size_t l = 0, size = numIndices; 
+         m_generateLods && l < c_maxLodLevels; l++) {
+        size = (3 * size + 3) / 4;
+        maxIndices += size;
+    }
+    MeshBuilder builder(numVertices, maxIndices);
     if (scene->HasMeshes()) {
         for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
             meshes.push_back(
-                processMesh(
-                    scene->mMeshes[i], materials,
-                    vertices, normals, textureUV, indices, tangents, bitangents
-                )
+                processMesh(scene->mMeshes[i], materials, builder)
             );
         }
     }
@@ -521,6 +751,14 @@ bool Object::Loader::build() {
         qDebug() << "The model has light sources. Ignore it.";
     }
     
+    // Reorder the triangles and vertices of the meshes
+    if (m_optimizeMeshes)
+        optimizeMeshes(builder.getStreams(), scene, meshes);
+    
+    // Simplify the meshes
+    if (m_generateLods)
+        generateLods(builder, scene, meshes);
+    
     // Process the nodes
     std::unique_ptr<const Node> rootNode;
     if (scene->mRootNode != nullptr) {
@@ -530,41 +768,43 @@ bool Object::Loader::build() {
         qDebug() << "Error while loading the model.";
         return false;
     }
+    
     // Build the object
+    builder.packIndices();
     p_object = std::make_unique<Object>(
-        std::move(rootNode), std::move(vertices), std::move(normals), 
-        std::move(textureUV), std::move(indices), std::move(tangents), 
-        std::move(bitangents)
+        std::move(rootNode), builder.getStreams(), builder.releaseArena()
     );
     
+    // Write the mesh cache to skip Assimp on the next loads
+    if (!cacheKey.isEmpty() && !p_object->m_error)
+        saveCache(cacheKey, scene, materialInfos, meshes, *p_object);
+    
     return true;
 }
 
 
-std::shared_ptr<const Material> Object::Loader::processMaterial(
-    const aiMaterial* material, const QString textureDir
+Object::Loader::MaterialInfo Object::Loader::processMaterial(
+    const aiMaterial* material
 ) {
-    std::shared_ptr<Material> mater(nullptr);
+    MaterialInfo info;
 
     // Get material name
     aiString mname;
     material->Get(AI_MATKEY_NAME, mname);
-    QString name;
     if(mname.length > 0)
-        name = QString(mname.C_Str());
+        info.name = QString(mname.C_Str());
     
     // Check if the model is using a supported shading model (Phong or Gouraud)
     int shadingModel;
     material->Get(AI_MATKEY_SHADING_MODEL, shadingModel);
-    if(shadingModel != aiShadingMode_Phong 
-        && shadingModel != aiShadingMode_Gouraud) {
+    info.isSupported = shadingModel == aiShadingMode_Phong 
+        || shadingModel == aiShadingMode_Gouraud;
+    if(!info.isSupported) {
         qDebug() << __FILE__ << __LINE__ <<
-            "The shading model of the mesh" << name << 
+            "The shading model of the mesh" << info.name << 
             "is not implemented in this object loader." <<
             "Use default material.";
-        
-        mater = std::make_shared<Material>(name);
-        mater->setAlpha(1.0f);
+        info.alpha = 1.0f;
     }
     // The shading model is supported
     else {
@@ -581,33 +821,51 @@ std::shared_ptr<const Material> Object::Loader::processMaterial(
         material->Get(AI_MATKEY_SHININESS, shine);
         material->Get(AI_MATKEY_OPACITY, alpha);
         
-        // Load the texture of the material
-        std::vector<Texture *> diffuseTextures = loadMaterialTextures(
-            material, Texture::Type::Diffuse, textureDir
-        );
-        if (diffuseTextures.size() == 0)
-            diffuseTextures.push_back(nullptr);
-        std::vector<Texture *> normalTextures = loadMaterialTextures(
-            material, Texture::Type::Normal, textureDir
-        );
-        if (normalTextures.size() == 0)
-            normalTextures.push_back(nullptr);
-        mater = std::make_shared<Material>(
-            name, diffuseTextures.at(0), normalTextures.at(0));
-        mater->setAmbientColor(QVector3D(amb.r, amb.g, amb.b));
-        mater->setDiffuseColor(QVector3D(dif.r, dif.g, dif.b));
-        mater->setSpecularColor(QVector3D(spec.r, spec.g, spec.b));
-        mater->setShininess(shine);
-        mater->setAlpha(alpha);
+        info.ambient = QVector3D(amb.r, amb.g, amb.b);
+        info.diffuse = QVector3D(dif.r, dif.g, dif.b);
+        info.specular = QVector3D(spec.r, spec.g, spec.b);
+        info.shininess = shine;
+        info.alpha = alpha;
+        
+        // Get the textures of the material
+        info.diffuseTexture = getTexturePath(material, Texture::Type::Diffuse);
+        info.normalTexture = getTexturePath(material, Texture::Type::Normal);
     }
     
+    return info;
+}
+
+
+std::shared_ptr<const Material> Object::Loader::createMaterial(
+    const MaterialInfo & info, const QString textureDir
+) {
+    std::shared_ptr<Material> mater(nullptr);
+    if (!info.isSupported) {
+        mater = std::make_shared<Material>(info.name);
+        mater->setAlpha(1.0f);
+        return mater;
+    }
+    
+    // Load the texture of the material
+    Texture * diffuseTexture = loadMaterialTexture(
+        info.diffuseTexture, Texture::Type::Diffuse, textureDir
+    );
+    Texture * normalTexture = loadMaterialTexture(
+        info.normalTexture, Texture::Type::Normal, textureDir
+    );
+    mater = std::make_shared<Material>(
+        info.name, diffuseTexture, normalTexture);
+    mater->setAmbientColor(info.ambient);
+    mater->setDiffuseColor(info.diffuse);
+    mater->setSpecularColor(info.specular);
+    mater->setShininess(info.shininess);
+    mater->setAlpha(info.alpha);
     return mater;
 }
 
 
-std::vector<Texture *> Object::Loader::loadMaterialTextures(
-    const aiMaterial* material, const Texture::Type type, 
-    const QString textureDir
+QString Object::Loader::getTexturePath(
+    const aiMaterial* material, const Texture::Type type
 ) {
     // Convert to the corresponding Assimp texture type
     aiTextureType aiType;
@@ -627,59 +885,45 @@ std::vector<Texture *> Object::Loader::loadMaterialTextures(
         default:
             qCritical() << __FILE__ << __LINE__ <<
             "No corresponding Assimp type for type" << type;
-            return std::vector<Texture *>();
+            return QString();
     }
     
-    // Load all the textures used by the model
-    std::vector<Texture *> textures;
-    for (unsigned int i = 0; i < material->GetTextureCount(aiType); i++) {
-        // Get the texture path from Assimp
-        aiString pathString;
-        material->GetTexture(aiType, i, &pathString);
-        QString path = QString(pathString.C_Str());
-        path.prepend(textureDir);
-        
-        // Check the texture file exists
-        if (!QFile::exists(path))
-            qCritical() << __FILE__ << __LINE__ << 
-                "The path" << path 
-                << "to the texture file is not valid";
-        QImage image(path);
-        if (image.isNull())
-            qCritical() << __FILE__ << __LINE__ << 
-                "The image file does not exist.";
-        
-        // Load the texture
-        Texture * thisTexture = TextureManager::loadTexture(path, type, image);
-        textures.push_back(thisTexture);
-    }
-    return textures;
+    // Only the first texture of each type is used by the material
+    if (material->GetTextureCount(aiType) == 0)
+        return QString();
+    aiString pathString;
+    material->GetTexture(aiType, 0, &pathString);
+    return QString(pathString.C_Str());
+}
+
+
+Texture * Object::Loader::loadMaterialTexture(
+    const QString & path, const Texture::Type type, const QString textureDir
+) {
+    if (path.isEmpty())
+        return nullptr;
+    const QString fullPath = textureDir + path;
+    
+    // Check the texture file exists
+    if (!QFile::exists(fullPath))
+        qCritical() << __FILE__ << __LINE__ << 
+            "The path" << fullPath 
+            << "to the texture file is not valid";
+    QImage image(fullPath);
+    if (image.isNull())
+        qCritical() << __FILE__ << __LINE__ << 
+            "The image file does not exist.";
+    
+    // Load the texture
+    return TextureManager::loadTexture(fullPath, type, image);
 }
 
 
 std::shared_ptr<const Object::Mesh> Object::Loader::processMesh(
     const aiMesh* mesh, 
     const std::vector<std::shared_ptr<const Material>> & materials, 
-    std::unique_ptr<QVector<float>> & vertices, 
-    std::unique_ptr<QVector<float>> & normals,
-    std::unique_ptr<QVector<QVector<float>>> & textureUV,
-    std::unique_ptr<QVector<unsigned int>> & indices,
-    std::unique_ptr<QVector<float>> & tangents, 
-    std::unique_ptr<QVector<float>> & bitangents
+    MeshBuilder & builder
 ) {
-    if (!vertices)
-        vertices = std::make_unique<QVector<float>>();
-    if (!normals)
-        normals = std::make_unique<QVector<float>>();
-    if (!textureUV)
-        textureUV = std::make_unique<QVector<QVector<float>>>();
-    if (!indices)
-        indices = std::make_unique<QVector<unsigned int>>();
-    if (!tangents)
-        tangents = std::make_unique<QVector<float>>();
-    if (!bitangents)
-        bitangents = std::make_unique<QVector<float>>();
-    
     // Get the mesh name
     QString name;
     if (mesh->mName.length != 0)
@@ -687,98 +931,229 @@ std::shared_ptr<const Object::Mesh> Object::Loader::processMesh(
     else
         name = QString("");
     
-    // Get the mesh offset index in the index buffer
-    unsigned int offset = static_cast<unsigned int>(indices->size());
-    unsigned int vertexOffset = static_cast<unsigned int>(vertices->size()/3);
+    // Count the triangles of the mesh
+    unsigned int numTriangles = 0;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        if (mesh->mFaces[i].mNumIndices == 3)
+            numTriangles++;
+        else
+            qDebug() << "Model loading: Mesh face with not exactly 3 indices,"
+                << "ignore the primitive" << mesh->mFaces[i].mNumIndices;
+    }
+    
+    // Reserve the vertices and indices of the mesh in the streams
+    const std::size_t numVertices = mesh->mNumVertices;
+    const std::size_t vertexOffset = builder.addVertices(numVertices);
+    const IndexRange range = 
+        builder.addIndices(3 * numTriangles, vertexOffset, numVertices);
+    const std::size_t offset = range.first;
+    const MeshStreams streams = builder.getStreams();
     
     // Retrieve the vertices of the mesh
-    if (mesh->mNumVertices > 0) {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-            aiVector3D & vec = mesh->mVertices[i];
-            vertices->push_back(vec.x);
-            vertices->push_back(vec.y);
-            vertices->push_back(vec.z);
-        }
+    float * vertices = &streams.vertices[3 * vertexOffset];
+    for (std::size_t i = 0; i < numVertices; i++) {
+        const aiVector3D & vec = mesh->mVertices[i];
+        vertices[3*i] = vec.x;
+        vertices[3*i+1] = vec.y;
+        vertices[3*i+2] = vec.z;
     }
     
     // Retrieve the normals of the mesh
+    float * normals = &streams.normals[3 * vertexOffset];
     if (mesh->HasNormals()) {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-            aiVector3D & vec = mesh->mNormals[i];
-            normals->push_back(vec.x);
-            normals->push_back(vec.y);
-            normals->push_back(vec.z);
+        for (std::size_t i = 0; i < numVertices; i++) {
+            const aiVector3D & vec = mesh->mNormals[i];
+            normals[3*i] = vec.x;
+            normals[3*i+1] = vec.y;
+            normals[3*i+2] = vec.z;
         }
     }
+    else {
+        std::fill(normals, normals + 3 * numVertices, 0.0f);
+    }
     
-    // Retrieve the texture coordinates
-    unsigned int numUV = mesh->GetNumUVChannels();
-    if (numUV > 0) {
-        if (textureUV->size() < static_cast<int>(numUV)) {
-            // It is assumed that all the meshes have the same number of UV 
-            // channels (number of texture coordinates). Resize the textureUV
-            // if the number of UV channel is not the same.
-            textureUV->resize(numUV);
-        }
-        for (unsigned int iChannel = 0; iChannel < numUV; iChannel++) {
-            for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-                (*textureUV)[iChannel].push_back(
-                    mesh->mTextureCoords[iChannel][i].x
-                );
-                if (mesh->mNumUVComponents[iChannel]> 1) {
-                    (*textureUV)[iChannel].push_back(
-                        mesh->mTextureCoords[iChannel][i].y
-                    );
-                    if (mesh->mNumUVComponents[iChannel] > 2) {
-                        (*textureUV)[iChannel].push_back(
-                            mesh->mTextureCoords[iChannel][i].z
-                        );
-                    }
-                }
-            }
+    // Retrieve the texture coordinates. Only the first UV channel is used by 
+    // the shader.
+    float * textureUV = &streams.textureUV[2 * vertexOffset];
+    if (mesh->HasTextureCoords(0)) {
+        const bool hasV = mesh->mNumUVComponents[0] > 1;
+        for (std::size_t i = 0; i < numVertices; i++) {
+            textureUV[2*i] = mesh->mTextureCoords[0][i].x;
+            textureUV[2*i+1] = hasV ? mesh->mTextureCoords[0][i].y : 0.0f;
         }
     }
+    else {
+        std::fill(textureUV, textureUV + 2 * numVertices, 0.0f);
+    }
     
     // Retrieve the indices of the mesh
+    unsigned int * indices = &streams.indices[offset];
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace * face = &mesh->mFaces[i];
-        if (face->mNumIndices != 3) {
-            qDebug() << "Model loading: Mesh face with not exactly 3 indices,"
-                << "ignore the primitive" << face->mNumIndices;
+        const aiFace * face = &mesh->mFaces[i];
+        if (face->mNumIndices != 3)
             continue;
-        }
-        indices->push_back(face->mIndices[0] + vertexOffset);
-        indices->push_back(face->mIndices[1] + vertexOffset);
-        indices->push_back(face->mIndices[2] + vertexOffset);
+        *indices++ = face->mIndices[0] + static_cast<unsigned int>(vertexOffset);
+        *indices++ = face->mIndices[1] + static_cast<unsigned int>(vertexOffset);
+        *indices++ = face->mIndices[2] + static_cast<unsigned int>(vertexOffset);
     }
-    unsigned int count = static_cast<unsigned int>(indices->size()) - offset;
+    const unsigned int count = 3 * numTriangles;
     
-    // Retrieve tangents and bitangents
+    // Retrieve tangents and bitangents, or generate them from the texture 
+    // coordinates
     if (mesh->HasTangentsAndBitangents()) {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-            // Check orientation
-            aiVector3D & tan   = mesh->mTangents[i];
-            aiVector3D & bitan = mesh->mBitangents[i];
-            tangents->push_back(tan.x);
-            tangents->push_back(tan.y);
-            tangents->push_back(tan.z);
-            bitangents->push_back(bitan.x);
-            bitangents->push_back(bitan.y);
-            bitangents->push_back(bitan.z);
+        float * tangents = &streams.tangents[3 * vertexOffset];
+        float * bitangents = &streams.bitangents[3 * vertexOffset];
+        for (std::size_t i = 0; i < numVertices; i++) {
+            const aiVector3D & tan   = mesh->mTangents[i];
+            const aiVector3D & bitan = mesh->mBitangents[i];
+            tangents[3*i] = tan.x;
+            tangents[3*i+1] = tan.y;
+            tangents[3*i+2] = tan.z;
+            bitangents[3*i] = bitan.x;
+            bitangents[3*i+1] = bitan.y;
+            bitangents[3*i+2] = bitan.z;
         }
     }
+    else {
+        MeshStreams meshStreams = streams;
+        meshStreams.indices = Span<unsigned int>(&streams.indices[offset], count);
+        TangentSpace::generate(meshStreams, vertexOffset, numVertices);
+    }
     
     // Find the material of the mesh
     std::shared_ptr<const Material> material = materials.at(mesh->mMaterialIndex);
     
     // Create the mesh
     std::shared_ptr<const Mesh> newMesh = std::make_shared<Mesh>(
-        name, count, offset, material
+        name, count, static_cast<unsigned int>(range.byteOffset), 
+        BoundingBox::fromPositions(vertices, numVertices),
+        static_cast<unsigned int>(range.baseVertex), range.indexSize, material
     );
     return newMesh;
 }
 
 
+void Object::Loader::optimizeMeshes(
+    const MeshStreams & streams, const aiScene * scene, 
+    const std::vector<std::shared_ptr<const Mesh>> & meshes
+) const {
+    // The meshes are independent: optimize them in parallel. The indices of
+    // the meshes are reserved one after the other by processMesh().
+    std::vector<std::size_t> indexOffsets(meshes.size() + 1, 0);
+    for (std::size_t i = 0; i < meshes.size(); i++)
+        indexOffsets[i + 1] = indexOffsets[i] + meshes[i]->getIndexCount();
+    std::vector<std::size_t> missesBefore(meshes.size()), 
+        missesAfter(meshes.size());
+    ThreadPool::global().parallelFor(meshes.size(), [&](std::size_t i) {
+        const Span<unsigned int> indices(
+            &streams.indices[indexOffsets[i]], meshes[i]->getIndexCount()
+        );
+        const std::size_t first = meshes[i]->getBaseVertex();
+        const std::size_t count = scene->mMeshes[i]->mNumVertices;
+        missesBefore[i] = 
+            MeshOptimizer::countCacheMisses(indices, first, count);
+        MeshOptimizer::optimizeVertexCache(indices, first, count);
+        MeshOptimizer::optimizeOverdraw(indices, streams.vertices, first, count);
+        MeshOptimizer::optimizeVertexFetch(indices, streams, first, count);
+        missesAfter[i] = 
+            MeshOptimizer::countCacheMisses(indices, first, count);
+    });
+    
+    // Report the ACMR of the whole model
+    std::size_t before = 0, after = 0, numTriangles = 0;
+    for (std::size_t i = 0; i < meshes.size(); i++) {
+        before += missesBefore[i];
+        after += missesAfter[i];
+        numTriangles += meshes[i]->getIndexCount() / 3;
+    }
+    if (numTriangles > 0) {
+        qInfo() << "Mesh optimization of" << m_filePath << ": ACMR" 
+            << static_cast<float>(before) / numTriangles << "->" 
+            << static_cast<float>(after) / numTriangles << "(" << numTriangles 
+            << "triangles, cache of" << MeshOptimizer::c_cacheSize 
+            << "vertices)";
+    }
+}
+
+
+void Object::Loader::generateLods(
+    MeshBuilder & builder, const aiScene * scene, 
+    std::vector<std::shared_ptr<const Mesh>> & meshes
+) const {
+    const MeshStreams streams = builder.getStreams();
+    std::vector<std::size_t> indexOffsets(meshes.size() + 1, 0);
+    for (std::size_t i = 0; i < meshes.size(); i++)
+        indexOffsets[i + 1] = indexOffsets[i] + meshes[i]->getIndexCount();
+    
+    // Simplify the meshes in parallel. Each level is simplified from the 
+    // previous one to half its triangles, so that the errors add up.
+    std::vector<std::vector<std::vector<unsigned int>>> lodIndices(
+        meshes.size()
+    );
+    std::vector<std::vector<float>> lodErrors(meshes.size());
+    ThreadPool::global().parallelFor(meshes.size(), [&](std::size_t i) {
+        const std::size_t first = meshes[i]->getBaseVertex();
+        const std::size_t count = scene->mMeshes[i]->mNumVertices;
+        const float radius = meshes[i]->getRadius();
+        
+        Span<const unsigned int> indices(
+            &streams.indices[indexOffsets[i]], meshes[i]->getIndexCount()
+        );
+        float error = 0.0f;
+        for (unsigned int l = 0; l < c_maxLodLevels; l++) {
+            // Stop when the mesh cannot be simplified further within the
+            // maximum error
+            float levelError = 0.0f;
+            std::vector<unsigned int> level = MeshOptimizer::simplify(
+                indices, streams.vertices, first, count, indices.size() / 6 * 3,
+                c_maxLodError * radius - error, levelError
+            );
+            if (level.empty() || 4 * level.size() > 3 * indices.size())
+                break;
+            MeshOptimizer::optimizeVertexCache(
+                Span<unsigned int>(level.data(), level.size()), first, count
+            );
+            error += levelError;
+            lodIndices[i].push_back(std::move(level));
+            lodErrors[i].push_back(error);
+            indices = Span<const unsigned int>(
+                lodIndices[i].back().data(), lodIndices[i].back().size()
+            );
+        }
+    });
+    
+    // Append the levels to the index stream and replace the meshes
+    std::size_t numIndices = 0, numLodIndices = 0;
+    for (std::size_t i = 0; i < meshes.size(); i++) {
+        const std::shared_ptr<const Mesh> & mesh = meshes[i];
+        std::vector<Mesh::Level> levels(1, Mesh::Level{
+            mesh->getIndexCount(), mesh->getIndexOffset(), 0.0f
+        });
+        for (std::size_t l = 0; l < lodIndices[i].size(); l++) {
+            const std::vector<unsigned int> & level = lodIndices[i][l];
+            const IndexRange range = builder.addIndices(
+                level.size(), mesh->getBaseVertex(), 
+                scene->mMeshes[i]->mNumVertices
+            );
+            std::copy(level.begin(), level.end(), &streams.indices[range.first]);
+            levels.push_back(Mesh::Level{
+                static_cast<unsigned int>(range.count), 
+                static_cast<unsigned int>(range.byteOffset), lodErrors[i][l]
+            });
+            numLodIndices += level.size();
+        }
+        numIndices += mesh->getIndexCount();
+        meshes[i] = std::make_shared<Mesh>(
+            mesh->getName(), levels, mesh->getBoundingBox(), 
+            mesh->getBaseVertex(), mesh->getIndexSize(), mesh->getMaterial()
+        );
+    }
+    qInfo() << "Levels of detail of" << m_filePath << ":" << numLodIndices / 3
+        << "triangles added to the" << numIndices / 3 << "triangles of the"
+        << meshes.size() << "meshes";
+}
+
+
 std::unique_ptr<const Object::Node> Object::Loader::processNode(
     const aiNode * node, const aiScene * scene, 
     const std::vector<std::shared_ptr<const Mesh>> & sceneMeshes
@@ -818,6 +1193,179 @@ std::unique_ptr<const Object::Node> Object::Loader::processNode(
 }
 
 
+bool Object::Loader::loadCache(const QByteArray & key) {
+    std::unique_ptr<const MeshCache> cache = MeshCache::open(key);
+    if (!cache)
+        return false;
+    QDataStream stream(cache->metadata());
+    stream.setVersion(QDataStream::Qt_5_6);
+    
+    // Read the materials
+    quint32 numMaterials = 0;
+    stream >> numMaterials;
+    std::vector<std::shared_ptr<const Material>> materials;
+    for (quint32 i = 0; i < numMaterials && stream.status() == QDataStream::Ok; 
+         i++) {
+        MaterialInfo info;
+        stream >> info.name >> info.isSupported >> info.ambient >> info.diffuse
+            >> info.specular >> info.shininess >> info.alpha 
+            >> info.diffuseTexture >> info.normalTexture;
+        if (stream.status() == QDataStream::Ok)
+            materials.push_back(createMaterial(info, m_textureDir));
+    }
+    
+    // Read the meshes. Their index ranges and base vertices must lie inside 
+    // the streams, which are read in place by the draw calls.
+    const quint64 indicesSize = 
+        static_cast<quint64>(cache->streamSize(MeshCache::Indices));
+    const quint64 numVertices = 
+        static_cast<quint64>(cache->streamSize(MeshCache::Vertices)) / 
+        (3 * sizeof(float));
+    quint32 numMeshes = 0;
+    stream >> numMeshes;
+    std::vector<std::shared_ptr<const Mesh>> meshes;
+    for (quint32 i = 0; i < numMeshes && stream.status() == QDataStream::Ok; 
+         i++) {
+        QString name;
+        quint32 numLevels = 0;
+        stream >> name >> numLevels;
+        if (numLevels == 0 || numLevels > c_maxLodLevels + 1)
+            break;
+        std::vector<Mesh::Level> levels(numLevels);
+        for (Mesh::Level & level : levels)
+            stream >> level.count >> level.offset >> level.error;
+        QVector3D min, max;
+        quint32 baseVertex = 0, indexSize = 0, materialIndex = 0;
+        stream >> min >> max >> baseVertex >> indexSize >> materialIndex;
+        if (stream.status() != QDataStream::Ok || 
+            materialIndex >= materials.size() || 
+            (indexSize != 2 && indexSize != 4) || baseVertex >= numVertices)
+            break;
+        bool isInside = true;
+        for (const Mesh::Level & level : levels) {
+            isInside = isInside && static_cast<quint64>(level.offset) + 
+                static_cast<quint64>(level.count) * indexSize <= indicesSize;
+        }
+        if (!isInside)
+            break;
+        meshes.push_back(std::make_shared<Mesh>(
+            name, levels, BoundingBox(min, max), baseVertex, indexSize, 
+            materials.at(materialIndex)
+        ));
+    }
+    
+    // Read the nodes
+    std::unique_ptr<const Node> rootNode = readNode(stream, meshes);
+    if (!rootNode || meshes.size() != numMeshes) {
+        qWarning() << "The mesh cache of the model" << m_filePath << 
+            "is corrupted.";
+        return false;
+    }
+    
+    p_object = std::make_unique<Object>(std::move(rootNode), std::move(cache));
+    return true;
+}
+
+
+void Object::Loader::saveCache(
+    const QByteArray & key, const aiScene * scene, 
+    const std::vector<MaterialInfo> & materials,
+    const std::vector<std::shared_ptr<const Mesh>> & meshes,
+    const Object & object
+) {
+    QByteArray metadata;
+    QDataStream stream(&metadata, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    
+    // Write the materials
+    stream << static_cast<quint32>(materials.size());
+    for (const MaterialInfo & info : materials) {
+        stream << info.name << info.isSupported << info.ambient << info.diffuse
+            << info.specular << info.shininess << info.alpha 
+            << info.diffuseTexture << info.normalTexture;
+    }
+    
+    // Write the meshes
+    stream << static_cast<quint32>(meshes.size());
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        const Mesh & mesh = *meshes.at(i);
+        stream << mesh.getName() 
+            << static_cast<quint32>(mesh.getLevels().size());
+        for (const Mesh::Level & level : mesh.getLevels())
+            stream << level.count << level.offset << level.error;
+        stream << mesh.getBoundingBox().getMin() 
+            << mesh.getBoundingBox().getMax() << mesh.getBaseVertex()
+            << mesh.getIndexSize() << scene->mMeshes[i]->mMaterialIndex;
+    }
+    
+    // Write the nodes
+    writeNode(stream, scene->mRootNode);
+    
+    const char * streams[MeshCache::NumStreams];
+    qint64 sizes[MeshCache::NumStreams];
+    for (unsigned int s = 0; s < MeshCache::NumStreams; s++) {
+        std::pair<const void *, int> data = 
+            object.getBufferData(static_cast<MeshCache::Stream>(s));
+        streams[s] = static_cast<const char *>(data.first);
+        sizes[s] = data.second;
+    }
+    MeshCache::save(key, metadata, streams, sizes);
+}
+
+
+void Object::Loader::writeNode(QDataStream & stream, const aiNode * node) {
+    stream << QString(node->mName.C_Str()) 
+        << QMatrix4x4(node->mTransformation[0]);
+    stream << node->mNumMeshes;
+    for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        stream << node->mMeshes[i];
+    stream << node->mNumChildren;
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+        writeNode(stream, node->mChildren[i]);
+}
+
+
+std::unique_ptr<const Object::Node> Object::Loader::readNode(
+    QDataStream & stream, 
+    const std::vector<std::shared_ptr<const Mesh>> & meshes
+) {
+    QString name;
+    QMatrix4x4 transformation;
+    quint32 numMeshes = 0;
+    stream >> name >> transformation >> numMeshes;
+    
+    // Get the node meshes
+    std::vector<std::shared_ptr<const Mesh>> nodeMeshes;
+    for (quint32 i = 0; i < numMeshes && stream.status() == QDataStream::Ok; 
+         i++) {
+        quint32 mesh = 0;
+        stream >> mesh;
+        if (mesh >= meshes.size())
+            return nullptr;
+        nodeMeshes.push_back(meshes.at(mesh));
+    }
+    
+    // Create the children of the node
+    quint32 numChildren = 0;
+    stream >> numChildren;
+    std::vector<std::unique_ptr<const Node>> children;
+    for (quint32 i = 0; i < numChildren && stream.status() == QDataStream::Ok; 
+         i++) {
+        std::unique_ptr<const Node> child = readNode(stream, meshes);
+        if (!child)
+            return nullptr;
+        children.push_back(std::move(child));
+    }
+    if (stream.status() != QDataStream::Ok)
+        return nullptr;
+    
+    // Create the node
+    return std::make_unique<Node>(
+        name, transformation, nodeMeshes, std::move(children)
+    );
+}
+
+
 
 /***
  *           __   ____  __ _              
@@ -835,6 +1383,89 @@ std::unique_ptr<const Object::Node> Object::Loader::processNode(
  *                                        
  */
 
+#include <QtEndian>
+#include <array>
+#include <cstring>
+
+namespace {
+    /**
+     * Size returned by decodeBase64() for invalid data.
+     */
+    const std::size_t c_invalidSize = static_cast<std::size_t>(-1);
+    
+    /**
+     * @brief Decode base64 text, ignoring the white spaces.
+     * @param[in] text The base64 text.
+     * @param[out] output The decoded data.
+     * @param[in] maxSize The size of the output.
+     * @return The size of the decoded data, c_invalidSize if the text is not
+     * valid or if the decoded data does not fit in the output.
+     */
+    std::size_t decodeBase64(
+        const QString & text, char * output, std::size_t maxSize
+    ) {
+        // Value of the characters: 0 to 63 for the digits, c_space for the
+        // white spaces, c_padding for '=', c_invalid for the others
+        static const quint8 c_space = 64, c_padding = 65, c_invalid = 66;
+        static const std::array<quint8, 128> c_values = []() {
+            std::array<quint8, 128> values;
+            values.fill(c_invalid);
+            const char digits[] = 
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (quint8 d = 0; d < 64; d++)
+                values[static_cast<std::size_t>(digits[d])] = d;
+            values[' '] = values['\t'] = values['\n'] = values['\r'] = c_space;
+            values['='] = c_padding;
+            return values;
+        }();
+        
+        const QChar * characters = text.constData();
+        std::size_t size = 0;
+        quint32 bits = 0;
+        int numBits = 0;
+        bool padding = false;
+        for (int i = 0; i < text.size(); i++) {
+            const ushort c = characters[i].unicode();
+            const quint8 value = c < 128 ? c_values[c] : c_invalid;
+            if (value < 64 && !padding) {
+                bits = (bits << 6) | value;
+                numBits += 6;
+                if (numBits >= 8) {
+                    numBits -= 8;
+                    if (size == maxSize)
+                        return c_invalidSize;
+                    output[size++] = static_cast<char>((bits >> numBits) & 0xff);
+                }
+            }
+            else if (value == c_padding) {
+                padding = true;
+            }
+            else if (value != c_space) {
+                // Invalid character or data after the padding
+                return c_invalidSize;
+            }
+        }
+        return size;
+    }
+    
+    /**
+     * @brief Parse a number of a text array.
+     */
+    const char * parseNumber(const char * first, const char * last, 
+                             float & value) {
+        return NumberParser::parseFloat(first, last, value);
+    }
+    
+    const char * parseNumber(const char * first, const char * last, 
+                             unsigned int & value) {
+        std::uint32_t number = 0;
+        const char * p = NumberParser::parseUnsigned(first, last, number);
+        value = number;
+        return p;
+    }
+}
+
+
 std::unique_ptr<Object> Object::XmlLoader::getObject() {
     return move(p_object);
 }
@@ -856,11 +1487,37 @@ bool Object::XmlLoader::build() {
     // Process the nodes
     if (child.tagName().compare("node") != 0)
         return false;
+    
+    // Read the centerlines of the roads to size the buffer data
+    const std::size_t numPlanes = 
+        static_cast<std::size_t>(m_elmt.elementsByTagName("plane").size());
+    std::size_t numVertices = 4 * numPlanes, numIndices = 6 * numPlanes;
+    const QDomNodeList meshes = m_elmt.elementsByTagName("mesh");
+    for (int i = 0; i < meshes.size(); i++) {
+        const QDomElement mesh = meshes.at(i).toElement();
+        numVertices += mesh.attribute("vertexCount", "0").toUInt();
+        numIndices += mesh.attribute("indexCount", "0").toUInt();
+    }
+    const QDomNodeList roads = m_elmt.elementsByTagName("road");
+    for (int i = 0; i < roads.size(); i++) {
+        Centerline centerline;
+        if (!readCenterline(roads.at(i).toElement(), centerline))
+            continue;
+        numVertices += centerline.numVertices();
+        numIndices += centerline.numIndices();
+        m_roads.emplace_back(roads.at(i).toElement(), std::move(centerline));
+    }
+    p_builder = std::make_unique<MeshBuilder>(numVertices, numIndices);
     std::unique_ptr<const Node> rootNode = processNode(child);
+    
+    // Compute the tangents and bitangents once the vertices, textures, and 
+    // indices of all the nodes are written
+    const MeshStreams streams = p_builder->getStreams();
+    TangentSpace::generate(streams, 0, streams.vertices.size() / 3);
+    
+    p_builder->packIndices();
     p_object = std::make_unique<Object>(
-        std::move(rootNode), std::move(p_vertices), std::move(p_normals), 
-        std::move(p_textureUV), std::move(p_indices), std::move(p_tangents), 
-        std::move(p_bitangents)
+        std::move(rootNode), p_builder->getStreams(), p_builder->releaseArena()
     );
     return true;
 }
@@ -869,14 +1526,10 @@ bool Object::XmlLoader::build() {
 bool Object::XmlLoader::qStringToQVector3D(
     const QString & string, QVector3D & vec
 ) {
-    QStringList list = string.split(" ");
-    if (list.size() != 3)
+    float values[3];
+    if (!parseNumbers(string, values, 3))
         return false;
-    bool ok;
-    float x = list[0].toFloat(&ok); if (!ok) return false;
-    float y = list[1].toFloat(&ok); if (!ok) return false;
-    float z = list[2].toFloat(&ok); if (!ok) return false;
-    vec = QVector3D(x, y, z);
+    vec = QVector3D(values[0], values[1], values[2]);
     return true;
 }
 
@@ -884,31 +1537,82 @@ bool Object::XmlLoader::qStringToQVector3D(
 bool Object::XmlLoader::qStringToQVector4D(
     const QString & string, QVector4D & vec
 ) {
-    QStringList list = string.split(" ");
-    if (list.size() != 4)
+    float values[4];
+    if (!parseNumbers(string, values, 4))
         return false;
-    bool ok;
-    float x = list[0].toFloat(&ok); if (!ok) return false;
-    float y = list[1].toFloat(&ok); if (!ok) return false;
-    float z = list[2].toFloat(&ok); if (!ok) return false;
-    float w = list[3].toFloat(&ok); if (!ok) return false;
-    vec = QVector4D(x, y, z, w);
+    vec = QVector4D(values[0], values[1], values[2], values[3]);
     return true;
 }
 
 
-template<typename T> bool Object::XmlLoader::qStringToQVector(
-    const QString & string, QVector<T> & vec
+std::size_t Object::XmlLoader::countNumbers(const QString & string) {
+    const QChar * characters = string.constData();
+    std::size_t count = 0;
+    bool inNumber = false;
+    for (int i = 0; i < string.size(); i++) {
+        const ushort c = characters[i].unicode();
+        const bool isSpace = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        count += !isSpace && !inNumber ? 1 : 0;
+        inNumber = !isSpace;
+    }
+    return count;
+}
+
+
+template<typename T> bool Object::XmlLoader::parseNumbers(
+    const QString & string, T * values, std::size_t count
+) {
+    // The text is converted once, the numbers are parsed in place
+    const QByteArray text = string.toLatin1();
+    const char * p = text.constData();
+    const char * end = p + text.size();
+    for (std::size_t i = 0; i < count; i++) {
+        p = parseNumber(NumberParser::skipSpaces(p, end), end, values[i]);
+        if (p == nullptr || (p != end && !NumberParser::isSpace(*p)))
+            return false;
+    }
+    return NumberParser::skipSpaces(p, end) == end;
+}
+
+
+template<typename T> bool Object::XmlLoader::readStream(
+    const QDomElement & elmt, T * values, std::size_t count
 ) {
-    QStringList list = string.simplified().split(" ");
-    QVector<T> vector;
-    for (auto it = list.begin(); it != list.end(); it++) {
-        QVariant variant(*it);
-        if (!variant.canConvert<T>())
+    static_assert(sizeof(T) == sizeof(quint32), "Invalid stream type");
+    if (elmt.attribute("encoding", "text").compare("base64") != 0)
+        return parseNumbers(elmt.text(), values, count);
+    
+    // Decode the binary array in the buffer data
+    const QString text = elmt.text();
+    const std::size_t size = count * sizeof(T);
+    char * data = reinterpret_cast<char *>(values);
+    if (elmt.attribute("compression", "none").compare("zlib") == 0) {
+        // qUncompress() expects the size of the uncompressed data in 
+        // big-endian before the zlib stream
+        QByteArray compressed(
+            4 + text.size() / 4 * 3 + 3, Qt::Uninitialized
+        );
+        const std::size_t compressedSize = decodeBase64(
+            text, compressed.data() + 4, 
+            static_cast<std::size_t>(compressed.size() - 4)
+        );
+        if (compressedSize == c_invalidSize || size > 0x7fffffff)
+            return false;
+        compressed.resize(4 + static_cast<int>(compressedSize));
+        qToBigEndian(static_cast<quint32>(size), compressed.data());
+        const QByteArray uncompressed = qUncompress(compressed);
+        if (static_cast<std::size_t>(uncompressed.size()) != size)
             return false;
-        vector.append(variant.value<T>());
+        std::memcpy(data, uncompressed.constData(), size);
     }
-    vec.append(vector);
+    else if (decodeBase64(text, data, size) != size) {
+        return false;
+    }
+    
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    for (std::size_t i = 0; i < size; i += sizeof(T))
+        std::reverse(data + i, data + i + sizeof(T));
+#endif
     return true;
 }
 
@@ -1002,9 +1706,10 @@ std::shared_ptr<const Object::Mesh> Object::XmlLoader::processShape(
     if (name.isEmpty())
         return nullptr;
     
-    // Mesh count and offset
+    // Mesh count, indices, and bounds
     unsigned int count;
-    unsigned int offset = static_cast<unsigned int>(p_indices->size());
+    IndexRange range;
+    BoundingBox boundingBox;
     
     // Retrieve material
     QString matString = elmt.attribute("material","");
@@ -1035,63 +1740,82 @@ std::shared_ptr<const Object::Mesh> Object::XmlLoader::processShape(
         };
         float textureSize = elmt.attribute("textureSize","5.0").toFloat();
         
-        // Create mesh buffer data
-        QVector<float> vertices;
-        QVector<float> normals;
-        QVector<QVector<float>> textureUV;
-        QVector<unsigned int> indices;
+        // Reserve the mesh buffer data
+        const std::size_t first = p_builder->addVertices(4);
+        range = p_builder->addIndices(6, first, 4);
+        const MeshStreams streams = p_builder->getStreams();
         
         QVector3D cornerRL = origin - latAxis - longAxis;
         QVector3D cornerRR = origin + latAxis - longAxis;
         QVector3D cornerFL = origin - latAxis + longAxis;
         QVector3D cornerFR = origin + latAxis + longAxis;
         
-        vertices.append(
-            QVector<float>({
-                cornerRL.x(), cornerRL.y(), cornerRL.z(),   // RL corner
-                cornerRR.x(), cornerRR.y(), cornerRR.z(),   // RR corner
-                cornerFL.x(), cornerFL.y(), cornerFL.z(),   // FL corner
-                cornerFR.x(), cornerFR.y(), cornerFR.z()    // FR corner
-            })
-        );
+        const float vertices[] = {
+            cornerRL.x(), cornerRL.y(), cornerRL.z(),   // RL corner
+            cornerRR.x(), cornerRR.y(), cornerRR.z(),   // RR corner
+            cornerFL.x(), cornerFL.y(), cornerFL.z(),   // FL corner
+            cornerFR.x(), cornerFR.y(), cornerFR.z()    // FR corner
+        };
+        std::copy(vertices, vertices + 12, &streams.vertices[3*first]);
+        boundingBox = BoundingBox::fromPositions(vertices, 4);
         
         float length = longAxis.length() * 2;
         float width = latAxis.length() * 2;
-        textureUV.append(   // x channel
-            QVector<float>({
-                0.0f, 0.0f,                             // RL corner
-                width/textureSize, 0.0f,                // RR corner
-                0.0f, length/textureSize,               // FL corner
-                width/textureSize, length/textureSize   // RR corner
-            })
-        );
+        const float textureUV[] = {
+            0.0f, 0.0f,                             // RL corner
+            width/textureSize, 0.0f,                // RR corner
+            0.0f, length/textureSize,               // FL corner
+            width/textureSize, length/textureSize   // RR corner
+        };
+        std::copy(textureUV, textureUV + 8, &streams.textureUV[2*first]);
         
         QVector3D normalAxis = QVector3D::crossProduct(longAxis, latAxis);
-        for (int i = 0; i < 4; i++) {
-            normals.append(QVector<float>({
-                normalAxis.x(), normalAxis.y(), normalAxis.z()
-            }));
+        for (std::size_t i = 0; i < 4; i++) {
+            streams.normals[3*(first+i)] = normalAxis.x();
+            streams.normals[3*(first+i)+1] = normalAxis.y();
+            streams.normals[3*(first+i)+2] = normalAxis.z();
         }
         
-        unsigned int indexOffset = static_cast<unsigned int>(
-            p_vertices->size()/3
-        );
-        indices.append(QVector<unsigned int>(
-            {indexOffset+0, indexOffset+1, indexOffset+2}   // RL, RR, and FL
-        ));
-        indices.append(QVector<unsigned int>(
-            {indexOffset+2, indexOffset+1, indexOffset+3}   // FL, RR, and FR
-        ));
+        const unsigned int indexOffset = static_cast<unsigned int>(first);
+        const unsigned int indices[] = {
+            indexOffset+0, indexOffset+1, indexOffset+2,    // RL, RR, and FL
+            indexOffset+2, indexOffset+1, indexOffset+3     // FL, RR, and FR
+        };
+        std::copy(indices, indices + 6, &streams.indices[range.first]);
         
         // Remark: The tangents and bitangents buffer are computed once the 
         // vertices, textureUV, and indices buffer are filled.
+        count = 6;
+    }
+    else if (elmt.tagName().compare("mesh") == 0) {
+        // Reserve the mesh buffer data, sized by build()
+        const std::size_t numVertices = 
+            elmt.attribute("vertexCount", "0").toUInt();
+        const std::size_t numIndices = 
+            elmt.attribute("indexCount", "0").toUInt();
+        const std::size_t first = p_builder->addVertices(numVertices);
+        range = p_builder->addIndices(numIndices, first, numVertices);
         
-        // Update count and append buffer data
-        count = static_cast<unsigned int>(indices.size());
-        p_vertices->append(vertices);
-        p_textureUV->operator[](0).append(textureUV.at(0));
-        p_normals->append(normals);
-        p_indices->append(indices);
+        // Leave degenerate triangles if the streams are not valid
+        if (!readMesh(elmt, first, range)) {
+            qWarning() << "The mesh" << name << "is not valid. It will not be"
+                " rendered.";
+            const MeshStreams streams = p_builder->getStreams();
+            std::fill(&streams.vertices[3*first], 
+                      &streams.vertices[3*first] + 3*numVertices, 0.0f);
+            std::fill(&streams.normals[3*first], 
+                      &streams.normals[3*first] + 3*numVertices, 0.0f);
+            std::fill(&streams.textureUV[2*first], 
+                      &streams.textureUV[2*first] + 2*numVertices, 0.0f);
+            std::fill(&streams.indices[range.first], 
+                      &streams.indices[range.first] + numIndices, 
+                      static_cast<unsigned int>(first));
+            return nullptr;
+        }
+        count = static_cast<unsigned int>(numIndices);
+        boundingBox = BoundingBox::fromPositions(
+            &p_builder->getStreams().vertices[3*first], numVertices
+        );
     }
     // Other geometrical shapes
     else
@@ -1099,12 +1823,298 @@ std::shared_ptr<const Object::Mesh> Object::XmlLoader::processShape(
     
     // Return the mesh
     std::shared_ptr<const Mesh> newMesh = std::make_shared<Mesh>(
-        name, count, offset, material
+        name, count, static_cast<unsigned int>(range.byteOffset), boundingBox,
+        static_cast<unsigned int>(range.baseVertex), range.indexSize, material
     );
     return newMesh;
 }
 
 
+bool Object::XmlLoader::readCenterline(
+    const QDomElement & elmt, Centerline & centerline
+) {
+    const QString name = elmt.attribute("name", "");
+    const float spacing = elmt.attribute("spacing", "1.0").toFloat();
+    const float chunkLength = elmt.attribute("chunkLength", "100.0").toFloat();
+    const float elevation = elmt.attribute("elevation", "0.0").toFloat();
+    if (name.isEmpty() || !(spacing > 0.0f) || !(chunkLength >= spacing)) {
+        qWarning() << "The road" << name << "is not valid. It will not be "
+            "rendered.";
+        return false;
+    }
+    
+    // Points of the polyline, or positions of the chassis sampled every 
+    // 50 ms
+    std::vector<QVector3D> polyline;
+    if (elmt.hasAttribute("trajectory")) {
+        std::unique_ptr<Trajectory> trajectory = 
+            Trajectory::fromFile(elmt.attribute("trajectory"));
+        if (trajectory == nullptr || trajectory->isEmpty()) {
+            qWarning() << "Unable to read the trajectory" << 
+                elmt.attribute("trajectory") << "of the road" << name;
+            return false;
+        }
+        const float step = 0.05f;
+        const std::size_t count = static_cast<std::size_t>(
+            (trajectory->finalTime() - trajectory->firstTime()) / step
+        ) + 1;
+        std::vector<float> times(count);
+        for (std::size_t k = 0; k < count; k++)
+            times[k] = trajectory->firstTime() + step * k;
+        std::vector<float> samples(Trajectory::NumChannels * count);
+        trajectory->getSamples(times.data(), count, samples.data());
+        for (std::size_t k = 0; k < count; k++) {
+            polyline.emplace_back(
+                samples[Trajectory::ChassisX * count + k], 
+                samples[Trajectory::ChassisY * count + k], 0.0f
+            );
+        }
+    }
+    else {
+        const QString points = elmt.attribute("points", "");
+        std::vector<float> coordinates(countNumbers(points));
+        if (coordinates.size() % 3 != 0 || 
+            !parseNumbers(points, coordinates.data(), coordinates.size())) {
+            qWarning() << "The points of the road" << name << "are not valid.";
+            return false;
+        }
+        for (std::size_t k = 0; k + 2 < coordinates.size(); k += 3) {
+            polyline.emplace_back(
+                coordinates[k], coordinates[k+1], coordinates[k+2]
+            );
+        }
+    }
+    
+    // Resample the polyline at the spacing, keeping its last point
+    centerline.points.clear();
+    centerline.distances.clear();
+    float distance = 0.0f, next = 0.0f;
+    for (std::size_t k = 0; k + 1 < polyline.size(); k++) {
+        const float length = polyline[k].distanceToPoint(polyline[k+1]);
+        while (next < distance + length) {
+            const float t = (next - distance) / length;
+            centerline.points.push_back(
+                polyline[k] + t * (polyline[k+1] - polyline[k]) + 
+                QVector3D(0.0f, 0.0f, elevation)
+            );
+            centerline.distances.push_back(next);
+            next += spacing;
+        }
+        distance += length;
+    }
+    if (centerline.points.empty() || !(distance > 0.0f)) {
+        qWarning() << "The road" << name << "has no length. It will not be "
+            "rendered.";
+        return false;
+    }
+    // Merge the last sample with the last point if they are too close
+    if (centerline.points.size() > 1 && 
+        distance - centerline.distances.back() < 0.5f * spacing) {
+        centerline.points.pop_back();
+        centerline.distances.pop_back();
+    }
+    centerline.points.push_back(
+        polyline.back() + QVector3D(0.0f, 0.0f, elevation)
+    );
+    centerline.distances.push_back(distance);
+    centerline.chunkSegments = std::max<std::size_t>(
+        1, static_cast<std::size_t>(chunkLength / spacing)
+    );
+    return true;
+}
+
+
+std::vector<std::shared_ptr<const Object::Mesh>> 
+Object::XmlLoader::processRoad(const QDomElement & elmt) {
+    auto it = std::find_if(m_roads.begin(), m_roads.end(), 
+        [&elmt](const std::pair<QDomElement, Centerline> & road) {
+            return road.first == elmt;
+        }
+    );
+    if (it == m_roads.end())
+        return std::vector<std::shared_ptr<const Mesh>>();
+    const Centerline & centerline = it->second;
+    
+    // Retrieve attributes
+    const QString name = elmt.attribute("name", "");
+    const float width = elmt.attribute("width", "7.0").toFloat();
+    const float textureSize = elmt.attribute("textureSize", "5.0").toFloat();
+    std::shared_ptr<const Material> material;
+    auto matIt = m_materials.find(elmt.attribute("material", ""));
+    if (matIt != m_materials.end())
+        material = matIt->second;
+    else
+        material = std::make_shared<Material>("default");
+    
+    // Reserve the buffer data of the chunks, then generate them in parallel
+    const std::size_t numChunks = centerline.numChunks();
+    std::vector<std::size_t> firstVertices(numChunks);
+    std::vector<IndexRange> ranges(numChunks);
+    for (std::size_t c = 0; c < numChunks; c++) {
+        const std::size_t numSegments = std::min(centerline.chunkSegments, 
+            centerline.points.size() - 1 - c * centerline.chunkSegments);
+        const std::size_t numVertices = 2 * (numSegments + 1);
+        firstVertices[c] = p_builder->addVertices(numVertices);
+        ranges[c] = p_builder->addIndices(
+            6 * numSegments, firstVertices[c], numVertices
+        );
+    }
+    const MeshStreams streams = p_builder->getStreams();
+    std::vector<BoundingBox> boundingBoxes(numChunks);
+    ThreadPool::global().parallelFor(numChunks, [&](std::size_t c) {
+        const std::size_t begin = c * centerline.chunkSegments;
+        const std::size_t numPoints = ranges[c].count / 6 + 1;
+        // The texture coordinates restart at each chunk on a multiple of the
+        // texture size so that they stay small (e.g. in half floats)
+        const float origin = textureSize * 
+            std::floor(centerline.distances[begin] / textureSize);
+        for (std::size_t k = 0; k < numPoints; k++) {
+            const std::size_t p = begin + k;
+            const QVector3D & point = centerline.points[p];
+            const QVector3D tangent = (
+                centerline.points[std::min(p + 1, centerline.points.size() - 1)]
+                - centerline.points[p > 0 ? p - 1 : 0]
+            ).normalized();
+            const QVector3D side = QVector3D::crossProduct(
+                QVector3D(0.0f, 0.0f, 1.0f), tangent
+            ).normalized();
+            const QVector3D normal = 
+                QVector3D::crossProduct(tangent, side).normalized();
+            const float v = (centerline.distances[p] - origin) / textureSize;
+            for (std::size_t e = 0; e < 2; e++) {
+                const std::size_t vertex = firstVertices[c] + 2 * k + e;
+                const QVector3D position = 
+                    point + (e == 0 ? -0.5f : 0.5f) * width * side;
+                for (int i = 0; i < 3; i++) {
+                    streams.vertices[3*vertex+i] = position[i];
+                    streams.normals[3*vertex+i] = normal[i];
+                }
+                boundingBoxes[c].expand(position);
+                streams.textureUV[2*vertex] = e == 0 ? 0.0f : width/textureSize;
+                streams.textureUV[2*vertex+1] = v;
+            }
+        }
+        
+        // Same triangles as the plane for each segment
+        unsigned int * indices = &streams.indices[ranges[c].first];
+        const unsigned int first = static_cast<unsigned int>(firstVertices[c]);
+        for (unsigned int k = 0; k + 1 < numPoints; k++) {
+            const unsigned int a = first + 2*k;
+            const unsigned int quad[] = {a, a+1, a+2, a+2, a+1, a+3};
+            indices = std::copy(quad, quad + 6, indices);
+        }
+    });
+    
+    // Create the meshes of the chunks
+    std::vector<std::shared_ptr<const Mesh>> meshes;
+    for (std::size_t c = 0; c < numChunks; c++) {
+        meshes.push_back(std::make_shared<Mesh>(
+            name + "_" + QString::number(c), 
+            std::vector<Mesh::Level>(1, Mesh::Level{
+                static_cast<unsigned int>(ranges[c].count), 
+                static_cast<unsigned int>(ranges[c].byteOffset), 0.0f
+            }),
+            boundingBoxes[c], static_cast<unsigned int>(firstVertices[c]),
+            ranges[c].indexSize, material
+        ));
+    }
+    qInfo() << "Road" << name << ":" << centerline.distances.back() 
+        << "m in" << numChunks << "chunks of" 
+        << centerline.chunkSegments * elmt.attribute("spacing", "1.0").toFloat()
+        << "m," << centerline.numIndices() / 3 << "triangles";
+    return meshes;
+}
+
+
+bool Object::XmlLoader::readMesh(
+    const QDomElement & elmt, std::size_t first, const IndexRange & range
+) {
+    const MeshStreams streams = p_builder->getStreams();
+    const std::size_t numVertices = elmt.attribute("vertexCount", "0").toUInt();
+    if (numVertices == 0 || range.count == 0 || range.count % 3 != 0)
+        return false;
+    
+    // Read the streams in the buffer data
+    bool hasVertices = false, hasNormals = false, hasTextureUV = false;
+    bool hasIndices = false;
+    for (
+        QDomElement child = elmt.firstChildElement();
+        !child.isNull();
+        child = child.nextSiblingElement()
+    ) {
+        bool ok = true;
+        if (child.tagName().compare("vertices") == 0) {
+            ok = hasVertices = 
+                readStream(child, &streams.vertices[3*first], 3*numVertices);
+        }
+        else if (child.tagName().compare("normals") == 0) {
+            ok = hasNormals = 
+                readStream(child, &streams.normals[3*first], 3*numVertices);
+        }
+        else if (child.tagName().compare("textureUV") == 0) {
+            ok = hasTextureUV = 
+                readStream(child, &streams.textureUV[2*first], 2*numVertices);
+        }
+        else if (child.tagName().compare("indices") == 0) {
+            ok = hasIndices = readStream(
+                child, &streams.indices[range.first], range.count
+            );
+        }
+        if (!ok) {
+            qWarning() << "The stream" << child.tagName() << "of the mesh" 
+                << elmt.attribute("name", "") << "is not valid.";
+            return false;
+        }
+    }
+    if (!hasVertices || !hasIndices)
+        return false;
+    
+    // The indices of the element are relative to the mesh
+    unsigned int * indices = &streams.indices[range.first];
+    for (std::size_t i = 0; i < range.count; i++) {
+        if (indices[i] >= numVertices)
+            return false;
+        indices[i] += static_cast<unsigned int>(first);
+    }
+    
+    if (!hasTextureUV) {
+        std::fill(&streams.textureUV[2*first], 
+                  &streams.textureUV[2*first] + 2*numVertices, 0.0f);
+    }
+    
+    // Compute the normals of the vertices from the area-weighted normals of
+    // the triangles
+    if (!hasNormals) {
+        float * normals = &streams.normals[3*first];
+        std::fill(normals, normals + 3*numVertices, 0.0f);
+        for (std::size_t i = 0; i < range.count; i += 3) {
+            QVector3D p[3];
+            for (std::size_t k = 0; k < 3; k++) {
+                const std::size_t v = indices[i+k];
+                p[k] = QVector3D(streams.vertices[3*v], streams.vertices[3*v+1],
+                                 streams.vertices[3*v+2]);
+            }
+            const QVector3D normal = QVector3D::crossProduct(p[1]-p[0], p[2]-p[0]);
+            for (std::size_t k = 0; k < 3; k++) {
+                const std::size_t v = indices[i+k];
+                streams.normals[3*v] += normal.x();
+                streams.normals[3*v+1] += normal.y();
+                streams.normals[3*v+2] += normal.z();
+            }
+        }
+        for (std::size_t v = 0; v < numVertices; v++) {
+            QVector3D normal(normals[3*v], normals[3*v+1], normals[3*v+2]);
+            normal = normal.lengthSquared() > 0.0f ? 
+                normal.normalized() : QVector3D(0.0f, 0.0f, 1.0f);
+            normals[3*v] = normal.x();
+            normals[3*v+1] = normal.y();
+            normals[3*v+2] = normal.z();
+        }
+    }
+    return true;
+}
+
+
 std::unique_ptr<const Object::Node> Object::XmlLoader::processNode(
     const QDomElement & elmt
 ) {
@@ -1116,17 +2126,6 @@ std::unique_ptr<const Object::Node> Object::XmlLoader::processNode(
     if (name.isEmpty())
         return nullptr;
     
-    // Create buffer
-    p_vertices = std::make_unique<QVector<float>>();
-    p_normals = std::make_unique<QVector<float>>();
-    p_textureUV = std::make_unique<QVector<QVector<float>>>();
-    p_indices = std::make_unique<QVector<unsigned int>>();
-    p_tangents = std::make_unique<QVector<float>>();
-    p_bitangents = std::make_unique<QVector<float>>();
-    
-    // Create channels
-    p_textureUV->push_back(QVector<float>());   // x channel
-    
     // Define the transformation
     QString transString = elmt.attribute("translation","0.0 0.0 0.0");
     QVector3D trans;
@@ -1153,16 +2152,18 @@ std::unique_ptr<const Object::Node> Object::XmlLoader::processNode(
     // Get the node meshes
     std::vector<std::shared_ptr<const Mesh>> meshes;
     // Get the geometrical shapes
-    while (child.tagName().compare("plane") == 0) {
-        meshes.push_back(processShape(child));
+    while (child.tagName().compare("plane") == 0 || 
+           child.tagName().compare("road") == 0 ||
+           child.tagName().compare("mesh") == 0) {
+        if (child.tagName().compare("road") == 0) {
+            std::vector<std::shared_ptr<const Mesh>> chunks = processRoad(child);
+            meshes.insert(meshes.end(), chunks.begin(), chunks.end());
+        }
+        else if (std::shared_ptr<const Mesh> mesh = processShape(child)) {
+            meshes.push_back(mesh);
+        }
         child = child.nextSiblingElement();
     }
-    // Compute the tangents and bitangents once the vertices, textures, and 
-    // indices buffers are filed
-    getTangentsAndBitangents(
-        *p_vertices, *p_textureUV, *p_indices, *p_tangents, *p_bitangents
-    );
-    
     // Create the children of the node
     std::vector<std::unique_ptr<const Node>> children;
     while (!child.isNull()) {
@@ -0,0 +1,250 @@
+#include "../include/pagedtrajectory.h"
+#include <QDebug>
+#include <algorithm>
+
+PagedTrajectory::PagedTrajectory(
+    const QString & fileName, std::size_t chunkSize, std::size_t maxChunks
+) :
+    m_fileName(fileName),
+    m_numSamples(0),
+    m_columnStride(0),
+    m_dataOffset(0),
+    m_chunkSize(std::max<std::size_t>(chunkSize, 1)),
+    m_maxChunks(std::max<std::size_t>(maxChunks, 2)),
+    m_firstTime(0.0f),
+    m_finalTime(0.0f),
+    m_isLoading(false),
+    m_loadingChunk(0),
+    m_cursorChunk(0),
+    m_cursor(0),
+    m_stop(false) {}
+
+
+PagedTrajectory::~PagedTrajectory() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+    }
+}
+
+
+std::unique_ptr<PagedTrajectory> PagedTrajectory::open(
+    const QString & fileName, std::size_t chunkSize, std::size_t maxChunks
+) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Error while loading file" << fileName;
+        return nullptr;
+    }
+    Trajectory::FileHeader header;
+    if (!Trajectory::readHeader(file, header))
+        return nullptr;
+
+    std::unique_ptr<PagedTrajectory> trajectory(
+        new PagedTrajectory(fileName, chunkSize, maxChunks)
+    );
+    trajectory->m_numSamples = header.numSamples;
+    trajectory->m_columnStride = header.columnStride;
+    trajectory->m_dataOffset = header.dataOffset;
+    if (header.numSamples == 0)
+        return trajectory;
+
+    // Read the time of the first sample of each chunk and of the last sample
+    const std::size_t numChunks =
+        (header.numSamples + trajectory->m_chunkSize - 1) /
+        trajectory->m_chunkSize;
+    trajectory->m_chunkTimes.resize(numChunks);
+    for (std::size_t k = 0; k <= numChunks; k++) {
+        std::size_t i = std::min<std::size_t>(
+            k * trajectory->m_chunkSize, header.numSamples - 1
+        );
+        float time;
+        if (!file.seek(header.dataOffset + i * sizeof(float)) ||
+            file.read(reinterpret_cast<char *>(&time), sizeof(float)) !=
+                sizeof(float)) {
+            qWarning() << "Error while reading file" << fileName;
+            return nullptr;
+        }
+        if (k < numChunks)
+            trajectory->m_chunkTimes[k] = time;
+        else
+            trajectory->m_finalTime = time;
+
+        // The samples of the chunks are not read here: only the first time 
+        // of each chunk can be checked
+        const float previous = k == 0 ? time : trajectory->m_chunkTimes[k - 1];
+        if (!(previous <= time)) {
+            qWarning() << "The time of the trajectory file" << fileName <<
+                "decreases at sample" << i;
+            return nullptr;
+        }
+    }
+    trajectory->m_firstTime = trajectory->m_chunkTimes.front();
+    file.close();
+
+    trajectory->m_thread = std::thread(&PagedTrajectory::run, trajectory.get());
+    return trajectory;
+}
+
+
+std::size_t PagedTrajectory::findChunk(float time) const {
+    auto it = std::upper_bound(m_chunkTimes.begin(), m_chunkTimes.end(), time);
+    if (it == m_chunkTimes.begin())
+        return 0;
+    return static_cast<std::size_t>(it - m_chunkTimes.begin()) - 1;
+}
+
+
+void PagedTrajectory::request(std::size_t chunk, bool urgent) {
+    auto isQueued = [chunk](const std::deque<std::size_t> & queue) {
+        return std::find(queue.begin(), queue.end(), chunk) != queue.end();
+    };
+    if (chunk >= m_chunkTimes.size() || m_chunks.count(chunk) > 0 ||
+        (m_isLoading && m_loadingChunk == chunk))
+        return;
+
+    if (urgent) {
+        // After a seek, the pending prefetches are not needed anymore
+        m_prefetches.clear();
+        if (isQueued(m_requests))
+            return;
+        m_requests.push_back(chunk);
+        // Forget the oldest requests, which would be evicted anyway
+        while (m_requests.size() > m_maxChunks)
+            m_requests.pop_front();
+    }
+    else {
+        if (isQueued(m_requests) || isQueued(m_prefetches))
+            return;
+        m_prefetches.push_back(chunk);
+    }
+    m_condition.notify_one();
+}
+
+
+void PagedTrajectory::touch(std::size_t chunk) {
+    if (!m_recentChunks.empty() && m_recentChunks.front() == chunk)
+        return;
+    m_recentChunks.remove(chunk);
+    m_recentChunks.push_front(chunk);
+}
+
+
+bool PagedTrajectory::getSample(float time, float row[NumChannels]) {
+    if (isEmpty())
+        return false;
+    time = std::max(m_firstTime, std::min(time, m_finalTime));
+
+    // Get the chunk and prefetch the next one
+    const std::size_t k = findChunk(time);
+    std::shared_ptr<Chunk> chunk;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_chunks.find(k);
+        if (it == m_chunks.end()) {
+            request(k, true);
+            request(k + 1, false);
+            return false;
+        }
+        chunk = it->second;
+        touch(k);
+        request(k + 1, false);
+    }
+
+    // Find the last sample which occurs before the time in the chunk
+    const float * times = chunk->column(Time);
+    const std::size_t last = chunk->size - 1;
+    std::size_t i = m_cursor;
+    if (k != m_cursorChunk || i > last || times[i] > time) {
+        i = static_cast<std::size_t>(
+            std::upper_bound(times, times + chunk->size, time) - times
+        );
+        i = i > 0 ? i - 1 : 0;
+    }
+    while (i < last && times[i + 1] <= time)
+        i++;
+    m_cursorChunk = k;
+    m_cursor = i;
+
+    // Linear interpolation
+    if (i >= last || time <= times[i]) {
+        for (unsigned int c = 0; c < NumChannels; c++)
+            row[c] = chunk->column(c)[i];
+        return true;
+    }
+    const float alpha = (time - times[i]) / (times[i + 1] - times[i]);
+    for (unsigned int c = 0; c < NumChannels; c++) {
+        const float * data = chunk->column(c);
+        row[c] = data[i] + alpha * (data[i + 1] - data[i]);
+    }
+    return true;
+}
+
+
+std::shared_ptr<PagedTrajectory::Chunk> PagedTrajectory::readChunk(
+    QFile & file, std::size_t chunk
+) const {
+    const std::size_t first = chunk * m_chunkSize;
+    std::shared_ptr<Chunk> result = std::make_shared<Chunk>();
+    result->size = std::min(m_chunkSize + 1, m_numSamples - first);
+    result->data.resize(NumChannels * result->size);
+
+    const qint64 size = static_cast<qint64>(result->size * sizeof(float));
+    for (unsigned int c = 0; c < NumChannels; c++) {
+        quint64 offset = m_dataOffset +
+            (c * m_columnStride + first) * sizeof(float);
+        char * data = reinterpret_cast<char *>(&result->data[c * result->size]);
+        if (!file.seek(offset) || file.read(data, size) != size) {
+            qWarning() << "Error while reading file" << m_fileName;
+            return nullptr;
+        }
+    }
+    return result;
+}
+
+
+void PagedTrajectory::run() {
+    // The thread uses its own file handle
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Error while loading file" << m_fileName;
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]{
+            return m_stop || !m_requests.empty() || !m_prefetches.empty();
+        });
+        if (m_stop)
+            break;
+        std::deque<std::size_t> & queue = 
+            m_requests.empty() ? m_prefetches : m_requests;
+        std::size_t k = queue.front();
+        queue.pop_front();
+        if (m_chunks.count(k) > 0)
+            continue;
+
+        // Read the chunk without blocking the render loop
+        m_isLoading = true;
+        m_loadingChunk = k;
+        lock.unlock();
+        std::shared_ptr<Chunk> chunk = readChunk(file, k);
+        lock.lock();
+        m_isLoading = false;
+        if (!chunk)
+            continue;
+
+        // Insert the chunk and evict the least recently used ones
+        m_chunks[k] = chunk;
+        touch(k);
+        while (m_recentChunks.size() > m_maxChunks) {
+            m_chunks.erase(m_recentChunks.back());
+            m_recentChunks.pop_back();
+        }
+    }
+}
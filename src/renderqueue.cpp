@@ -0,0 +1,296 @@
+#include "../include/renderqueue.h"
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_3_Core>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+    const unsigned int c_noMatrix = std::numeric_limits<unsigned int>::max();
+
+    /**
+     * First layout location of the instance attributes.
+     */
+    const GLuint c_instanceLocation = 5;
+
+    /**
+     * @brief Quantize a distance to 24 bits. The bits of a positive float
+     * are ordered as the float: the 24 bits following the sign bit are kept.
+     */
+    std::uint64_t quantizeDepth(float depth) {
+        depth = std::max(depth, 0.0f);
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> 7) & 0xffffff;
+    }
+    
+    /**
+     * @brief Return true if two draws can be drawn as instances of one draw
+     * call, i.e. they only differ by their model matrix.
+     */
+    bool isSameGeometry(const RenderQueue::Draw & a, 
+                        const RenderQueue::Draw & b) {
+        return a.shader == b.shader && a.vao == b.vao && 
+            a.material == b.material && a.count == b.count && 
+            a.offset == b.offset && a.baseVertex == b.baseVertex && 
+            a.indexSize == b.indexSize;
+    }
+}
+
+
+RenderQueue & RenderQueue::global() {
+    static RenderQueue queue;
+    return queue;
+}
+
+
+void RenderQueue::begin(
+    const CasterLight & light, const QMatrix4x4 & view,
+    const QMatrix4x4 & projection,
+    const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
+    const std::array<float,NUM_CASCADES+1> & cascades
+) {
+    m_light = light;
+    m_view = view;
+    m_projection = projection;
+    m_lightSpace = lightSpace;
+    m_cascades = cascades;
+    m_isShadow = false;
+}
+
+
+void RenderQueue::beginShadow(const QMatrix4x4 & lightSpace) {
+    m_light = CasterLight();
+    m_view = QMatrix4x4();
+    m_projection = QMatrix4x4();
+    m_lightSpace[0] = lightSpace;
+    m_isShadow = true;
+}
+
+
+unsigned int RenderQueue::pushMatrix(const QMatrix4x4 & model) {
+    Instance instance;
+    std::memcpy(instance.model, model.constData(), sizeof(instance.model));
+    
+    // The normals are not used by the shadow pass
+    if (m_isShadow)
+        std::fill(instance.normal, instance.normal + 9, 0.0f);
+    else
+        std::memcpy(instance.normal, model.normalMatrix().constData(), 
+                    sizeof(instance.normal));
+    m_matrices.push_back(instance);
+    return static_cast<unsigned int>(m_matrices.size() - 1);
+}
+
+
+void RenderQueue::push(Pass pass, float depth, const Draw & draw) {
+    const unsigned int index = static_cast<unsigned int>(m_draws.size());
+    m_draws.push_back(draw);
+    if (pass == Transparent) {
+        m_transparent.push_back(std::make_pair(
+            static_cast<std::uint32_t>(0xffffff - quantizeDepth(depth)), index
+        ));
+        return;
+    }
+    const std::uint64_t key = makeKey(
+        pass, draw.shader->programId(), draw.vao->objectId(),
+        draw.material != nullptr ? draw.material->getId() : 0, draw.offset,
+        depth
+    );
+    m_keys.push_back(std::make_pair(key, index));
+}
+
+
+std::uint64_t RenderQueue::makeKey(
+    Pass pass, unsigned int shader, unsigned int vao, unsigned int material,
+    unsigned int range, float depth
+) {
+    // The identifiers are truncated and the offset of the range hashed: two 
+    // states sharing a key are not grouped, but their draws are still correct
+    const std::uint64_t state =
+        (static_cast<std::uint64_t>(shader & 0x3f) << 32) |
+        (static_cast<std::uint64_t>(vao & 0xfff) << 20) |
+        (static_cast<std::uint64_t>(material & 0xfff) << 8) |
+        static_cast<std::uint64_t>((range * 2654435761u) >> 24);
+    return (static_cast<std::uint64_t>(pass) << 62) | (state << 24) | 
+        quantizeDepth(depth);
+}
+
+
+void RenderQueue::submit() {
+    if (m_draws.empty()) {
+        m_matrices.clear();
+        return;
+    }
+
+    QOpenGLContext * context = QOpenGLContext::currentContext();
+    QOpenGLFunctions_3_3_Core * glFunctions = context == nullptr ? nullptr :
+        context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if (!glFunctions) {
+        qWarning() << __FILE__ << __LINE__ <<
+                      "Could not obtain required OpenGL context version. \n" <<
+                      "Unable to draw the render queue.";
+        m_draws.clear();
+        m_keys.clear();
+        m_transparent.clear();
+        m_matrices.clear();
+        return;
+    }
+
+    // The opaque draws are followed by the transparent ones
+    countUnsorted();
+    std::sort(m_keys.begin(), m_keys.end());
+    sortTransparent();
+    m_order.clear();
+    for (const std::pair<std::uint64_t, unsigned int> & key : m_keys)
+        m_order.push_back(key.second);
+    for (const std::pair<std::uint32_t, unsigned int> & key : m_transparent)
+        m_order.push_back(key.second);
+
+    // Upload the model matrices of the sorted draws: the instances of a draw
+    // call are consecutive
+    m_instances.clear();
+    for (unsigned int index : m_order)
+        m_instances.push_back(m_matrices[m_draws[index].matrix]);
+    if (!m_instanceBuffer.isCreated()) {
+        m_instanceBuffer.create();
+        m_instanceBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    }
+    m_instanceBuffer.bind();
+    m_instanceBuffer.allocate(
+        m_instances.data(), 
+        static_cast<int>(m_instances.size() * sizeof(Instance))
+    );
+
+    // Draw the sorted draws, setting only the state which changes
+    StateChanges & changes = m_stats.sorted;
+    ObjectShader * shader = nullptr;
+    QOpenGLVertexArrayObject * vao = nullptr;
+    const Material * material = nullptr;
+    for (std::size_t first = 0; first < m_order.size(); ) {
+        const Draw & draw = m_draws[m_order[first]];
+        std::size_t end = first + 1;
+        while (end < m_order.size() && 
+               isSameGeometry(draw, m_draws[m_order[end]]))
+            end++;
+        
+        if (draw.shader != shader) {
+            shader = draw.shader;
+            shader->bind();
+            shader->setViewUniforms(m_view, m_projection, m_lightSpace.data());
+            shader->setLightUniforms(m_light, m_view);
+            if (!m_isShadow)
+                shader->setCascadeUniforms(m_cascades);
+            changes.shaderBinds++;
+
+            // The uniforms of the previous program do not apply to this one
+            material = nullptr;
+        }
+        if (draw.vao != vao) {
+            vao = draw.vao;
+            vao->bind();
+            for (GLuint i = 0; i < 7; i++) {
+                glFunctions->glEnableVertexAttribArray(c_instanceLocation + i);
+                glFunctions->glVertexAttribDivisor(c_instanceLocation + i, 1);
+            }
+            changes.vaoBinds++;
+        }
+        if (draw.material != nullptr && draw.material != material) {
+            material = draw.material;
+            shader->setMaterialUniforms(*material);
+            changes.materialChanges++;
+        }
+        setInstanceAttributes(glFunctions, first);
+        changes.matrixUploads++;
+
+        // The indices are relative to the first vertex of the mesh
+        glFunctions->glDrawElementsInstancedBaseVertex(
+            GL_TRIANGLES,
+            static_cast<GLsizei>(draw.count),
+            draw.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(
+                static_cast<std::size_t>(draw.offset)
+            ),
+            static_cast<GLsizei>(end - first),
+            static_cast<GLint>(draw.baseVertex)
+        );
+        m_stats.drawCalls++;
+        first = end;
+    }
+    vao->release();
+    m_instanceBuffer.release();
+
+    m_stats.draws += static_cast<unsigned int>(m_draws.size());
+    m_draws.clear();
+    m_keys.clear();
+    m_transparent.clear();
+    m_matrices.clear();
+}
+
+
+void RenderQueue::cleanUp() {
+    m_instanceBuffer.destroy();
+}
+
+
+void RenderQueue::countUnsorted() {
+    StateChanges & changes = m_stats.unsorted;
+    const QOpenGLVertexArrayObject * vao = nullptr;
+    unsigned int matrix = c_noMatrix;
+    for (const Draw & draw : m_draws) {
+        if (draw.vao != vao) {
+            vao = draw.vao;
+            changes.shaderBinds++;
+            changes.vaoBinds++;
+        }
+        if (draw.material != nullptr)
+            changes.materialChanges++;
+        if (draw.matrix != matrix) {
+            matrix = draw.matrix;
+            changes.matrixUploads++;
+        }
+    }
+}
+
+
+void RenderQueue::sortTransparent() {
+    // Least significant digit radix sort on the 24 bits of the depth, 8 bits
+    // per pass. The passes are stable: the draws at the same depth keep the
+    // order they were pushed in.
+    m_sortBuffer.resize(m_transparent.size());
+    for (unsigned int shift = 0; shift < 24; shift += 8) {
+        std::array<unsigned int, 257> offsets = {};
+        for (const std::pair<std::uint32_t, unsigned int> & key : m_transparent)
+            offsets[((key.first >> shift) & 0xff) + 1]++;
+        for (unsigned int i = 0; i < 256; i++)
+            offsets[i + 1] += offsets[i];
+        for (const std::pair<std::uint32_t, unsigned int> & key : m_transparent)
+            m_sortBuffer[offsets[(key.first >> shift) & 0xff]++] = key;
+        m_transparent.swap(m_sortBuffer);
+    }
+}
+
+
+void RenderQueue::setInstanceAttributes(
+    QOpenGLFunctions_3_3_Core * glFunctions, std::size_t first
+) {
+    const GLsizei stride = sizeof(Instance);
+    const std::size_t offset = first * sizeof(Instance);
+    for (GLuint i = 0; i < 4; i++) {
+        glFunctions->glVertexAttribPointer(
+            c_instanceLocation + i, 4, GL_FLOAT, GL_FALSE, stride,
+            reinterpret_cast<const void*>(
+                offset + offsetof(Instance, model) + 4 * i * sizeof(float)
+            )
+        );
+    }
+    for (GLuint i = 0; i < 3; i++) {
+        glFunctions->glVertexAttribPointer(
+            c_instanceLocation + 4 + i, 3, GL_FLOAT, GL_FALSE, stride,
+            reinterpret_cast<const void*>(
+                offset + offsetof(Instance, normal) + 3 * i * sizeof(float)
+            )
+        );
+    }
+}
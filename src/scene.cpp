@@ -1,4 +1,6 @@
 #include "../include/scene.h"
+#include "../include/renderqueue.h"
+#include "../include/threadpool.h"
 
 
 /***
@@ -12,6 +14,10 @@
  *                                 
  */
 
+const std::size_t Scene::c_vehicleBatchSize = 16;
+
+bool Scene::m_cullingReport = false;
+
 Scene::Scene(unsigned int refreshRate, QString envFile, std::vector<QString> vehList) : 
     m_camera(0.0f, 0.0f,QVector3D(0.0f, 0.0f, 0.0f)),
     m_frame(QVector3D(0.0f, 0.0f, 1.0f)),
@@ -25,7 +31,8 @@ Scene::Scene(unsigned int refreshRate, QString envFile, std::vector<QString> veh
     m_vehList(vehList), 
     m_snapshotMode(false),
     m_numSnapshot(5),
-    m_vehFollow(0) {}
+    m_vehFollow(0),
+    m_numFrames(0) {}
 
 
 Scene::~Scene() {}
@@ -41,21 +48,31 @@ void Scene::initialize() {
     m_skybox.initialize();
     m_frame.initialize();
     
+    // Start loading the vehicles: their trajectories and models are loaded on
+    // the thread pool while the environment is loaded
+    std::vector<std::unique_ptr<VehicleBuilder>> vehicleBuilders;
+    for (auto it = m_vehList.begin(); it != m_vehList.end(); it++) {
+        vehicleBuilders.push_back(std::make_unique<VehicleBuilder>(*it));
+        vehicleBuilders.back()->start();
+    }
+    
     // Load the objects of the environment
     Loader loader;
     loader.parse(m_envFile);
-    p_graph = loader.getSceneGraph();
+    std::unique_ptr<Node> root = loader.getSceneGraph();
+    if (root != nullptr)
+        p_graph = std::make_unique<Graph>(*root);
     
     // Create the vehicle
-    for (auto it = m_vehList.begin(); it != m_vehList.end(); it++) {
-        VehicleBuilder vehicleBuilder(*it);
-        if (vehicleBuilder.build()) {
-            std::unique_ptr<Vehicle> vehicle = vehicleBuilder.getVehicle();
+    for (auto it = vehicleBuilders.begin(); it != vehicleBuilders.end(); it++) {
+        if ((*it)->build()) {
+            std::unique_ptr<Vehicle> vehicle = (*it)->getVehicle();
             m_vehicles.push_back(std::move(vehicle));
         }
     }
 
-    // Initialize all the loaded objects
+    // Initialize all the loaded objects. The objects loaded on the thread pool
+    // have been initialized as they were received.
     ObjectManager::initialize();
     
     // Get the simulation duration from the vehicle trajectory
@@ -78,20 +95,59 @@ void Scene::resize(int w, int h) {
 
 
 void Scene::update() {
-    // Update vehicle position
+    // The trajectories streamed by a running simulation grow while the 
+    // animation is playing
     for (unsigned int i = 0; i < m_vehicles.size(); i++) {
         if (m_vehicles.at(i) != nullptr) {
-            m_vehicles.at(i)->updatePosition(m_timestep);
+            m_finalTimestep = 
+                std::max(m_finalTimestep, m_vehicles.at(i)->getFinalTimeStep());
         }
     }
     
+    // Time-steps at which the vehicles are drawn: the current time-step first,
+    // then the snapshots
+    const unsigned int numPoses = m_snapshotMode ? m_numSnapshot + 1 : 1;
+    m_frameTimesteps.resize(numPoses);
+    m_frameTimesteps[0] = m_timestep;
+    for (unsigned int k = 1; k < numPoses; k++) {
+        m_frameTimesteps[k] = m_firstTimestep + 
+            static_cast<float>(k-1)/m_numSnapshot * 
+            (m_finalTimestep - m_firstTimestep);
+    }
+    
+    // Update the world matrices of the scene graph nodes which have moved
+    if (p_graph != nullptr)
+        p_graph->update();
+    
+    // Evaluate the position and the model matrices of each vehicle once per 
+    // frame. They are reused by the shadow and color passes. The vehicles are 
+    // independent: they are processed in batches on the thread pool, each 
+    // batch writing its own range of the frame buffers.
+    const std::size_t numVehicles = m_vehicles.size();
+    m_framePositions.resize(numVehicles * numPoses);
+    m_frameMatrices.resize(numVehicles * numPoses);
+    const std::size_t numBatches = 
+        (numVehicles + c_vehicleBatchSize - 1) / c_vehicleBatchSize;
+    ThreadPool::global().parallelFor(numBatches, [&](std::size_t batch) {
+        const std::size_t last = 
+            std::min(numVehicles, (batch + 1) * c_vehicleBatchSize);
+        for (std::size_t i = batch * c_vehicleBatchSize; i < last; i++) {
+            Vehicle * vehicle = m_vehicles[i].get();
+            if (vehicle == nullptr)
+                continue;
+            VehiclePosition * positions = &m_framePositions[i * numPoses];
+            vehicle->getPositions(m_frameTimesteps, positions);
+            for (unsigned int k = 0; k < numPoses; k++) {
+                m_frameMatrices[i * numPoses + k] = 
+                    vehicle->getMatrices(positions[k]);
+            }
+        }
+    });
+    
     // Get the position of the vehicle to follow
     Position vehiclePosition;
-    if (m_vehFollow < m_vehicles.size()) {
-        if (m_vehicles.at(m_vehFollow) != nullptr) {
-            vehiclePosition = m_vehicles.at(m_vehFollow)->getPosition(m_timestep);
-        }
-    }
+    if (m_vehFollow < numVehicles && m_vehicles.at(m_vehFollow) != nullptr)
+        vehiclePosition = m_framePositions.at(m_vehFollow * numPoses).chassis;
     
     // Update camera
     m_camera.trackObject(vehiclePosition);
@@ -122,22 +178,21 @@ void Scene::render() {
     }
     
     // Call the render method of object in the scene
+    CullingStats & stats = CullingStats::color();
+    stats = CullingStats();
     m_skybox.render(m_view, m_projection);
+    RenderQueue & queue = RenderQueue::global();
+    queue.begin(m_light, m_view, m_projection, m_lightSpace, m_cascades);
     if (p_graph != nullptr)
         p_graph->render(m_light, m_view, m_projection, m_lightSpace, m_cascades);
+    // In snapshot mode, only the snapshots are drawn
+    const unsigned int numPoses = m_frameTimesteps.size();
+    const unsigned int firstPose = numPoses > 1 ? 1 : 0;
     for (unsigned int i = 0; i < m_vehicles.size(); i++) {
         if (m_vehicles.at(i) != nullptr) {
-            if (m_snapshotMode) {
-                for (unsigned int k = 0; k < m_numSnapshot; k++) {
-                    float timestep = m_firstTimestep + static_cast<float>(k)/m_numSnapshot * 
-                        (m_finalTimestep - m_firstTimestep);
-                    m_vehicles.at(i)->updatePosition(timestep);
-                    m_vehicles.at(i)->render(
-                        m_light, m_view, m_projection, m_lightSpace, m_cascades
-                    );
-                }
-            } else {
+            for (unsigned int k = firstPose; k < numPoses; k++) {
                 m_vehicles.at(i)->render(
+                    m_frameMatrices.at(i * numPoses + k), 
                     m_light, m_view, m_projection, m_lightSpace, m_cascades
                 );
             }
@@ -147,32 +202,70 @@ void Scene::render() {
         m_frame.setModelMatrix(QMatrix4x4());
         m_frame.render(m_light, m_view, m_projection, m_lightSpace, m_cascades);
     }
+    
+    // Draw the meshes of the models. The transparent meshes of all the models
+    // are drawn last, after all the opaque geometry.
+    queue.submit();
+    
+    // Report the culling statistics once per second
+    m_numFrames++;
+    if (m_cullingReport && m_numFrames % m_refreshRate == 0) {
+        const CullingStats & shadow = CullingStats::shadow();
+        qInfo() << "Frustum culling:" << stats.drawnObjects << "objects drawn,"
+            << stats.culledObjects << "culled;" << stats.drawnMeshes 
+            << "meshes drawn," << stats.culledMeshes << "culled";
+        qInfo() << "Shadow culling (" << NUM_CASCADES << "cascades):" 
+            << shadow.drawnObjects << "objects drawn," << shadow.culledObjects
+            << "culled;" << shadow.drawnMeshes << "meshes drawn," 
+            << shadow.culledMeshes << "culled";
+        const RenderQueue::Stats & queueStats = queue.getStats();
+        const RenderQueue::StateChanges & unsorted = queueStats.unsorted;
+        const RenderQueue::StateChanges & sorted = queueStats.sorted;
+        qInfo() << "Render queue:" << queueStats.draws << "draws in" 
+            << queueStats.drawCalls << "instanced draw calls;"
+            << "state changes unsorted / sorted:" << unsorted.shaderBinds 
+            << "/" << sorted.shaderBinds << "shaders," << unsorted.vaoBinds 
+            << "/" << sorted.vaoBinds << "VAOs," << unsorted.materialChanges
+            << "/" << sorted.materialChanges << "materials," 
+            << unsorted.matrixUploads << "/" << sorted.matrixUploads 
+            << "matrices";
+    }
 }
 
 
 void Scene::renderShadow(unsigned int cascadeIdx) {
-    // Render the shadow map
+    // The statistics are summed over the cascades
+    RenderQueue & queue = RenderQueue::global();
+    if (cascadeIdx == 0) {
+        CullingStats::shadow() = CullingStats();
+        queue.resetStats();
+    }
+    
+    // Render the shadow map. The queue is submitted for each cascade since
+    // each cascade has its own framebuffer.
+    queue.beginShadow(m_lightSpace.at(cascadeIdx));
     if (p_graph != nullptr)
         p_graph->renderShadow(m_lightSpace.at(cascadeIdx));
+    // In snapshot mode, only the snapshots are drawn
+    const unsigned int numPoses = m_frameTimesteps.size();
+    const unsigned int firstPose = numPoses > 1 ? 1 : 0;
     for (unsigned int i = 0; i < m_vehicles.size(); i++) {
         if (m_vehicles.at(i) != nullptr) {
-            if (m_snapshotMode) {
-                for (unsigned int k = 0; k < m_numSnapshot; k++) {
-                    float timestep = m_firstTimestep + static_cast<float>(k)/m_numSnapshot * 
-                        (m_finalTimestep - m_firstTimestep);
-                    m_vehicles.at(i)->updatePosition(timestep);
-                    m_vehicles.at(i)->renderShadow(m_lightSpace.at(cascadeIdx));
-                }
-            } else {
-                m_vehicles.at(i)->renderShadow(m_lightSpace.at(cascadeIdx));
+            for (unsigned int k = firstPose; k < numPoses; k++) {
+                m_vehicles.at(i)->renderShadow(
+                    m_frameMatrices.at(i * numPoses + k), 
+                    m_lightSpace.at(cascadeIdx)
+                );
             }
         }
     }
+    queue.submit();
 }
 
 
 void Scene::cleanUp() {
     m_skybox.cleanUp();
+    RenderQueue::global().cleanUp();
     m_frame.cleanup();
     ObjectManager::cleanUp();
     TextureManager::cleanUp();
@@ -274,6 +367,9 @@ void Scene::Loader::parse(QString const fileNameIn) {
     domDoc.setContent(&file);
     file.close();
     
+    // Load the models in parallel while the scene graph is built
+    loadModels(domDoc);
+    
     // Extract the root
     QDomElement world = domDoc.documentElement();
     
@@ -362,7 +458,7 @@ std::unique_ptr<Scene::Node>  Scene::Loader::processTransform(
     
     // Create new node for transformed object
     std::unique_ptr<Node> node;
-    node = std::make_unique<Node>(parentMatrix, localMatrix);
+    node = std::make_unique<Node>(localMatrix, parentMatrix);
     
     // Process the object moved by the transformation
     for (
@@ -402,26 +498,17 @@ ABCObject *  Scene::Loader::processModel(const QDomElement & elmt) {
         return nullptr;
     }
     
-    // Check that the ID of the plan is unique
-    if (ObjectManager::getObject(name) != nullptr) {
+    // Check that the ID of the plan is unique: only the first model element 
+    // with this name has been loaded by loadModels()
+    if (m_loadingModels.erase(name) == 0) {
         qWarning() << 
             "An object with name" << name << "already exists. The object will "
             "not be rendered.";
         return nullptr;
     }
     
-    // Retrieve attributes
-    QString fileName = elmt.attribute("url","");
-    QString textureDir = elmt.attribute("textureFolder","");
-    
-    // Build object and add it to the container
-    ABCObject * model = nullptr;
-    Object::Loader modelLoader(fileName, textureDir);
-    if (modelLoader.build()) {
-        model = ObjectManager::loadObject(name, modelLoader.getObject());
-        return model;
-    }
-    return nullptr;
+    // Wait for the object
+    return ObjectManager::getObject(name);
 }
 
 
@@ -467,6 +554,35 @@ ABCObject * Scene::Loader::processReference(const QDomElement& elmt) {
 }
 
 
+void Scene::Loader::loadModels(const QDomDocument & domDoc) {
+    QDomNodeList models = domDoc.elementsByTagName("model");
+    for (int i = 0; i < models.size(); i++) {
+        QDomElement elmt = models.at(i).toElement();
+        QString name = elmt.attribute("name","");
+        
+        // The errors are reported by processModel()
+        if (name.isEmpty() || m_loadingModels.count(name) != 0 || 
+            ObjectManager::getObject(name) != nullptr)
+            continue;
+        
+        // Retrieve attributes
+        QString fileName = elmt.attribute("url","");
+        QString textureDir = elmt.attribute("textureFolder","");
+        
+        // Build the object on the thread pool
+        m_loadingModels.insert(name);
+        ObjectManager::loadObjectAsync(
+            name, [fileName, textureDir]() -> std::unique_ptr<ABCObject> {
+                Object::Loader modelLoader(fileName, textureDir);
+                if (modelLoader.build())
+                    return modelLoader.getObject();
+                return nullptr;
+            }
+        );
+    }
+}
+
+
 
 
 /***
@@ -485,55 +601,180 @@ ABCObject * Scene::Loader::processReference(const QDomElement& elmt) {
  *                        |_|          
  */
 
-void Scene::Node::render(
-    const CasterLight & light, const QMatrix4x4 & view, 
-    const QMatrix4x4 & projection, 
-    const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
-    const std::array<float,NUM_CASCADES+1> & cascades
-) {
-    // Draw the node
-    for (auto it = m_objects.begin(); it != m_objects.end(); it++) {
-        if (*it != nullptr) {
-            // Set model matrix
-            (*it)->setModelMatrix(m_worldMatrix);
-            
-            // Draw
-            (*it)->render(
-                light, view, projection, lightSpace, cascades
+Scene::Graph::Graph(const Node & root) : m_isDirty(false) {
+    compileNode(root, 0);
+}
+
+
+void Scene::Graph::compileNode(const Node & node, std::size_t parent) {
+    const std::size_t index = m_nodes.size();
+    NodeRecord record;
+    record.localMatrix = node.getLocalMatrix();
+    record.worldMatrix = node.getWorldMatrix();
+    record.isBounded = true;
+    record.isDirty = false;
+    record.parent = parent;
+    record.firstDraw = m_draws.size();
+    for (ABCObject * object : node.getObjects()) {
+        if (object != nullptr)
+            m_draws.push_back(
+                DrawRecord{object, record.worldMatrix, BoundingBox(), false}
             );
-        }
     }
+    record.endDraw = m_draws.size();
+    m_nodes.push_back(record);
+    if (index == 0)
+        m_rootParentMatrix = node.getParentWorldMatrix();
+    updateWorldMatrix(index);
     
-    // Draw its descendant
-    for (auto it = m_children.begin(); it != m_children.end(); it++) {
-        (*it)->render(light, view, projection, lightSpace, cascades);
+    // The descendants follow the node
+    for (const std::unique_ptr<Node> & child : node.getChildren()) {
+        if (child != nullptr)
+            compileNode(*child, index);
     }
+    m_nodes[index].end = m_nodes.size();
+    m_nodes[index].endSubtreeDraw = m_draws.size();
+    updateBoundingBox(index);
 }
 
 
-void Scene::Node::renderShadow(const QMatrix4x4& lightSpace) {
-    // Draw the node
-    for (auto it = m_objects.begin(); it != m_objects.end(); it++) {
-        if (*it != nullptr) {
-            // Set model matrix
-            (*it)->setModelMatrix(m_worldMatrix);
-            
-            // Draw
-            (*it)->renderShadow(lightSpace);
-        }
+void Scene::Graph::setLocalMatrix(
+    std::size_t node, const QMatrix4x4 & localMatrix
+) {
+    if (node >= m_nodes.size())
+        return;
+    m_nodes[node].localMatrix = localMatrix;
+    m_nodes[node].isDirty = true;
+    m_isDirty = true;
+}
+
+
+void Scene::Graph::update() {
+    if (!m_isDirty)
+        return;
+    
+    // The parents precede their descendants: a node is dirty if its parent
+    // is dirty
+    for (std::size_t i = 0; i < m_nodes.size(); i++) {
+        NodeRecord & node = m_nodes[i];
+        if (i > 0 && m_nodes[node.parent].isDirty)
+            node.isDirty = true;
+        if (node.isDirty)
+            updateWorldMatrix(i);
     }
     
-    // Draw its descendant
-    for (auto it = m_children.begin(); it != m_children.end(); it++) {
-        (*it)->renderShadow(lightSpace);
+    // The descendants follow their parents: the bounding boxes are computed
+    // from the last node, and the ancestors of the dirty nodes are marked 
+    // dirty
+    for (std::size_t i = m_nodes.size(); i-- > 0; ) {
+        NodeRecord & node = m_nodes[i];
+        if (!node.isDirty)
+            continue;
+        updateBoundingBox(i);
+        node.isDirty = false;
+        if (i > 0)
+            m_nodes[node.parent].isDirty = true;
     }
+    m_isDirty = false;
 }
 
 
+void Scene::Graph::updateWorldMatrix(std::size_t index) {
+    NodeRecord & node = m_nodes[index];
+    const QMatrix4x4 & parentWorldMatrix = index > 0 ? 
+        m_nodes[node.parent].worldMatrix : m_rootParentMatrix;
+    node.worldMatrix = parentWorldMatrix * node.localMatrix;
+    for (std::size_t d = node.firstDraw; d < node.endDraw; d++) {
+        DrawRecord & draw = m_draws[d];
+        const BoundingBox * boundingBox = draw.object->getBoundingBox();
+        draw.worldMatrix = node.worldMatrix;
+        draw.isBounded = (boundingBox != nullptr);
+        draw.boundingBox = draw.isBounded ? 
+            boundingBox->transformed(node.worldMatrix) : BoundingBox();
+    }
+}
+
 
+void Scene::Graph::updateBoundingBox(std::size_t index) {
+    NodeRecord & node = m_nodes[index];
+    node.boundingBox = BoundingBox();
+    node.isBounded = true;
+    for (std::size_t d = node.firstDraw; d < node.endDraw; d++) {
+        node.boundingBox.expand(m_draws[d].boundingBox);
+        node.isBounded = node.isBounded && m_draws[d].isBounded;
+    }
+    for (std::size_t c = index + 1; c < node.end; c = m_nodes[c].end) {
+        node.boundingBox.expand(m_nodes[c].boundingBox);
+        node.isBounded = node.isBounded && m_nodes[c].isBounded;
+    }
+}
 
 
+template<class Draw>
+void Scene::Graph::forEachVisible(
+    const Frustum & frustum, CullingStats & stats, Draw draw
+) {
+    // The nodes outside the frustum are skipped with their descendants. The 
+    // descendants of a node inside the frustum (i.e. before insideEnd) are 
+    // not tested.
+    std::size_t insideEnd = 0;
+    for (std::size_t i = 0; i < m_nodes.size(); ) {
+        const NodeRecord & node = m_nodes[i];
+        bool inside = i < insideEnd;
+        if (!inside && node.isBounded) {
+            const Frustum::Test test = frustum.test(node.boundingBox);
+            if (test == Frustum::Outside) {
+                stats.culledObjects += static_cast<unsigned int>(
+                    node.endSubtreeDraw - node.firstDraw
+                );
+                i = node.end;
+                continue;
+            }
+            if (test == Frustum::Inside) {
+                inside = true;
+                insideEnd = node.end;
+            }
+        }
+        for (std::size_t d = node.firstDraw; d < node.endDraw; d++) {
+            const DrawRecord & record = m_draws[d];
+            if (!inside && record.isBounded && 
+                frustum.test(record.boundingBox) == Frustum::Outside) {
+                stats.culledObjects++;
+                continue;
+            }
+            stats.drawnObjects++;
+            draw(record);
+        }
+        i++;
+    }
+}
 
 
+void Scene::Graph::render(
+    const CasterLight & light, const QMatrix4x4 & view, 
+    const QMatrix4x4 & projection, 
+    const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
+    const std::array<float,NUM_CASCADES+1> & cascades
+) {
+    forEachVisible(
+        Frustum(projection * view), CullingStats::color(), 
+        [&](const DrawRecord & record) {
+            record.object->setModelMatrix(record.worldMatrix);
+            record.object->render(
+                light, view, projection, lightSpace, cascades
+            );
+        }
+    );
+}
 
 
+void Scene::Graph::renderShadow(const QMatrix4x4 & lightSpace) {
+    // The shadow casters between the light and the cascade are kept
+    forEachVisible(
+        Frustum(lightSpace, false), CullingStats::shadow(), 
+        [&](const DrawRecord & record) {
+            record.object->setModelMatrix(record.worldMatrix);
+            record.object->renderShadow(lightSpace);
+        }
+    );
+}
@@ -47,6 +47,18 @@ Shader::Shader(QString vShader, QString fShader) {
  *                                              
  */
 
+void ObjectShader::setSamplerUniforms() {
+    setUniformValue("diffuseSampler", COLOR_TEXTURE_UNIT);
+    setUniformValue("normalSampler",  NORMAL_TEXTURE_UNIT);
+    setUniformValue("depthSampler",   BUMP_TEXTURE_UNIT);
+    for (unsigned int i = 0; i < NUM_CASCADES; i++) {
+        char name[128] = {0};
+        snprintf(name, sizeof(name), "shadowMap[%d]", i);
+        setUniformValue(name, SHADOW_TEXTURE_UNITS[i]);
+    }
+}
+
+
 void ObjectShader::setMaterialUniforms(const Material & material) {
     // Set material properties
     setUniformValue("Ka", material.getAmbientColor());
@@ -63,36 +75,15 @@ void ObjectShader::setMaterialUniforms(const Material & material) {
         material.getNormalTexture()->bind(NORMAL_TEXTURE_UNIT);
     if (material.getBumpTexture() != nullptr)
         material.getBumpTexture()->bind(BUMP_TEXTURE_UNIT);
-    setUniformValue("diffuseSampler", COLOR_TEXTURE_UNIT);
-    setUniformValue("normalSampler",  NORMAL_TEXTURE_UNIT);
-    setUniformValue("depthSampler",   BUMP_TEXTURE_UNIT);
-    for (unsigned int i = 0; i < NUM_CASCADES; i++) {
-        char name[128] = {0};
-        snprintf(name, sizeof(name), "shadowMap[%d]", i);
-        setUniformValue(name, SHADOW_TEXTURE_UNITS[i]);
-    }
 }
 
 
-void ObjectShader::setMatrixUniforms(
-    const QMatrix4x4 & M, const QMatrix4x4 & V, const QMatrix4x4 & P, 
-    const QMatrix4x4 lVP[]
+void ObjectShader::setViewUniforms(
+    const QMatrix4x4 & V, const QMatrix4x4 & P, const QMatrix4x4 lVP[]
 ) {
-    QMatrix4x4 MV = V*M;
-    QMatrix4x4 MVP = P * MV;
-    QMatrix3x3 N = MV.normalMatrix();
-
     // Set matrices uniform
-    setUniformValue("M", M);
-    setUniformValue("MV", MV);
-    setUniformValue("MVP", MVP);
-    setUniformValue("N", N);
-    
-    // Set camera position uniform
-    QVector3D cameraPosition(V.inverted().column(3));
-    setUniformValue("cameraPosition", 
-        QVector3D(V*QVector4D(cameraPosition))
-    );
+    setUniformValue("V", V);
+    setUniformValue("VP", P * V);
     
     // Set light transform uniform for shadow mapping for all cascades
     QOpenGLContext * context = QOpenGLContext::currentContext();
@@ -106,13 +97,13 @@ void ObjectShader::setMatrixUniforms(
     for(unsigned int i = 0; i < NUM_CASCADES; i++) {
         // Find the location of the uniform
         char name[128] = {0};
-        snprintf(name, sizeof(name), "lMVP[%d]", i);
+        snprintf(name, sizeof(name), "lVP[%d]", i);
         GLuint location = glFunctions->glGetUniformLocation(
             programId(), name
         );
         // Set uniform
-        QMatrix4x4 lMVP = lVP[i] * M;
-        glFunctions->glUniformMatrix4fv(location, 1, GL_FALSE, lMVP.constData());
+        glFunctions->glUniformMatrix4fv(location, 1, GL_FALSE, 
+                                        lVP[i].constData());
     }
 }
 
@@ -169,19 +160,21 @@ void ObjectShader::setCascadeUniforms(
  *                                                    
  */
 
+void ObjectShadowShader::setSamplerUniforms() {
+    // Nothing to do: no texture is sampled to render the shadow frame buffer.
+}
+
+
 void ObjectShadowShader::setMaterialUniforms(const Material & /*material*/) {
     // Nothing to do: no need to apply material to render the shadow 
     // frame buffer.
 }
 
 
-void ObjectShadowShader::setMatrixUniforms(
-    const QMatrix4x4 & M, const QMatrix4x4 & /*V*/, const QMatrix4x4 & /*P*/, 
-    const QMatrix4x4 lVP[]
+void ObjectShadowShader::setViewUniforms(
+    const QMatrix4x4 & /*V*/, const QMatrix4x4 & /*P*/, const QMatrix4x4 lVP[]
 ) {
-    QMatrix4x4 lMVP = lVP[0] * M;
-    
-    setUniformValue("lMVP", lMVP);
+    setUniformValue("lVP", lVP[0]);
 }
 
 
@@ -0,0 +1,264 @@
+#include "../include/tangentspace.h"
+#include "../include/threadpool.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TANGENTSPACE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    /**
+     * Number of vertices orthonormalized by a thread at once. The meshes 
+     * smaller than this are processed by the calling thread only.
+     */
+    const std::size_t c_blockSize = 16 * 1024;
+    
+    /**
+     * @brief Accumulate the tangent and bitangent of each triangle on its 
+     * vertices.
+     * @details The edges of the triangle are combined with the texture 
+     * coordinates without dividing by the determinant of the texture edges: 
+     * only its sign is applied, so that each triangle is weighted by its area
+     * in texture space and the division of each triangle is saved. The 
+     * vertices are shared by the triangles: the accumulation is sequential.
+     */
+    void accumulateTriangles(
+        const MeshStreams & streams, std::size_t firstVertex, float * tangents,
+        float * bitangents
+    ) {
+        const float * p = streams.vertices.data();
+        const float * uv = streams.textureUV.data();
+        const unsigned int * indices = streams.indices.data();
+        const std::size_t numTriangles = streams.indices.size() / 3;
+        for (std::size_t t = 0; t < numTriangles; t++) {
+            const unsigned int * i = indices + 3 * t;
+            const float * p0 = p + 3 * i[0];
+            const float * p1 = p + 3 * i[1];
+            const float * p2 = p + 3 * i[2];
+            const float * uv0 = uv + 2 * i[0];
+            const float * uv1 = uv + 2 * i[1];
+            const float * uv2 = uv + 2 * i[2];
+            const float du1 = uv1[0] - uv0[0], dv1 = uv1[1] - uv0[1];
+            const float du2 = uv2[0] - uv0[0], dv2 = uv2[1] - uv0[1];
+            
+            // Sign of the determinant, 0 without texture mapping
+            const float det = du1 * dv2 - du2 * dv1;
+            const float s = det > 0.0f ? 1.0f : (det < 0.0f ? -1.0f : 0.0f);
+            
+            float tangent[3], bitangent[3];
+            for (unsigned int c = 0; c < 3; c++) {
+                const float e1 = p1[c] - p0[c];
+                const float e2 = p2[c] - p0[c];
+                tangent[c] = s * (e1 * dv2 - e2 * dv1);
+                bitangent[c] = s * (e2 * du1 - e1 * du2);
+            }
+            for (unsigned int k = 0; k < 3; k++) {
+                const std::size_t v = 3 * (i[k] - firstVertex);
+                for (unsigned int c = 0; c < 3; c++) {
+                    tangents[v + c] += tangent[c];
+                    bitangents[v + c] += bitangent[c];
+                }
+            }
+        }
+    }
+    
+    /**
+     * @brief Orthonormalize the accumulated tangent of a vertex against its 
+     * normal and compute its bitangent.
+     */
+    void orthonormalize(const float * normal, float * tangent, float * bitangent) {
+        // Unit normal
+        float n[3] = {normal[0], normal[1], normal[2]};
+        const float nn = n[0]*n[0] + n[1]*n[1] + n[2]*n[2];
+        const float invN = nn > 0.0f ? 1.0f / std::sqrt(nn) : 0.0f;
+        for (unsigned int c = 0; c < 3; c++)
+            n[c] *= invN;
+        
+        // Gram-Schmidt: remove the normal component of the tangent
+        const float nt = n[0]*tangent[0] + n[1]*tangent[1] + n[2]*tangent[2];
+        float t[3];
+        for (unsigned int c = 0; c < 3; c++)
+            t[c] = tangent[c] - nt * n[c];
+        float tt = t[0]*t[0] + t[1]*t[1] + t[2]*t[2];
+        if (!(tt > 1e-20f)) {
+            // No texture mapping: any vector orthogonal to the normal
+            if (std::abs(n[0]) < 0.9f) {
+                t[0] = 0.0f; t[1] = n[2]; t[2] = -n[1];
+            }
+            else {
+                t[0] = -n[2]; t[1] = 0.0f; t[2] = n[0];
+            }
+            tt = t[0]*t[0] + t[1]*t[1] + t[2]*t[2];
+        }
+        const float invT = tt > 0.0f ? 1.0f / std::sqrt(tt) : 0.0f;
+        for (unsigned int c = 0; c < 3; c++)
+            t[c] *= invT;
+        
+        // The bitangent is flipped when the texture is mirrored
+        float b[3] = {
+            n[1]*t[2] - n[2]*t[1], n[2]*t[0] - n[0]*t[2], n[0]*t[1] - n[1]*t[0]
+        };
+        const float handedness = 
+            b[0]*bitangent[0] + b[1]*bitangent[1] + b[2]*bitangent[2] < 0.0f ? 
+            -1.0f : 1.0f;
+        for (unsigned int c = 0; c < 3; c++) {
+            tangent[c] = t[c];
+            bitangent[c] = handedness * b[c];
+        }
+    }
+    
+#ifdef TANGENTSPACE_USE_SSE2
+    /**
+     * @brief Load the coordinates of four consecutive vectors (x0 y0 z0 x1 
+     * y1 ... z3) as one register per coordinate.
+     */
+    inline void load4(const float * data, __m128 v[3]) {
+        const __m128 a = _mm_loadu_ps(data);     // x0 y0 z0 x1
+        const __m128 b = _mm_loadu_ps(data + 4); // y1 z1 x2 y2
+        const __m128 c = _mm_loadu_ps(data + 8); // z2 x3 y3 z3
+        v[0] = _mm_shuffle_ps(
+            a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), 
+            _MM_SHUFFLE(2, 0, 3, 0)
+        );
+        v[1] = _mm_shuffle_ps(
+            _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), 
+            _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), 
+            _MM_SHUFFLE(2, 0, 2, 0)
+        );
+        v[2] = _mm_shuffle_ps(
+            _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), 
+            _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), 
+            _MM_SHUFFLE(2, 0, 2, 0)
+        );
+    }
+    
+    /**
+     * @brief Store four vectors given as one register per coordinate, the 
+     * reverse of load4().
+     */
+    inline void store4(float * data, const __m128 v[3]) {
+        const __m128 zx = _mm_shuffle_ps(v[2], v[0], _MM_SHUFFLE(1, 1, 0, 0));
+        const __m128 yz = _mm_shuffle_ps(v[1], v[2], _MM_SHUFFLE(1, 1, 1, 1));
+        const __m128 xy = _mm_unpackhi_ps(v[0], v[1]);
+        _mm_storeu_ps(data, _mm_shuffle_ps(
+            _mm_unpacklo_ps(v[0], v[1]), zx, _MM_SHUFFLE(2, 0, 1, 0)
+        ));
+        _mm_storeu_ps(data + 4, _mm_shuffle_ps(
+            yz, xy, _MM_SHUFFLE(1, 0, 2, 0)
+        ));
+        _mm_storeu_ps(data + 8, _mm_shuffle_ps(
+            _mm_shuffle_ps(v[2], v[0], _MM_SHUFFLE(3, 3, 2, 2)), 
+            _mm_shuffle_ps(v[1], v[2], _MM_SHUFFLE(3, 3, 3, 3)), 
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ));
+    }
+    
+    /**
+     * @brief Return 1 / sqrt(x): the approximation of the processor refined 
+     * by a Newton-Raphson step, which is accurate to about 1e-7 and much 
+     * faster than a square root followed by a division.
+     */
+    inline __m128 reciprocalSqrt(__m128 x) {
+        const __m128 r = _mm_rsqrt_ps(x);
+        return _mm_mul_ps(r, _mm_sub_ps(
+            _mm_set1_ps(1.5f), 
+            _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), _mm_mul_ps(r, r))
+        ));
+    }
+#endif
+    
+    /**
+     * @brief Orthonormalize the tangents of the vertices [first, last).
+     */
+    void orthonormalizeVertices(
+        const float * normals, float * tangents, float * bitangents, 
+        std::size_t first, std::size_t last
+    ) {
+        std::size_t v = first;
+#ifdef TANGENTSPACE_USE_SSE2
+        // Four vertices per iteration, falling back to the scalar version for 
+        // the vertices without texture mapping or with a null normal
+        const __m128 epsilon = _mm_set1_ps(1e-20f);
+        for (; v + 4 <= last; v += 4) {
+            __m128 n[3], t[3], b[3];
+            load4(normals + 3 * v, n);
+            load4(tangents + 3 * v, t);
+            load4(bitangents + 3 * v, b);
+            auto dot = [](const __m128 x[3], const __m128 y[3]) {
+                return _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(x[0], y[0]), _mm_mul_ps(x[1], y[1])), 
+                    _mm_mul_ps(x[2], y[2])
+                );
+            };
+            
+            // Unit normal
+            const __m128 nn = dot(n, n);
+            const __m128 invN = reciprocalSqrt(nn);
+            for (unsigned int c = 0; c < 3; c++)
+                n[c] = _mm_mul_ps(n[c], invN);
+            
+            // Gram-Schmidt
+            const __m128 nt = dot(n, t);
+            for (unsigned int c = 0; c < 3; c++)
+                t[c] = _mm_sub_ps(t[c], _mm_mul_ps(nt, n[c]));
+            const __m128 tt = dot(t, t);
+            const int valid = _mm_movemask_ps(_mm_and_ps(
+                _mm_cmpgt_ps(nn, epsilon), _mm_cmpgt_ps(tt, epsilon)
+            ));
+            if (valid != 0xf) {
+                for (std::size_t k = v; k < v + 4; k++) {
+                    orthonormalize(
+                        normals + 3 * k, tangents + 3 * k, bitangents + 3 * k
+                    );
+                }
+                continue;
+            }
+            const __m128 invT = reciprocalSqrt(tt);
+            for (unsigned int c = 0; c < 3; c++)
+                t[c] = _mm_mul_ps(t[c], invT);
+            
+            // Bitangent, flipped when the texture is mirrored
+            __m128 nxt[3] = {
+                _mm_sub_ps(_mm_mul_ps(n[1], t[2]), _mm_mul_ps(n[2], t[1])),
+                _mm_sub_ps(_mm_mul_ps(n[2], t[0]), _mm_mul_ps(n[0], t[2])),
+                _mm_sub_ps(_mm_mul_ps(n[0], t[1]), _mm_mul_ps(n[1], t[0]))
+            };
+            const __m128 sign = _mm_and_ps(
+                _mm_cmplt_ps(dot(nxt, b), _mm_setzero_ps()), _mm_set1_ps(-0.0f)
+            );
+            for (unsigned int c = 0; c < 3; c++)
+                b[c] = _mm_xor_ps(nxt[c], sign);
+            store4(tangents + 3 * v, t);
+            store4(bitangents + 3 * v, b);
+        }
+#endif
+        for (; v < last; v++)
+            orthonormalize(normals + 3 * v, tangents + 3 * v, bitangents + 3 * v);
+    }
+}
+
+
+void TangentSpace::generate(
+    const MeshStreams & streams, std::size_t firstVertex, 
+    std::size_t numVertices
+) {
+    float * tangents = streams.tangents.data() + 3 * firstVertex;
+    float * bitangents = streams.bitangents.data() + 3 * firstVertex;
+    std::fill(tangents, tangents + 3 * numVertices, 0.0f);
+    std::fill(bitangents, bitangents + 3 * numVertices, 0.0f);
+    accumulateTriangles(streams, firstVertex, tangents, bitangents);
+    
+    // Orthonormalize the tangent frame of each vertex
+    const float * normals = streams.normals.data() + 3 * firstVertex;
+    ThreadPool::global().parallelFor(
+        (numVertices + c_blockSize - 1) / c_blockSize, [&](std::size_t block) {
+            orthonormalizeVertices(
+                normals, tangents, bitangents, block * c_blockSize, 
+                std::min(numVertices, (block + 1) * c_blockSize)
+            );
+        }
+    );
+}
@@ -1,6 +1,14 @@
 #include "../include/texture.h"
 
 
+void Texture::upload() {
+    if (m_image.isNull())
+        return;
+    setData(m_image, m_genMipMaps);
+    m_image = QImage();
+}
+
+
 /***
  *             _______           _                     
  *            |__   __|         | |                    
@@ -18,11 +26,15 @@
 
 // Instantiate static member variables
 TextureManager::TexturesMapsContainer TextureManager::m_textures;
+std::vector<Texture *> TextureManager::m_pendingTextures;
+std::mutex TextureManager::m_mutex;
 
 
 Texture * TextureManager::loadTexture(
     QString name, Texture::Type type, QImage & image
 ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
     // Check if a texture with the same type has already been loaded
     TexturesMapsContainer::iterator searchType = m_textures.find(type);
     if (searchType != m_textures.end()) {
@@ -33,13 +45,15 @@ Texture * TextureManager::loadTexture(
             return searchTexture->second.get();
         }
     }
-    // The texture has not been loaded yet
+    // The texture has not been loaded yet. It is uploaded by initialize().
     m_textures[type][name] = std::make_unique<Texture>(type, image);
+    m_pendingTextures.push_back(m_textures[type][name].get());
     return m_textures[type][name].get();
 }
 
 
 Texture * TextureManager::getTexture(QString name, Texture::Type type) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     TexturesMap::iterator it(m_textures[type].find(name));
     if (it != m_textures.at(type).end())
         return it->second.get();
@@ -48,6 +62,17 @@ Texture * TextureManager::getTexture(QString name, Texture::Type type) {
 }
 
 
+void TextureManager::initialize() {
+    std::vector<Texture *> textures;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        textures.swap(m_pendingTextures);
+    }
+    for (Texture * texture : textures)
+        texture->upload();
+}
+
+
 void TextureManager::cleanUp() {
     // Delete all textures
     for (
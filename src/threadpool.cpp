@@ -0,0 +1,97 @@
+#include "../include/threadpool.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int numThreads) :
+    m_stop(false) {
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    m_threads.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; i++)
+        m_threads.emplace_back(&ThreadPool::run, this);
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (std::thread & thread : m_threads)
+        thread.join();
+}
+
+
+ThreadPool & ThreadPool::global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]{return m_stop || !m_tasks.empty();});
+            if (m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+
+void ThreadPool::parallelFor(
+    std::size_t count, const std::function<void(std::size_t)> & function
+) {
+    if (count == 0)
+        return;
+    if (count == 1) {
+        function(0);
+        return;
+    }
+
+    // The indices are distributed dynamically: each worker takes the next
+    // index until all indices are processed. The calling thread also works
+    // so that nested calls cannot dead-lock.
+    struct State {
+        std::atomic<std::size_t> next;
+        std::atomic<std::size_t> done;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    state->next = 0;
+    state->done = 0;
+    auto work = [state, count, &function]{
+        std::size_t i;
+        while ((i = state->next.fetch_add(1)) < count) {
+            function(i);
+            if (state->done.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    const std::size_t numHelpers = std::min<std::size_t>(size(), count - 1);
+    for (std::size_t i = 0; i < numHelpers; i++)
+        enqueue(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]{return state->done == count;});
+}
@@ -0,0 +1,740 @@
+#include "../include/trajectory.h"
+#include "../include/numberparser.h"
+#include "../include/threadpool.h"
+#include <QByteArray>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRAJECTORY_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    static_assert(sizeof(Trajectory::FileHeader) == 64, "Invalid trajectory file header");
+
+    const char c_magic[8] = {'V', 'M', 'T', 'R', 'A', 'J', '\0', '\0'};
+    const quint32 c_version = 1;
+    const quint32 c_byteOrder = 0x01020304;
+    const std::size_t c_alignment = 64 / sizeof(float);
+
+    /**
+     * Minimum number of bytes of CSV text parsed by a thread.
+     */
+    const std::size_t c_minCsvChunkSize = 256 * 1024;
+
+    /**
+     * Number of samples transposed by a thread at once.
+     */
+    const std::size_t c_transposeBlockSize = 16 * 1024;
+
+    /**
+     * Number of intervals of a window of the decimation. Douglas-Peucker is 
+     * quadratic in the worst case (e.g. a noisy channel with a tight 
+     * tolerance), so it is bounded to O(n * c_decimateWindow) by splitting 
+     * the trajectory into windows. The ends of the windows are kept, which 
+     * bounds the compression ratio to c_decimateWindow.
+     */
+    const std::size_t c_decimateWindow = 512;
+
+    /**
+     * @brief Linearly interpolate a channel at several times.
+     * @param[in] column The channel.
+     * @param[in] indices The index of the sample before each time.
+     * @param[in] alphas The interpolation factor of each time.
+     * @param[in] count The number of times.
+     * @param[out] values The interpolated values:
+     * values[k] = column[i] + alphas[k] * (column[i + 1] - column[i]) with
+     * i = indices[k].
+     */
+    void interpolateChannel(
+        const float * column, const std::uint32_t * indices, 
+        const float * alphas, std::size_t count, float * values
+    ) {
+        std::size_t k = 0;
+#ifdef TRAJECTORY_USE_SSE2
+        // Four times per iteration
+        for (; k + 4 <= count; k += 4) {
+            const std::uint32_t * i = indices + k;
+            __m128 v0 = _mm_set_ps(
+                column[i[3]], column[i[2]], column[i[1]], column[i[0]]
+            );
+            __m128 v1 = _mm_set_ps(
+                column[i[3]+1], column[i[2]+1], column[i[1]+1], column[i[0]+1]
+            );
+            __m128 alpha = _mm_loadu_ps(alphas + k);
+            __m128 v = _mm_add_ps(v0, _mm_mul_ps(alpha, _mm_sub_ps(v1, v0)));
+            _mm_storeu_ps(values + k, v);
+        }
+#endif
+        for (; k < count; k++) {
+            const float v0 = column[indices[k]];
+            const float v1 = column[indices[k] + 1];
+            values[k] = v0 + alphas[k] * (v1 - v0);
+        }
+    }
+
+    /**
+     * @brief Chunk of complete lines of a CSV trajectory.
+     */
+    struct CsvChunk {
+        const char * first;
+        const char * last;
+        /** Parsed rows, NumChannels floats per row. */
+        std::vector<float> rows;
+        /** Number of lines of the chunk. */
+        std::size_t numLines = 0;
+        /** Line of the chunk (from 1) which cannot be parsed, 0 if none. */
+        std::size_t errorLine = 0;
+        /** Field of the error line (from 1) which is not a number. */
+        unsigned int errorField = 0;
+        /** Number of fields of the error line. */
+        unsigned int errorNumFields = 0;
+    };
+
+    /**
+     * @brief Parse a CSV field: a number surrounded by blanks, 0 if the field
+     * is empty.
+     * @param[in] first Pointer to the first character of the field.
+     * @param[in] last Pointer past the last character of the line.
+     * @param[out] value The parsed value.
+     * @return Pointer to the comma ending the field or last, nullptr if the
+     * field is not a number.
+     */
+    const char * parseField(const char * first, const char * last,
+                            float & value) {
+        using namespace NumberParser;
+        first = skipBlanks(first, last);
+        if (first == last || *first == ',') {
+            value = 0.0f;
+            return first;
+        }
+        first = parseFloat(first, last, value);
+        if (first == nullptr)
+            return nullptr;
+        first = skipBlanks(first, last);
+        return first == last || *first == ',' ? first : nullptr;
+    }
+
+    /**
+     * @brief Parse the lines of a chunk until a line cannot be parsed. The
+     * blank lines are ignored. As with QString::toFloat, an empty field is 0
+     * and "nan" or "inf" are accepted, but other text is an error, as is a
+     * line without exactly NumChannels fields or with a time which is not a
+     * number.
+     */
+    void parseCsvChunk(CsvChunk & chunk) {
+        using namespace NumberParser;
+        chunk.rows.reserve(
+            static_cast<std::size_t>(chunk.last - chunk.first) / 8
+        );
+        const char * p = chunk.first;
+        while (p != chunk.last) {
+            const char * end = std::find(p, chunk.last, '\n');
+            const char * lineEnd = end;
+            if (lineEnd != p && *(lineEnd - 1) == '\r')
+                --lineEnd;
+            chunk.numLines++;
+
+            if (skipBlanks(p, lineEnd) != lineEnd) {
+                // Parse the fields in place
+                const std::size_t row = chunk.rows.size();
+                chunk.rows.resize(row + Trajectory::NumChannels);
+                float * values = &chunk.rows[row];
+                unsigned int numFields = 0;
+                unsigned int errorField = 0;
+                for (;;) {
+                    const char * fieldEnd = nullptr;
+                    if (numFields < Trajectory::NumChannels)
+                        fieldEnd = parseField(p, lineEnd, values[numFields]);
+                    if (fieldEnd == nullptr) {
+                        if (numFields < Trajectory::NumChannels &&
+                            errorField == 0)
+                            errorField = numFields + 1;
+                        fieldEnd = std::find(p, lineEnd, ',');
+                    }
+                    numFields++;
+                    if (fieldEnd == lineEnd)
+                        break;
+                    p = fieldEnd + 1;
+                }
+                if (errorField == 0 && std::isnan(values[Trajectory::Time]))
+                    errorField = 1;
+                if (numFields != Trajectory::NumChannels || errorField != 0) {
+                    chunk.rows.resize(row);
+                    chunk.errorLine = chunk.numLines;
+                    chunk.errorField = errorField;
+                    chunk.errorNumFields = numFields;
+                    return;
+                }
+            }
+            p = end == chunk.last ? end : end + 1;
+        }
+    }
+
+    /**
+     * Relative tolerance on the time-step to consider a trajectory as
+     * uniformly sampled. It is loose so that the float rounding of the times
+     * of long logs (e.g. 100 Hz over several minutes) is accepted: the index 
+     * computed from the step is then corrected by findSample().
+     */
+    const float c_uniformTolerance = 0.25f;
+
+    /**
+     * @brief Fill the Eytzinger layout of a sorted array.
+     * @param[in] sorted The sorted array.
+     * @param[in] size The size of the sorted array.
+     * @param[out] eytzinger The Eytzinger layout, 1-indexed.
+     * @param[out] index The index in the sorted array of each element.
+     * @param i The index in the sorted array of the next element to place.
+     * @param k The position in the Eytzinger layout.
+     */
+    std::size_t fillEytzinger(
+        const float * sorted, std::size_t size, std::vector<float> & eytzinger,
+        std::vector<std::size_t> & index, std::size_t i = 0, std::size_t k = 1
+    ) {
+        if (k <= size) {
+            i = fillEytzinger(sorted, size, eytzinger, index, i, 2 * k);
+            eytzinger[k] = sorted[i];
+            index[k] = i++;
+            i = fillEytzinger(sorted, size, eytzinger, index, i, 2 * k + 1);
+        }
+        return i;
+    }
+}
+
+
+bool TrajectorySource::getSamples(
+    const float * times, std::size_t count, float * samples
+) {
+    bool available = true;
+    float row[NumChannels];
+    for (std::size_t k = 0; k < count; k++) {
+        if (getSample(times[k], row)) {
+            for (unsigned int c = 0; c < NumChannels; c++)
+                samples[c * count + k] = row[c];
+        }
+        else {
+            available = false;
+        }
+    }
+    return available;
+}
+
+
+Trajectory::Trajectory() :
+    m_numSamples(0),
+    m_columnStride(0),
+    m_uniformStep(0.0f),
+    p_data(nullptr),
+    m_cursor(0) {}
+
+
+Trajectory::~Trajectory() {}
+
+
+float Trajectory::firstTime() const {
+    return isEmpty() ? 0.0f : time(0);
+}
+
+
+float Trajectory::finalTime() const {
+    return isEmpty() ? 0.0f : time(m_numSamples - 1);
+}
+
+
+bool Trajectory::getSample(float time, float row[NumChannels]) {
+    if (isEmpty())
+        return false;
+
+    // Find the last sample which occurs before the time
+    const std::size_t i0 = findSample(time, m_cursor);
+    m_cursor = i0;
+    const float time0 = this->time(i0);
+    if (i0 + 1 >= m_numSamples || time <= time0) {
+        sample(i0, row);
+        return true;
+    }
+
+    // Linear interpolation
+    const float alpha = (time - time0) / (this->time(i0 + 1) - time0);
+    for (unsigned int c = 0; c < NumChannels; c++) {
+        const float * data = column(c);
+        row[c] = data[i0] + alpha * (data[i0 + 1] - data[i0]);
+    }
+    return true;
+}
+
+
+bool Trajectory::getSamples(
+    const float * times, std::size_t count, float * samples
+) {
+    if (isEmpty())
+        return false;
+    if (m_numSamples == 1) {
+        for (unsigned int c = 0; c < NumChannels; c++)
+            std::fill(samples + c * count, samples + (c + 1) * count, 
+                      column(c)[0]);
+        return true;
+    }
+
+    // Find the interpolation interval of each time. The times outside of the
+    // trajectory are clamped to the first or last interval. The buffers only
+    // grow, so that the snapshots of each frame do not allocate.
+    if (m_indices.size() < count) {
+        m_indices.resize(count);
+        m_alphas.resize(count);
+    }
+    std::uint32_t * indices = m_indices.data();
+    float * alphas = m_alphas.data();
+    const float * timeColumn = column(Time);
+    for (std::size_t k = 0; k < count; k++) {
+        m_cursor = findSample(times[k], m_cursor);
+        const std::size_t i0 = std::min(m_cursor, m_numSamples - 2);
+        const float alpha = (times[k] - timeColumn[i0]) / 
+            (timeColumn[i0 + 1] - timeColumn[i0]);
+        indices[k] = static_cast<std::uint32_t>(i0);
+        alphas[k] = std::max(0.0f, std::min(alpha, 1.0f));
+    }
+
+    // Interpolate each channel for all the times at once
+    for (unsigned int c = 0; c < NumChannels; c++)
+        interpolateChannel(
+            column(c), indices, alphas, count, 
+            samples + c * count
+        );
+    return true;
+}
+
+
+std::size_t Trajectory::columnStride(std::size_t numSamples) {
+    return (numSamples + c_alignment - 1) / c_alignment * c_alignment;
+}
+
+
+void Trajectory::sample(std::size_t i, float row[NumChannels]) const {
+    for (unsigned int c = 0; c < NumChannels; c++)
+        row[c] = column(c)[i];
+}
+
+
+void Trajectory::buildIndex() {
+    m_uniformStep = 0.0f;
+    m_eytzinger.clear();
+    m_eytzingerIndex.clear();
+    if (m_numSamples < 2)
+        return;
+
+    // Check if the samples are uniformly spaced in time
+    const float * times = column(Time);
+    const float step = (times[m_numSamples - 1] - times[0]) / 
+        static_cast<float>(m_numSamples - 1);
+    bool uniform = step > 0.0f;
+    for (std::size_t i = 1; uniform && i < m_numSamples; i++) {
+        float expected = times[0] + static_cast<float>(i) * step;
+        uniform = std::abs(times[i] - expected) <= c_uniformTolerance * step;
+    }
+    if (uniform) {
+        m_uniformStep = step;
+        return;
+    }
+
+    // Build the Eytzinger layout used by the binary search
+    m_eytzinger.resize(m_numSamples + 1);
+    m_eytzingerIndex.resize(m_numSamples + 1);
+    m_eytzinger[0] = std::numeric_limits<float>::quiet_NaN();
+    m_eytzingerIndex[0] = 0;
+    fillEytzinger(times, m_numSamples, m_eytzinger, m_eytzingerIndex);
+}
+
+
+std::size_t Trajectory::searchSample(float time) const {
+    // Find the first element greater than time. Each iteration descends one
+    // level of the implicit tree, which keeps the next candidates contiguous.
+    const std::size_t n = m_numSamples;
+    std::size_t k = 1;
+    while (k <= n)
+        k = 2 * k + (m_eytzinger[k] <= time);
+    // Remove the trailing right turns to retrieve the element
+    while (k & 1)
+        k >>= 1;
+    k >>= 1;
+    if (k == 0)
+        return n - 1;
+    const std::size_t i = m_eytzingerIndex[k];
+    return i > 0 ? i - 1 : 0;
+}
+
+
+std::size_t Trajectory::findSample(float time, std::size_t hint) const {
+    const float * times = column(Time);
+    const std::size_t last = m_numSamples - 1;
+    if (time <= times[0])
+        return 0;
+    if (time >= times[last])
+        return last;
+
+    std::size_t i;
+    if (isUniform()) {
+        // Direct index computation, corrected for the rounding errors
+        float index = (time - times[0]) / m_uniformStep;
+        i = std::min(static_cast<std::size_t>(index), last);
+    }
+    else if (hint < last && times[hint] <= time) {
+        // Monotonic playback: the sample is usually the hint or close to it
+        i = hint;
+        for (int step = 0; step < 4 && i < last && times[i + 1] <= time; step++)
+            i++;
+        if (i < last && times[i + 1] <= time)
+            i = searchSample(time);
+    }
+    else {
+        i = searchSample(time);
+    }
+
+    while (i > 0 && times[i] > time)
+        i--;
+    while (i < last && times[i + 1] <= time)
+        i++;
+    return i;
+}
+
+
+std::unique_ptr<Trajectory> Trajectory::fromCsv(const QString & csv) {
+    const QByteArray text = csv.toLatin1();
+    return fromCsv(text.constData(), static_cast<std::size_t>(text.size()));
+}
+
+
+std::unique_ptr<Trajectory> Trajectory::fromCsv(
+    const char * text, std::size_t size
+) {
+    const char * first = text;
+    const char * last = text + size;
+
+    // Ignore first line
+    first = std::find(first, last, '\n');
+    if (first != last)
+        ++first;
+
+    // Split the text into chunks of complete lines
+    ThreadPool & pool = ThreadPool::global();
+    const std::size_t numChunks = std::max<std::size_t>(1, std::min<std::size_t>(
+        static_cast<std::size_t>(last - first) / c_minCsvChunkSize, 
+        4 * (pool.size() + 1)
+    ));
+    std::vector<CsvChunk> chunks(numChunks);
+    const char * begin = first;
+    for (std::size_t k = 0; k < numChunks; k++) {
+        const char * end = last;
+        if (k + 1 < numChunks) {
+            end = begin + (last - begin) / static_cast<long>(numChunks - k);
+            end = std::find(end, last, '\n');
+            if (end != last)
+                ++end;
+        }
+        chunks[k].first = begin;
+        chunks[k].last = end;
+        begin = end;
+    }
+
+    // Parse the chunks on all cores
+    pool.parallelFor(numChunks, [&chunks](std::size_t k) {
+        parseCsvChunk(chunks[k]);
+    });
+
+    // Gather the rows up to the first line which cannot be parsed
+    std::vector<const float *> rows;
+    std::size_t lineNumber = 1;
+    for (const CsvChunk & chunk : chunks) {
+        for (std::size_t i = 0; i < chunk.rows.size(); i += NumChannels)
+            rows.push_back(&chunk.rows[i]);
+        if (chunk.errorLine > 0 && chunk.errorNumFields != NumChannels) {
+            qCritical() << "Unable to load line" << lineNumber+chunk.errorLine
+                << "of the trajectory:" << chunk.errorNumFields
+                << "fields present," << NumChannels << "are required";
+            break;
+        }
+        if (chunk.errorLine > 0) {
+            qCritical() << "Unable to load line" << lineNumber+chunk.errorLine
+                << "of the trajectory: field" << chunk.errorField
+                << "is not a number";
+            break;
+        }
+        lineNumber += chunk.numLines;
+    }
+
+    // Sort the samples by time. When several samples share the same time,
+    // keep the last one.
+    auto earlier = [](const float * a, const float * b) {
+        return a[Time] < b[Time];
+    };
+    if (!std::is_sorted(rows.begin(), rows.end(), earlier))
+        std::stable_sort(rows.begin(), rows.end(), earlier);
+    std::size_t numSamples = 0;
+    for (std::size_t i = 0; i < rows.size(); i++) {
+        if (numSamples > 0 && rows[numSamples - 1][Time] == rows[i][Time])
+            rows[numSamples - 1] = rows[i];
+        else
+            rows[numSamples++] = rows[i];
+    }
+
+    // Transpose the rows into columns
+    std::unique_ptr<Trajectory> trajectory = std::make_unique<Trajectory>();
+    trajectory->m_numSamples = numSamples;
+    trajectory->m_columnStride = columnStride(numSamples);
+    trajectory->m_data.resize(NumChannels * trajectory->m_columnStride);
+    float * data = trajectory->m_data.data();
+    const std::size_t stride = trajectory->m_columnStride;
+    const std::size_t numBlocks = 
+        (stride + c_transposeBlockSize - 1) / c_transposeBlockSize;
+    pool.parallelFor(numBlocks, [&](std::size_t block) {
+        const std::size_t begin = block * c_transposeBlockSize;
+        const std::size_t end = std::min(begin + c_transposeBlockSize, stride);
+        for (std::size_t i = begin; i < end; i++) {
+            for (unsigned int c = 0; c < NumChannels; c++)
+                data[c * stride + i] = i < numSamples ? rows[i][c] : 0.0f;
+        }
+    });
+    trajectory->p_data = data;
+    trajectory->buildIndex();
+    return trajectory;
+}
+
+
+std::unique_ptr<Trajectory> Trajectory::decimate(
+    const Tolerance & tolerance
+) const {
+    // Tolerance of each channel. The time is not checked.
+    float channelTolerance[NumChannels];
+    channelTolerance[Time] = std::numeric_limits<float>::infinity();
+    for (unsigned int c = ChassisX; c < NumChannels; c++)
+        channelTolerance[c] = tolerance.position;
+    for (unsigned int c : {ChassisYaw, ChassisPitch, ChassisRoll,
+                           WheelFLRotation, WheelFLSteer, WheelFRRotation, 
+                           WheelFRSteer, WheelRLRotation, WheelRLSteer,
+                           WheelRRRotation, WheelRRSteer})
+        channelTolerance[c] = tolerance.angle;
+    for (unsigned int c : {ForceFLX, ForceFLY, ForceFLZ, ForceFRX, ForceFRY, 
+                           ForceFRZ, ForceRLX, ForceRLY, ForceRLZ, ForceRRX, 
+                           ForceRRY, ForceRRZ})
+        channelTolerance[c] = tolerance.force;
+
+    // Error of the sample i interpolated between the samples a and b, 
+    // relatively to the tolerance
+    const float * times = column(Time);
+    auto error = [&](std::size_t a, std::size_t i, std::size_t b) {
+        const float alpha = (times[i] - times[a]) / (times[b] - times[a]);
+        float maxError = 0.0f;
+        for (unsigned int c = ChassisX; c < NumChannels; c++) {
+            const float * data = column(c);
+            const float diff = 
+                std::abs(data[a] + alpha * (data[b] - data[a]) - data[i]);
+            if (diff > channelTolerance[c])
+                maxError = std::max(maxError, channelTolerance[c] > 0.0f ? 
+                    diff / channelTolerance[c] : 
+                    std::numeric_limits<float>::infinity());
+        }
+        return maxError;
+    };
+
+    // Douglas-Peucker: keep the sample with the largest error between two 
+    // kept samples until all the errors are within the tolerance. Each window
+    // of c_decimateWindow samples is decimated independently, on all cores, 
+    // and its first and last samples are kept.
+    std::vector<unsigned char> keep(m_numSamples, 0);
+    if (m_numSamples > 0)
+        keep.back() = 1;
+    const std::size_t numWindows = m_numSamples > 1 ? 
+        (m_numSamples - 2) / c_decimateWindow + 1 : 0;
+    ThreadPool::global().parallelFor(numWindows, [&](std::size_t window) {
+        const std::size_t first = window * c_decimateWindow;
+        const std::size_t last = 
+            std::min(first + c_decimateWindow, m_numSamples - 1);
+        keep[first] = 1;
+        std::vector<std::pair<std::size_t, std::size_t>> intervals;
+        if (last - first > 1)
+            intervals.emplace_back(first, last);
+        while (!intervals.empty()) {
+            const std::size_t a = intervals.back().first;
+            const std::size_t b = intervals.back().second;
+            intervals.pop_back();
+            float maxError = 0.0f;
+            std::size_t worst = a;
+            for (std::size_t i = a + 1; i < b; i++) {
+                float e = error(a, i, b);
+                if (e > maxError) {
+                    maxError = e;
+                    worst = i;
+                }
+            }
+            if (worst != a) {
+                keep[worst] = 1;
+                if (worst - a > 1)
+                    intervals.emplace_back(a, worst);
+                if (b - worst > 1)
+                    intervals.emplace_back(worst, b);
+            }
+        }
+    });
+
+    // Copy the kept samples
+    std::unique_ptr<Trajectory> trajectory = std::make_unique<Trajectory>();
+    trajectory->m_numSamples = 
+        static_cast<std::size_t>(std::count(keep.begin(), keep.end(), 1));
+    trajectory->m_columnStride = columnStride(trajectory->m_numSamples);
+    trajectory->m_data.assign(
+        NumChannels * trajectory->m_columnStride, 0.0f
+    );
+    for (unsigned int c = 0; c < NumChannels; c++) {
+        const float * data = column(c);
+        float * decimated = 
+            trajectory->m_data.data() + c * trajectory->m_columnStride;
+        for (std::size_t i = 0, j = 0; i < m_numSamples; i++) {
+            if (keep[i])
+                decimated[j++] = data[i];
+        }
+    }
+    trajectory->p_data = trajectory->m_data.data();
+    trajectory->buildIndex();
+
+    qInfo() << "Trajectory decimated from" << m_numSamples << "to" 
+        << trajectory->m_numSamples << "samples (compression ratio" 
+        << (trajectory->m_numSamples > 0 ? 
+            static_cast<float>(m_numSamples) / trajectory->m_numSamples : 1.0f)
+        << ")";
+    return trajectory;
+}
+
+
+bool Trajectory::readHeader(QFile & file, FileHeader & header) {
+    const QString fileName = file.fileName();
+    if (file.size() < static_cast<qint64>(sizeof(FileHeader)) ||
+        file.read(reinterpret_cast<char *>(&header), sizeof(FileHeader)) !=
+            static_cast<qint64>(sizeof(FileHeader))) {
+        qWarning() << "The file" << fileName << "is not a trajectory file.";
+        return false;
+    }
+    if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0) {
+        qWarning() << "The file" << fileName << "is not a trajectory file.";
+        return false;
+    }
+    if (header.byteOrder != c_byteOrder) {
+        qWarning() << "The trajectory file" << fileName << "has been written "
+            "on a machine with a different byte order.";
+        return false;
+    }
+    if (header.version != c_version || header.numChannels != NumChannels) {
+        qWarning() << "The version of the trajectory file" << fileName <<
+            "is not supported.";
+        return false;
+    }
+    // The sizes are checked without overflow: the fields of a corrupted
+    // header may be arbitrarily large
+    const quint64 rowSize = header.numChannels * sizeof(float);
+    const quint64 maxStride = std::min<quint64>(
+        std::numeric_limits<quint64>::max() / rowSize,
+        std::numeric_limits<std::size_t>::max()
+    );
+    if (header.columnStride < header.numSamples ||
+        header.columnStride > maxStride ||
+        header.dataOffset % sizeof(float) != 0) {
+        qWarning() << "The trajectory file" << fileName << "is corrupted.";
+        return false;
+    }
+    const quint64 dataSize = header.columnStride * rowSize;
+    const quint64 fileSize = static_cast<quint64>(file.size());
+    if (header.dataOffset > fileSize || 
+        dataSize > fileSize - header.dataOffset) {
+        qWarning() << "The trajectory file" << fileName << "is truncated.";
+        return false;
+    }
+    return true;
+}
+
+
+std::unique_ptr<Trajectory> Trajectory::fromFile(const QString & fileName) {
+    std::unique_ptr<QFile> file = std::make_unique<QFile>(fileName);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "Error while loading file" << fileName;
+        return nullptr;
+    }
+
+    // Read and check the header
+    FileHeader header;
+    if (!readHeader(*file, header))
+        return nullptr;
+    quint64 dataSize = header.numChannels * header.columnStride * sizeof(float);
+
+    std::unique_ptr<Trajectory> trajectory = std::make_unique<Trajectory>();
+    trajectory->m_numSamples = header.numSamples;
+    trajectory->m_columnStride = header.columnStride;
+    if (header.numSamples == 0)
+        return trajectory;
+
+    // Map the columns: the pages are loaded by the OS when first accessed
+    uchar * data = file->map(header.dataOffset, dataSize);
+    if (data == nullptr) {
+        qWarning() << "Unable to map the trajectory file" << fileName;
+        return nullptr;
+    }
+    trajectory->p_data = reinterpret_cast<const float *>(data);
+    trajectory->p_file = std::move(file);
+
+    // The lookups require the time channel to be sorted. The comparison also
+    // rejects NaN times.
+    const float * times = trajectory->column(Time);
+    for (std::size_t i = 1; i < trajectory->m_numSamples; i++) {
+        if (!(times[i - 1] <= times[i])) {
+            qWarning() << "The time of the trajectory file" << fileName <<
+                "decreases at sample" << i;
+            return nullptr;
+        }
+    }
+    trajectory->buildIndex();
+    return trajectory;
+}
+
+
+bool Trajectory::save(const QString & fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Unable to open file" << fileName << "for writing.";
+        return false;
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(FileHeader));
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version = c_version;
+    header.byteOrder = c_byteOrder;
+    header.numChannels = NumChannels;
+    header.numSamples = m_numSamples;
+    header.columnStride = columnStride(m_numSamples);
+    header.dataOffset = sizeof(FileHeader);
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader))
+        != static_cast<qint64>(sizeof(FileHeader))) {
+        qWarning() << "Error while writing file" << fileName;
+        return false;
+    }
+
+    // Write the columns with the padding
+    std::vector<float> padding(header.columnStride - m_numSamples, 0.0f);
+    for (unsigned int c = 0; c < NumChannels; c++) {
+        qint64 size = static_cast<qint64>(m_numSamples * sizeof(float));
+        qint64 paddingSize = static_cast<qint64>(padding.size() * sizeof(float));
+        if (file.write(reinterpret_cast<const char *>(column(c)), size) != size
+            || file.write(reinterpret_cast<const char *>(padding.data()),
+                          paddingSize) != paddingSize) {
+            qWarning() << "Error while writing file" << fileName;
+            return false;
+        }
+    }
+    file.close();
+    return true;
+}
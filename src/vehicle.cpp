@@ -1,30 +1,13 @@
 #include "../include/vehicle.h"
+#include "../include/pagedtrajectory.h"
+#include "../include/livetrajectory.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
-#define NUMBER_FIELD_TO_LOAD 39
 #define FORCE_SCALE 3000
 
 
-// Overload operator*() of the VehiclePosition structure
-VehiclePosition operator*(const VehiclePosition & lhs, const float & rhs) {
-    return VehiclePosition(
-        lhs.chassis * rhs,
-        lhs.wheelFL * rhs, 
-        lhs.wheelFR * rhs, 
-        lhs.wheelRL * rhs, 
-        lhs.wheelRR * rhs, 
-        lhs.forceFL * rhs, 
-        lhs.forceFR * rhs, 
-        lhs.forceRL * rhs, 
-        lhs.forceRR * rhs
-    );
-}
-
-VehiclePosition operator*(const float & lhs, const VehiclePosition & rhs) {
-    return rhs * lhs;
-}
-
-
-
 /***
  *         __      __  _     _      _                 
  *         \ \    / / | |   (_)    | |                
@@ -41,139 +24,89 @@ VehiclePosition operator*(const float & lhs, const VehiclePosition & rhs) {
  *                                                    
  */
 
-VehicleController::VehicleController(QString trajectory) {
-        bool isFirstLine = true;
-        QTextStream stream(&trajectory);
-        while (!stream.atEnd()) {
-            if (isFirstLine) {
-                // Ignore first line
-                stream.readLine();
-                isFirstLine = false;
-                continue;
-            }
-            QString line = stream.readLine();
-            QStringList fields = line.split(",");
-
-            if (fields.size() == NUMBER_FIELD_TO_LOAD) {
-                // Save the trajectory
-                float timestep = fields.at(0).toFloat();
-                
-                float chaX     = fields.at(1).toFloat();
-                float chaY     = fields.at(2).toFloat();
-                float chaZ     = fields.at(3).toFloat();
-                float chaYaw   = fields.at(4).toFloat();
-                float chaPitch = fields.at(5).toFloat();
-                float chaRoll  = fields.at(6).toFloat();
-                
-                float wFLX     = fields.at(7).toFloat();
-                float wFLY     = fields.at(8).toFloat();
-                float wFLZ     = fields.at(9).toFloat();
-                float wFLRot   = fields.at(10).toFloat();
-                float wFLSteer = fields.at(11).toFloat();
-                float wFLfx    = fields.at(12).toFloat();
-                float wFLfy    = fields.at(13).toFloat();
-                float wFLfz    = fields.at(14).toFloat();
-                
-                float wFRX     = fields.at(15).toFloat();
-                float wFRY     = fields.at(16).toFloat();
-                float wFRZ     = fields.at(17).toFloat();
-                float wFRRot   = fields.at(18).toFloat();
-                float wFRSteer = fields.at(19).toFloat();
-                float wFRfx    = fields.at(20).toFloat();
-                float wFRfy    = fields.at(21).toFloat();
-                float wFRfz    = fields.at(22).toFloat();
-                
-                float wRLX     = fields.at(23).toFloat();
-                float wRLY     = fields.at(24).toFloat();
-                float wRLZ     = fields.at(25).toFloat();
-                float wRLRot   = fields.at(26).toFloat();
-                float wRLSteer = fields.at(27).toFloat();
-                float wRLfx    = fields.at(28).toFloat();
-                float wRLfy    = fields.at(29).toFloat();
-                float wRLfz    = fields.at(30).toFloat();
-                
-                float wRRX     = fields.at(31).toFloat();
-                float wRRY     = fields.at(32).toFloat();
-                float wRRZ     = fields.at(33).toFloat();
-                float wRRRot   = fields.at(34).toFloat();
-                float wRRSteer = fields.at(35).toFloat();
-                float wRRfx    = fields.at(36).toFloat();
-                float wRRfy    = fields.at(37).toFloat();
-                float wRRfz    = fields.at(38).toFloat();
-                
-                VehiclePosition position;
-                position.chassis = Position(
-                    chaX, chaY, chaZ, chaYaw, chaPitch, chaRoll
-                );
-                position.wheelFL = Position(
-                    wFLX, wFLY, wFLZ, wFLSteer+chaYaw, wFLRot, chaRoll-PI
-                );
-                position.wheelFR = Position(
-                    wFRX, wFRY, wFRZ, wFRSteer+chaYaw, wFRRot, chaRoll
-                );
-                position.wheelRL = Position(
-                    wRLX, wRLY, wRLZ, wRLSteer+chaYaw, wRLRot, chaRoll-PI
-                );
-                position.wheelRR = Position(
-                    wRRX, wRRY, wRRZ, wRRSteer+chaYaw, wRRRot, chaRoll
-                );
-                position.forceFL = QVector3D(
-                    wFLfx, wFLfy, wFLfz
-                );
-                position.forceFR = QVector3D(
-                    wFRfx, wFRfy, wFRfz
-                );
-                position.forceRL = QVector3D(
-                    wRLfx, wRLfy, wRLfz
-                );
-                position.forceRR = QVector3D(
-                    wRRfx, wRRfy, wRRfz
-                );
-                
-                // Insert the position to the trajectory
-                m_trajectory[timestep] = position;
-            }
-            else {
-                qCritical() << "Not enough field to load the vehicle."
-                    << fields.size() << "fields present," 
-                    << NUMBER_FIELD_TO_LOAD << "are required";
-                break;
-            }
-        }
+VehicleController::VehicleController(
+    std::unique_ptr<TrajectorySource> trajectory
+) :
+    p_trajectory(std::move(trajectory)) {
+    if (!p_trajectory)
+        p_trajectory = std::make_unique<Trajectory>();
 }
 
 
-VehiclePosition VehicleController::getVehiclePosition(const float time) {
-    // If before first timestep
-    if (time <= m_trajectory.begin()->first) {
-        return m_trajectory.begin()->second;
-    }
+VehiclePosition VehicleController::toVehiclePosition(
+    const float row[Trajectory::NumChannels]
+) {
+    const float chaYaw  = row[Trajectory::ChassisYaw];
+    const float chaRoll = row[Trajectory::ChassisRoll];
     
-    // Find the first element which occur before time-step
-    Trajectory::iterator it = m_trajectory.lower_bound(time);
+    VehiclePosition position;
+    position.chassis = Position(
+        row[Trajectory::ChassisX], row[Trajectory::ChassisY], 
+        row[Trajectory::ChassisZ], chaYaw, row[Trajectory::ChassisPitch], 
+        chaRoll
+    );
+    position.wheelFL = Position(
+        row[Trajectory::WheelFLX], row[Trajectory::WheelFLY], 
+        row[Trajectory::WheelFLZ], row[Trajectory::WheelFLSteer]+chaYaw, 
+        row[Trajectory::WheelFLRotation], chaRoll-PI
+    );
+    position.wheelFR = Position(
+        row[Trajectory::WheelFRX], row[Trajectory::WheelFRY], 
+        row[Trajectory::WheelFRZ], row[Trajectory::WheelFRSteer]+chaYaw, 
+        row[Trajectory::WheelFRRotation], chaRoll
+    );
+    position.wheelRL = Position(
+        row[Trajectory::WheelRLX], row[Trajectory::WheelRLY], 
+        row[Trajectory::WheelRLZ], row[Trajectory::WheelRLSteer]+chaYaw, 
+        row[Trajectory::WheelRLRotation], chaRoll-PI
+    );
+    position.wheelRR = Position(
+        row[Trajectory::WheelRRX], row[Trajectory::WheelRRY], 
+        row[Trajectory::WheelRRZ], row[Trajectory::WheelRRSteer]+chaYaw, 
+        row[Trajectory::WheelRRRotation], chaRoll
+    );
+    position.forceFL = QVector3D(
+        row[Trajectory::ForceFLX], row[Trajectory::ForceFLY], 
+        row[Trajectory::ForceFLZ]
+    );
+    position.forceFR = QVector3D(
+        row[Trajectory::ForceFRX], row[Trajectory::ForceFRY], 
+        row[Trajectory::ForceFRZ]
+    );
+    position.forceRL = QVector3D(
+        row[Trajectory::ForceRLX], row[Trajectory::ForceRLY], 
+        row[Trajectory::ForceRLZ]
+    );
+    position.forceRR = QVector3D(
+        row[Trajectory::ForceRRX], row[Trajectory::ForceRRY], 
+        row[Trajectory::ForceRRZ]
+    );
+    return position;
+}
+
+
+void VehicleController::getVehiclePositions(
+    const std::vector<float> & timesteps, VehiclePosition * positions
+) {
+    const std::size_t count = timesteps.size();
+    if (m_samples.size() < count * Trajectory::NumChannels)
+        m_samples.resize(count * Trajectory::NumChannels);
     
-    // Linear interpolation
-    // FIXME: Some glitches when interpolating with big sampling time.
-    if (it != m_trajectory.end()) {
-        // Can find the position in the trajectory
-        float time0 = it->first;
-        VehiclePosition position0 = it->second;
-        if (++it != m_trajectory.end() && time0 != time) {
-            // Can find a position at the next time-step
-            float time1 = it->first;
-            VehiclePosition position1 = it->second;
-            float alpha = (time - time0) / (time1 - time0);
-            return (position1 - position0) * alpha + position0;
-        }
-        else {
-            // Cannot find a position at the next time-step
-            return position0;
-        }
-    }
-    else {
-        return VehiclePosition();
-//         // Return position at last timestep
-//         return m_trajectory.end()->second;
+    // The samples which are not available yet are left unchanged: their time
+    // stays NaN
+    std::fill(m_samples.begin(), m_samples.begin() + count, 
+              std::numeric_limits<float>::quiet_NaN());
+    const bool available = 
+        p_trajectory->getSamples(timesteps.data(), count, m_samples.data());
+    
+    // Convert the channels into positions
+    float row[Trajectory::NumChannels];
+    for (std::size_t k = 0; k < count; k++) {
+        if (!available && std::isnan(m_samples[Trajectory::Time * count + k]))
+            continue;
+        for (unsigned int c = 0; c < Trajectory::NumChannels; c++)
+            row[c] = m_samples[c * count + k];
+        positions[k] = toVehiclePosition(row);
     }
 }
 
@@ -195,7 +128,9 @@ VehiclePosition VehicleController::getVehiclePosition(const float time) {
  *                      |_|                     
  */
 
-void VehicleGraphics::updateMatrices(const VehiclePosition vehiclePosition) {
+VehicleGraphics::Matrices VehicleGraphics::computeMatrices(
+    const VehiclePosition & vehiclePosition
+) const {
     Position chassis = vehiclePosition.chassis;
     Position wheelFL = vehiclePosition.wheelFL;
     Position wheelFR = vehiclePosition.wheelFR;
@@ -220,93 +155,99 @@ void VehicleGraphics::updateMatrices(const VehiclePosition vehiclePosition) {
      * (T). Therefore, we must compute T * R and apply first translation, then 
      * rotation.
      */
-    m_chassisMatrix = Position::toMatrix(chassis + m_offset);
-    m_wheelFLMatrix = Position::toMatrix(wheelFL + m_offset);
-    m_wheelFRMatrix = Position::toMatrix(wheelFR + m_offset);
-    m_wheelRLMatrix = Position::toMatrix(wheelRL + m_offset);
-    m_wheelRRMatrix = Position::toMatrix(wheelRR + m_offset);
-    // Apply rotation for wheel spin
-    m_wheelFLMatrix.rotate(wheelFLSpin*180/PI, 0,-1, 0);
-    m_wheelFRMatrix.rotate(wheelFRSpin*180/PI, 0, 1, 0);
-    m_wheelRLMatrix.rotate(wheelRLSpin*180/PI, 0,-1, 0);
-    m_wheelRRMatrix.rotate(wheelRRSpin*180/PI, 0, 1, 0);
+    Matrices matrices;
+    matrices.chassis = Position::toMatrix(chassis + m_offset);
+    // Apply rotation for wheel spin (around -y for the left wheels)
+    matrices.wheelFL = Position::toMatrix(wheelFL + m_offset, -wheelFLSpin);
+    matrices.wheelFR = Position::toMatrix(wheelFR + m_offset,  wheelFRSpin);
+    matrices.wheelRL = Position::toMatrix(wheelRL + m_offset, -wheelRLSpin);
+    matrices.wheelRR = Position::toMatrix(wheelRR + m_offset,  wheelRRSpin);
     
     // Compute model matrices to draw the force arrows
-    m_forceFLMatrix = getForceModelMatrix(
+    matrices.forceFL = getForceModelMatrix(
         forceFL, wheelFL, chassis, QVector3D( 1, 0.5,0)
     );
-    m_forceFRMatrix = getForceModelMatrix(
+    matrices.forceFR = getForceModelMatrix(
         forceFR, wheelFR, chassis, QVector3D( 1,-0.5,0)
     );
-    m_forceRLMatrix = getForceModelMatrix(
+    matrices.forceRL = getForceModelMatrix(
         forceRL, wheelRL, chassis, QVector3D(-1.2, 0.5,0)
                        );
-    m_forceRRMatrix = getForceModelMatrix(
+    matrices.forceRR = getForceModelMatrix(
         forceRR, wheelRR, chassis, QVector3D(-1.2,-0.5,0)
     );
+    return matrices;
 }
 
 
 QMatrix4x4 VehicleGraphics::getForceModelMatrix(const QVector3D & force,
                                                 const Position & wheelPos,
                                                 const Position & chassisPos,
-                                                const QVector3D & offset) {
-    QMatrix4x4 modelMatrix;
-    modelMatrix.setToIdentity();
-    modelMatrix.translate(wheelPos.x, wheelPos.y, wheelPos.z);
-    modelMatrix.rotate(chassisPos.yaw *180/PI,0,0,1);
-    modelMatrix.translate(offset);
-    modelMatrix.scale(force / FORCE_SCALE);
-    return modelMatrix;
+                                                const QVector3D & offset) const {
+    // Translation to the wheel, rotation of the chassis yaw, translation of 
+    // the offset and scaling of the force, in closed form
+    const float cy = std::cos(chassisPos.yaw), sy = std::sin(chassisPos.yaw);
+    const QVector3D scale = force / FORCE_SCALE;
+    return QMatrix4x4(
+        cy*scale.x(), -sy*scale.y(), 0.0f, 
+        wheelPos.x + cy*offset.x() - sy*offset.y(),
+        sy*scale.x(),  cy*scale.y(), 0.0f, 
+        wheelPos.y + sy*offset.x() + cy*offset.y(),
+        0.0f, 0.0f, scale.z(), wheelPos.z + offset.z(),
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
 }
 
 
 void VehicleGraphics::render(
+    const Matrices & matrices, 
     const CasterLight & light, const QMatrix4x4 & view, 
     const QMatrix4x4 & projection, 
     const std::array<QMatrix4x4,NUM_CASCADES> & lightSpace,
     const std::array<float,NUM_CASCADES+1> & cascades
 ) {
     if (p_wheelModel != nullptr) {
-        p_wheelModel->setModelMatrix(m_wheelFLMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelFL);
         p_wheelModel->render(light, view, projection, lightSpace, cascades);
-        p_wheelModel->setModelMatrix(m_wheelFRMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelFR);
         p_wheelModel->render(light, view, projection, lightSpace, cascades);
-        p_wheelModel->setModelMatrix(m_wheelRLMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelRL);
         p_wheelModel->render(light, view, projection, lightSpace, cascades);
-        p_wheelModel->setModelMatrix(m_wheelRRMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelRR);
         p_wheelModel->render(light, view, projection, lightSpace, cascades);
     }
     if (p_chassisModel != nullptr) {
-        p_chassisModel->setModelMatrix(m_chassisMatrix);
+        p_chassisModel->setModelMatrix(matrices.chassis);
         p_chassisModel->render(light, view, projection, lightSpace, cascades);
     }
     if (p_forceLine != nullptr && m_showTireForce) {
-        p_forceLine->setModelMatrix(m_forceFLMatrix);
+        p_forceLine->setModelMatrix(matrices.forceFL);
         p_forceLine->render(light, view, projection, lightSpace, cascades);
-        p_forceLine->setModelMatrix(m_forceFRMatrix);
+        p_forceLine->setModelMatrix(matrices.forceFR);
         p_forceLine->render(light, view, projection, lightSpace, cascades);
-        p_forceLine->setModelMatrix(m_forceRLMatrix);
+        p_forceLine->setModelMatrix(matrices.forceRL);
         p_forceLine->render(light, view, projection, lightSpace, cascades);
-        p_forceLine->setModelMatrix(m_forceRRMatrix);
+        p_forceLine->setModelMatrix(matrices.forceRR);
         p_forceLine->render(light, view, projection, lightSpace, cascades);
     }
 }
 
 
-void VehicleGraphics::renderShadow(const QMatrix4x4 & lightSpace) {
+void VehicleGraphics::renderShadow(
+    const Matrices & matrices, const QMatrix4x4 & lightSpace
+) {
     if (p_wheelModel != nullptr) {
-        p_wheelModel->setModelMatrix(m_wheelFLMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelFL);
         p_wheelModel->renderShadow(lightSpace);
-        p_wheelModel->setModelMatrix(m_wheelFRMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelFR);
         p_wheelModel->renderShadow(lightSpace);
-        p_wheelModel->setModelMatrix(m_wheelRLMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelRL);
         p_wheelModel->renderShadow(lightSpace);
-        p_wheelModel->setModelMatrix(m_wheelRRMatrix);
+        p_wheelModel->setModelMatrix(matrices.wheelRR);
         p_wheelModel->renderShadow(lightSpace);
     }
     if (p_chassisModel != nullptr) {
-        p_chassisModel->setModelMatrix(m_chassisMatrix);
+        p_chassisModel->setModelMatrix(matrices.chassis);
         p_chassisModel->renderShadow(lightSpace);
     }
 }
@@ -334,20 +275,20 @@ void VehicleGraphics::renderShadow(const QMatrix4x4 & lightSpace) {
 #include <QXmlSchemaValidator>
 #include "../include/object.h"
 #include "../include/line.h"
+#include "../include/threadpool.h"
 
-bool VehicleBuilder::build() {
+bool VehicleBuilder::parse(const QString & fileName, QDomDocument & domDoc) {
     // Get data
-    if (!QFile::exists(m_file)) {
-        qWarning() << "The file" << m_file << "does not exist.";
+    if (!QFile::exists(fileName)) {
+        qWarning() << "The file" << fileName << "does not exist.";
         return false;
     }
     
-    QDomDocument domDoc;
     // Load XML file as raw data
-    QFile file(m_file);
+    QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly)) {
         // Error while loading file
-        qWarning() << "Error while loading file" << m_file;
+        qWarning() << "Error while loading file" << fileName;
     }
     
     // Retrieve the XML schema
@@ -367,7 +308,7 @@ bool VehicleBuilder::build() {
     // Validate the vehicle XML file
     QXmlSchemaValidator validator{schema};
     if (!validator.validate(&file, QUrl::fromLocalFile(file.fileName()))) {
-        qCritical() << "The file" << m_file << "does not meet the XML "
+        qCritical() << "The file" << fileName << "does not meet the XML "
         "schema definition. The XML will not be parsed.";
         return false;
     }
@@ -377,40 +318,122 @@ bool VehicleBuilder::build() {
     domDoc.setContent(&file);
     file.close();
     
+    return true;
+}
+
+
+std::unique_ptr<TrajectorySource> VehicleBuilder::loadTrajectory(
+    const QDomElement & elmt
+) {
+    // Trajectory streamed by a running simulation
+    if (elmt.hasAttribute("live"))
+        return LiveTrajectory::open(elmt.attribute("live"));
+    
+    QString trajectoryFile = elmt.attribute("file", "");
+    if (!trajectoryFile.isEmpty() && elmt.attribute("paged", "false") == "true")
+        return PagedTrajectory::open(trajectoryFile);
+    
+    std::unique_ptr<Trajectory> trajectory = trajectoryFile.isEmpty() ? 
+        Trajectory::fromCsv(elmt.text()) : Trajectory::fromFile(trajectoryFile);
+    
+    // Decimate the trajectory
+    if (trajectory != nullptr && elmt.attribute("decimate", "false") == "true") {
+        Trajectory::Tolerance tolerance;
+        tolerance.position = elmt.attribute("positionTolerance", "0").toFloat();
+        tolerance.angle = elmt.attribute("angleTolerance", "0").toFloat();
+        tolerance.force = elmt.attribute("forceTolerance", "0").toFloat();
+        trajectory = trajectory->decimate(tolerance);
+    }
+    return trajectory;
+}
+
+
+bool VehicleBuilder::exportTrajectory(
+    const QString & file, const QString & trajectoryFile
+) {
+    QDomDocument domDoc;
+    if (!parse(file, domDoc))
+        return false;
+    
+    // Get the trajectory element
+    QDomElement elmt = domDoc.documentElement().firstChildElement("trajectory");
+    if (elmt.hasAttribute("file")) {
+        qWarning() << "The trajectory of" << file << "is already stored in the "
+            "binary file" << elmt.attribute("file");
+        return false;
+    }
+    
+    return Trajectory::fromCsv(elmt.text())->save(trajectoryFile);
+}
+
+
+void VehicleBuilder::start() {
+    const QString file = m_file;
+    m_components = ThreadPool::global().submit([file]{
+        return loadComponents(file);
+    });
+}
+
+
+VehicleBuilder::Components VehicleBuilder::loadComponents(
+    const QString & file
+) {
+    Components components;
+    QDomDocument domDoc;
+    if (!parse(file, domDoc))
+        return components;
+    
     // Get vehicle element
     QDomElement root = domDoc.documentElement();
     
     // Process chassis
     QDomElement elmt = root.firstChildElement();
-    QString chassisObject = elmt.attribute("model", "");
+    components.chassisModel = elmt.attribute("model", "");
     QString chassisTex = elmt.attribute("texture", "");
     
     // Process wheel
     elmt = elmt.nextSiblingElement();
-    QString wheelObject = elmt.attribute("model", "");
+    components.wheelModel = elmt.attribute("model", "");
     QString wheelTex = elmt.attribute("texture", "");
     
-    // Process trajectory
-    elmt = elmt.nextSiblingElement();
-    QString trajectory = elmt.text();
-    
-    // Load the chassis model
-    ABCObject * chassis = nullptr;
-    Object::Loader chassisLoader(chassisObject,chassisTex);
-    if (chassisLoader.build()) {
-        chassis = ObjectManager::loadObject(
-            chassisObject, chassisLoader.getObject()
+    // Load the chassis and wheel models on the thread pool. The vehicles 
+    // sharing a model load it once.
+    const QString models[2][2] = {
+        {components.chassisModel, chassisTex},
+        {components.wheelModel, wheelTex}
+    };
+    for (unsigned int i = 0; i < 2; i++) {
+        const QString model = models[i][0];
+        const QString texture = models[i][1];
+        ObjectManager::loadObjectAsync(
+            model, [model, texture]() -> std::unique_ptr<ABCObject> {
+                Object::Loader loader(model, texture);
+                if (loader.build())
+                    return loader.getObject();
+                return nullptr;
+            }
         );
     }
     
-    // Load the wheel model
-    ABCObject * wheel = nullptr;
-    Object::Loader wheelLoader(wheelObject,wheelTex);
-    if (wheelLoader.build()) {
-        wheel = ObjectManager::loadObject(
-            wheelObject, wheelLoader.getObject()
-        );
-    }
+    // Process trajectory
+    elmt = elmt.nextSiblingElement();
+    components.trajectory = loadTrajectory(elmt);
+    if (!components.trajectory)
+        qCritical() << "Unable to load the trajectory of the vehicle" << file;
+    return components;
+}
+
+
+bool VehicleBuilder::build() {
+    if (!m_components.valid())
+        start();
+    Components components = m_components.get();
+    if (!components.trajectory)
+        return false;
+    
+    // Get the chassis and wheel models, initialized when received
+    ABCObject * chassis = ObjectManager::getObject(components.chassisModel);
+    ABCObject * wheel = ObjectManager::getObject(components.wheelModel);
     
     // Load line
     ABCObject * line = nullptr;
@@ -430,7 +453,9 @@ bool VehicleBuilder::build() {
     );
     
     // Create the vehicle
-    p_vehicle = std::make_unique<Vehicle>(chassis, wheel, line, trajectory);
+    p_vehicle = std::make_unique<Vehicle>(
+        chassis, wheel, line, std::move(components.trajectory)
+    );
     
     return true;
 }
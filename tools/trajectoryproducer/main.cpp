@@ -0,0 +1,242 @@
+#include "../../include/livering.h"
+#include "../../include/numberparser.h"
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * Small producer of live trajectories used to test the renderer without a
+ * simulation. It creates the shared memory ring buffer then writes the samples
+ * in real time, either replayed from a CSV file or synthesized.
+ */
+
+// Number of channels of a sample, see TrajectorySource::Channel
+const std::uint32_t c_numChannels = 39;
+
+volatile std::sig_atomic_t g_stop = 0;
+
+
+void helpPrinter() {
+    std::cout << "Usage: trajectoryproducer <name> [options]\n"
+    << " Stream a vehicle trajectory into the shared memory <name> (e.g.\n"
+    << " /vehicle) which is read by a trajectory element with live=\"<name>\"\n\n"
+    << "Options:\n"
+    << "  -h, --help            Displays help on command line options.\n"
+    << "  -f, --file <csv>      Replay the CSV trajectory (same columns as the\n"
+    << "                        trajectory element). Otherwise, a vehicle\n"
+    << "                        driving in circle is synthesized.\n"
+    << "  -r, --rate <hz>       Sample rate of the synthesized trajectory\n"
+    << "                        (default 100).\n"
+    << "  -c, --capacity <n>    Number of samples of the ring buffer\n"
+    << "                        (default 4096)." << std::endl;
+}
+
+
+/**
+ * @brief Read the samples of a CSV file. The lines which cannot be parsed
+ * (e.g. the header) are skipped.
+ */
+bool readCsv(const std::string & file, std::vector<float> & samples) {
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) {
+        std::cerr << "Unable to open " << file << "." << std::endl;
+        return false;
+    }
+    const std::string text(
+        (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>()
+    );
+
+    const char * p = text.data();
+    const char * end = p + text.size();
+    float row[c_numChannels];
+    while (p < end) {
+        const char * eol = static_cast<const char *>(
+            std::memchr(p, '\n', static_cast<std::size_t>(end - p))
+        );
+        if (eol == nullptr)
+            eol = end;
+        const char * q = p;
+        std::uint32_t c = 0;
+        for (; c < c_numChannels; c++) {
+            q = NumberParser::parseFloat(NumberParser::skipBlanks(q, eol), eol,
+                                         row[c]);
+            if (q == nullptr)
+                break;
+            q = NumberParser::skipBlanks(q, eol);
+            if (q != eol && *q == ',')
+                ++q;
+        }
+        if (c == c_numChannels)
+            samples.insert(samples.end(), row, row + c_numChannels);
+        p = eol + 1;
+    }
+    if (samples.empty()) {
+        std::cerr << "The file " << file << " has no sample." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Synthesize the sample of a vehicle driving in circle at constant
+ * speed. The geometry is the one of the vehicles in asset/SimulationData.
+ */
+void synthesize(float time, float row[c_numChannels]) {
+    const double radius = 30.0, speed = 10.0, wheelRadius = 0.308309834537847;
+    const double yaw = speed / radius * time;
+    const double steer = std::atan(2.905 / radius);
+    const double rotation = speed / wheelRadius * time;
+    // Centripetal force of a 1800 kg vehicle shared by the four tires
+    const double lateralForce = 1800.0 * speed * speed / radius / 4.0;
+    const double wheels[4][3] = {
+        {1.36074660031943, 0.768, 4845.5950545},
+        {1.36074660031943, -0.768, 4845.5950545},
+        {-1.54525339968057, 0.768, 4267.0198935},
+        {-1.54525339968057, -0.768, 4267.0198935}
+    };
+
+    const double x = radius * std::sin(yaw);
+    const double y = radius - radius * std::cos(yaw);
+    row[0] = time;
+    row[1] = static_cast<float>(x);
+    row[2] = static_cast<float>(y);
+    row[3] = 0.0f;
+    row[4] = static_cast<float>(yaw);
+    row[5] = 0.0f;
+    row[6] = 0.0f;
+    for (unsigned int w = 0; w < 4; w++) {
+        float * wheel = row + 7 + 8 * w;
+        wheel[0] = static_cast<float>(
+            x + wheels[w][0] * std::cos(yaw) - wheels[w][1] * std::sin(yaw)
+        );
+        wheel[1] = static_cast<float>(
+            y + wheels[w][0] * std::sin(yaw) + wheels[w][1] * std::cos(yaw)
+        );
+        wheel[2] = static_cast<float>(wheelRadius);
+        wheel[3] = static_cast<float>(rotation);
+        wheel[4] = w < 2 ? static_cast<float>(steer) : 0.0f;
+        wheel[5] = 0.0f;
+        wheel[6] = static_cast<float>(lateralForce);
+        wheel[7] = static_cast<float>(wheels[w][2]);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    // Parse arguments
+    std::string name, file;
+    double rate = 100.0;
+    std::uint64_t capacity = 4096;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i],"-h") == 0) || (strcmp(argv[i],"--help") == 0)) {
+            helpPrinter();
+            return 0;
+        }
+        if ((strcmp(argv[i],"-f") == 0) || (strcmp(argv[i],"--file") == 0) ||
+            (strcmp(argv[i],"-r") == 0) || (strcmp(argv[i],"--rate") == 0) ||
+            (strcmp(argv[i],"-c") == 0) || (strcmp(argv[i],"--capacity") == 0)
+        ) {
+            if (i+1 >= argc) {
+                std::cout << "Argument '" << argv[i] << "' must be followed by "
+                    "a value." << std::endl;
+                return -1;
+            }
+            const char option = argv[i][1] == '-' ? argv[i][2] : argv[i][1];
+            const char * value = argv[++i];
+            if (option == 'f')
+                file = value;
+            else if (option == 'r')
+                rate = std::atof(value);
+            else
+                capacity = std::strtoull(value, nullptr, 10);
+        }
+        else if (name.empty() && argv[i][0] != '-') {
+            name = argv[i];
+        }
+        else {
+            std::cout << "Invalid argument: " << argv[i] << "." << std::endl;
+            return -1;
+        }
+    }
+    if (name.empty() || rate <= 0.0 || capacity < 2) {
+        helpPrinter();
+        return -1;
+    }
+
+    std::vector<float> samples;
+    if (!file.empty() && !readCsv(file, samples))
+        return -1;
+
+    // Create the ring buffer
+    const std::size_t size = LiveRing::size(capacity, c_numChannels);
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "Unable to create the shared memory " << name << "."
+            << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+        }
+        return -1;
+    }
+    void * data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Unable to map the shared memory " << name << "."
+            << std::endl;
+        shm_unlink(name.c_str());
+        return -1;
+    }
+    LiveRingHeader * header = static_cast<LiveRingHeader *>(data);
+    LiveRing::initialize(header, capacity, c_numChannels);
+
+    std::signal(SIGINT, [](int){g_stop = 1;});
+    std::signal(SIGTERM, [](int){g_stop = 1;});
+    std::cout << "Streaming into " << name << ", press Ctrl+C to stop."
+        << std::endl;
+
+    // Write the samples at the pace of their time. The first sample is written
+    // immediately.
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t numSamples = samples.size() / c_numChannels;
+    float row[c_numChannels];
+    float firstTime = 0.0f;
+    for (std::size_t s = 0; !g_stop && (file.empty() || s < numSamples); s++) {
+        const float * sample = row;
+        if (file.empty()) {
+            synthesize(static_cast<float>(s / rate), row);
+        }
+        else {
+            sample = samples.data() + s * c_numChannels;
+            if (s == 0)
+                firstTime = sample[0];
+        }
+        std::this_thread::sleep_until(start + std::chrono::duration<double>(
+            sample[0] - firstTime
+        ));
+        // Wait for the renderer to release samples when the buffer is full
+        while (!g_stop && !LiveRing::push(header, sample))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Keep the shared memory until stopped so that the renderer can still
+    // open it
+    while (!g_stop)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    munmap(data, size);
+    shm_unlink(name.c_str());
+    return 0;
+}
@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = trajectoryproducer
+
+CONFIG += console c++14
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../../include/livering.h \
+    ../../include/numberparser.h
+
+unix: !macx {
+    LIBS += -lrt
+}